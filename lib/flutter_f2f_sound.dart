@@ -1,5 +1,14 @@
+import 'package:flutter/foundation.dart';
+
 import 'flutter_f2f_sound_platform_interface.dart';
 
+export 'flutter_f2f_sound_platform_interface.dart'
+    show
+        CaptureOverflowPolicy,
+        PcmSampleFormat,
+        PlaybackState,
+        PlaybackStateEvent;
+
 /// Flutter F2F Sound Plugin
 ///
 /// A cross-platform audio plugin that supports playback control across multiple platforms.
@@ -14,18 +23,245 @@ class FlutterF2fSound {
   /// [path] - The path to the audio file
   /// [volume] - The volume level (0.0 to 1.0)
   /// [loop] - Whether to loop the audio playback
+  /// [latencyMs] - Optional target output latency, e.g. 20-50 ms for UI
+  /// sound effects; see [getPlaybackLatency] for the value granted
+  /// [prebufferMs] - Audio decoded from a URL before playback starts
+  /// (default 500 ms on Linux); see [playbackStateEvents]
   Future<void> play({
     required String path,
     double volume = 1.0,
     bool loop = false,
+    int? latencyMs,
+    int? prebufferMs,
   }) {
     return FlutterF2fSoundPlatform.instance.play(
       path: path,
       volume: volume,
       loop: loop,
+      latencyMs: latencyMs,
+      prebufferMs: prebufferMs,
+    );
+  }
+
+  /// Play audio from bytes in memory, without writing a file first
+  ///
+  /// [bytes] - An encoded file (WAV, FLAC, Ogg) or headerless PCM
+  /// [mimeHint] - Required for headerless PCM, e.g.
+  /// `audio/pcm; rate=24000; channels=1` (little-endian 16-bit) or
+  /// `audio/L16; rate=16000` (big-endian); ignored for files with a header
+  /// [volume] - The volume level (0.0 to 1.0)
+  /// [latencyMs] - Optional target output latency, as for [play]
+  /// The bytes are sent to the native side once and decoded from memory
+  /// (Linux only)
+  Future<void> playBytes(
+    Uint8List bytes, {
+    String? mimeHint,
+    double volume = 1.0,
+    int? latencyMs,
+  }) {
+    return FlutterF2fSoundPlatform.instance.playBytes(
+      bytes,
+      mimeHint: mimeHint,
+      volume: volume,
+      latencyMs: latencyMs,
+    );
+  }
+
+  /// Start playing PCM fed a piece at a time, such as a call or live speech
+  ///
+  /// [sampleRate], [channels] and [format] - The interleaved samples to come
+  /// [targetLatencyMs] - Audio buffered before playback starts; underruns
+  /// raise it a step at a time
+  /// [maxLatencyMs] - Older audio beyond this is dropped (twice the target
+  /// by default, never when 0)
+  /// [volume] and [latencyMs] - As for [play]
+  /// Returns the handle to pass to [feedPcmSink] (Linux only)
+  Future<int> openPcmSink({
+    required int sampleRate,
+    int channels = 1,
+    PcmSampleFormat format = PcmSampleFormat.int16,
+    int targetLatencyMs = 40,
+    int? maxLatencyMs,
+    double volume = 1.0,
+    int? latencyMs,
+  }) {
+    return FlutterF2fSoundPlatform.instance.openPcmSink(
+      sampleRate: sampleRate,
+      channels: channels,
+      format: format,
+      targetLatencyMs: targetLatencyMs,
+      maxLatencyMs: maxLatencyMs,
+      volume: volume,
+      latencyMs: latencyMs,
+    );
+  }
+
+  /// Queue samples on a PCM sink
+  ///
+  /// [samples] - An Int16List or Float32List, matching the sink's format
+  /// Returns how many frames fitted; with [maxLatencyMs] 0 a producer running
+  /// ahead of real time should hold back and resend the rest
+  Future<int> feedPcmSink(int handle, TypedData samples) {
+    return FlutterF2fSoundPlatform.instance.feedPcmSink(handle, samples);
+  }
+
+  /// Finish a PCM sink once what it holds has played
+  Future<void> closePcmSink(int handle) {
+    return FlutterF2fSoundPlatform.instance.closePcmSink(handle);
+  }
+
+  /// Get the counters of a PCM sink
+  ///
+  /// Returns a map keyed by `fedFrames`, `playedFrames`, `underruns`,
+  /// `trimmedFrames` (dropped to keep latency bounded), `rejectedFrames`
+  /// (refused because the buffer was full), `bufferedFrames` and
+  /// `targetFrames`
+  Future<Map<String, int>> getPcmSinkStats(int handle) {
+    return FlutterF2fSoundPlatform.instance.getPcmSinkStats(handle);
+  }
+
+  /// Start the sound effect mixer ahead of the first sound
+  ///
+  /// [sampleRate] - Output rate; sounds at other rates are resampled
+  /// [latencyMs] - Output buffering, the delay before a sound is heard
+  /// (default 20 ms)
+  /// The mixer plays every sound through one output stream of its own,
+  /// alongside the track (Linux only)
+  Future<void> startMixer({int sampleRate = 48000, int? latencyMs}) {
+    return FlutterF2fSoundPlatform.instance.startMixer(
+      sampleRate: sampleRate,
+      latencyMs: latencyMs,
+    );
+  }
+
+  /// Stop the mixer's output stream and every sound in it
+  Future<void> stopMixer() {
+    return FlutterF2fSoundPlatform.instance.stopMixer();
+  }
+
+  /// Play a sound effect
+  ///
+  /// [path] - A local audio file, decoded once and kept in the PCM cache
+  /// [gain] - Linear gain of this voice
+  /// [pan] - From -1.0 (left) to 1.0 (right)
+  /// [rate] - Playback speed, which also shifts the pitch
+  /// [loop] - Repeat until stopped
+  /// Sounds overlap the track and each other; up to 32 play at once, after
+  /// which a new sound takes the oldest one's voice. Returns the voice id
+  /// (Linux only)
+  Future<int> playSound(
+    String path, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) {
+    return FlutterF2fSoundPlatform.instance.playSound(
+      path,
+      gain: gain,
+      pan: pan,
+      rate: rate,
+      loop: loop,
+    );
+  }
+
+  /// Change a playing voice; parameters left out keep their values
+  ///
+  /// Changes ramp over a few milliseconds. Returns false once the voice has
+  /// finished
+  Future<bool> setVoice(
+    int voice, {
+    double? gain,
+    double? pan,
+    double? rate,
+    bool? loop,
+  }) {
+    return FlutterF2fSoundPlatform.instance.setVoice(
+      voice,
+      gain: gain,
+      pan: pan,
+      rate: rate,
+      loop: loop,
+    );
+  }
+
+  /// Fade a voice out and end it
+  Future<bool> stopVoice(int voice) {
+    return FlutterF2fSoundPlatform.instance.stopVoice(voice);
+  }
+
+  /// Fade out and end every voice
+  Future<void> stopAllVoices() {
+    return FlutterF2fSoundPlatform.instance.stopAllVoices();
+  }
+
+  /// Check whether a voice is still playing
+  Future<bool> isVoicePlaying(int voice) {
+    return FlutterF2fSoundPlatform.instance.isVoicePlaying(voice);
+  }
+
+  /// Get the mixer counters
+  ///
+  /// Returns a map keyed by `activeVoices`, `peakVoices`, `maxVoices`,
+  /// `stolenVoices`, `droppedCommands` and `lostFinishes`
+  Future<Map<String, int>> getMixerStats() {
+    return FlutterF2fSoundPlatform.instance.getMixerStats();
+  }
+
+  /// Load a short sound ahead of time for [triggerSample]
+  ///
+  /// [path] - A local audio file
+  /// The file is decoded once, converted to the mixer's output rate and kept
+  /// in memory, and the mixer's stream is started so the first trigger does
+  /// not wait for it. Loading the same file again returns the same id
+  /// (Linux only)
+  Future<int> loadSample(String path) {
+    return FlutterF2fSoundPlatform.instance.loadSample(path);
+  }
+
+  /// Play a loaded sample with the least delay
+  ///
+  /// [gain], [pan], [rate] and [loop] - As for [playSound]
+  /// Starting the voice takes a lookup and one command for the next audio
+  /// callback. Returns the voice id, for [setVoice] and [stopVoice]; fails
+  /// with `NOT_LOADED` once the sample was unloaded or evicted
+  Future<int> triggerSample(
+    int id, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) {
+    return FlutterF2fSoundPlatform.instance.triggerSample(
+      id,
+      gain: gain,
+      pan: pan,
+      rate: rate,
+      loop: loop,
     );
   }
 
+  /// Remove a sample from memory; voices playing it finish first
+  Future<bool> unloadSample(int id) {
+    return FlutterF2fSoundPlatform.instance.unloadSample(id);
+  }
+
+  /// Set the memory budget for loaded samples
+  ///
+  /// [bytes] - Budget in bytes (default 32 MB)
+  /// Past it, the least recently triggered samples are dropped
+  Future<void> setSampleBankBudget(int bytes) {
+    return FlutterF2fSoundPlatform.instance.setSampleBankBudget(bytes);
+  }
+
+  /// Get the sample bank counters
+  ///
+  /// Returns a map keyed by `loads`, `evictions`, `entries`, `bytes` and
+  /// `budgetBytes`
+  Future<Map<String, int>> getSampleBankStats() {
+    return FlutterF2fSoundPlatform.instance.getSampleBankStats();
+  }
+
   /// Pause the currently playing audio
   Future<void> pause() {
     return FlutterF2fSoundPlatform.instance.pause();
@@ -41,6 +277,14 @@ class FlutterF2fSound {
     return FlutterF2fSoundPlatform.instance.resume();
   }
 
+  /// Move the current playback to [position] seconds
+  ///
+  /// On Linux a seek in a URL that lands outside the downloaded part is
+  /// fetched with an HTTP range request instead of waiting for the download
+  Future<void> seek(double position) {
+    return FlutterF2fSoundPlatform.instance.seek(position);
+  }
+
   /// Set the volume of the currently playing audio
   ///
   /// [volume] - The volume level (0.0 to 1.0)
@@ -72,9 +316,32 @@ class FlutterF2fSound {
 
   /// Start audio recording and get a stream of recorded audio data
   ///
+  /// [sampleRate] - Capture sample rate in Hz (default 44100)
+  /// [channels] - 1 = mono, 2 = stereo
+  /// [fragmentMs] - Capture buffer size in milliseconds (default 10 ms on
+  /// Linux, 40 ms on Windows)
+  /// [packetDurationMs] - Optional fixed packet duration (e.g. 10, 20, 40
+  /// or 100 ms); every packet then holds exactly that many frames
+  /// [maxQueuedPackets] - Bound on packets waiting for delivery (default 32)
+  /// [overflowPolicy] - What to do when that bound is reached (default
+  /// [CaptureOverflowPolicy.dropOldest])
   /// Returns a stream of audio data as `List<int>` (PCM samples)
-  Stream<List<int>> startRecording() {
-    return FlutterF2fSoundPlatform.instance.startRecording();
+  Stream<List<int>> startRecording({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    return FlutterF2fSoundPlatform.instance.startRecording(
+      sampleRate: sampleRate,
+      channels: channels,
+      fragmentMs: fragmentMs,
+      packetDurationMs: packetDurationMs,
+      maxQueuedPackets: maxQueuedPackets,
+      overflowPolicy: overflowPolicy,
+    );
   }
 
   /// Stop audio recording
@@ -92,8 +359,132 @@ class FlutterF2fSound {
 
   /// Start system sound capture and get a stream of captured audio data
   ///
+  /// [packetDurationMs] - Optional fixed packet duration in milliseconds
   /// Returns a stream of audio data as `List<int>` (PCM samples)
-  Stream<List<int>> startSystemSoundCapture() {
-    return FlutterF2fSoundPlatform.instance.startSystemSoundCapture();
+  Stream<List<int>> startSystemSoundCapture({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    return FlutterF2fSoundPlatform.instance.startSystemSoundCapture(
+      fragmentMs: fragmentMs,
+      packetDurationMs: packetDurationMs,
+      maxQueuedPackets: maxQueuedPackets,
+      overflowPolicy: overflowPolicy,
+    );
+  }
+
+  /// Start audio recording with samples delivered as float32
+  ///
+  /// Returns a stream of interleaved samples normalized to [-1.0, 1.0]
+  Stream<Float32List> startRecordingFloat32({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    return FlutterF2fSoundPlatform.instance.startRecordingFloat32(
+      sampleRate: sampleRate,
+      channels: channels,
+      fragmentMs: fragmentMs,
+      packetDurationMs: packetDurationMs,
+      maxQueuedPackets: maxQueuedPackets,
+      overflowPolicy: overflowPolicy,
+    );
+  }
+
+  /// Start system sound capture with samples delivered as float32
+  ///
+  /// Returns a stream of interleaved samples normalized to [-1.0, 1.0]
+  Stream<Float32List> startSystemSoundCaptureFloat32({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    return FlutterF2fSoundPlatform.instance.startSystemSoundCaptureFloat32(
+      fragmentMs: fragmentMs,
+      packetDurationMs: packetDurationMs,
+      maxQueuedPackets: maxQueuedPackets,
+      overflowPolicy: overflowPolicy,
+    );
+  }
+
+  /// Listen for buffering and underrun events of the current playback
+  ///
+  /// Emits [PlaybackState.buffering] while a URL fills its pre-buffer,
+  /// [PlaybackState.ready] once audio plays, and [PlaybackState.underrun]
+  /// when the download falls behind (Linux only)
+  Stream<PlaybackStateEvent> playbackStateEvents() {
+    return FlutterF2fSoundPlatform.instance.playbackStateEvents();
+  }
+
+  /// Get the output latency granted for the current playback
+  ///
+  /// Returns the buffered duration in milliseconds, or 0 before playback
+  /// has started
+  Future<double> getPlaybackLatency() {
+    return FlutterF2fSoundPlatform.instance.getPlaybackLatency();
+  }
+
+  /// Get the number of frames each audio stream has dropped
+  ///
+  /// Returns a map keyed by `recording`, `systemSound` and `playback`
+  Future<Map<String, int>> getDroppedFrames() {
+    return FlutterF2fSoundPlatform.instance.getDroppedFrames();
+  }
+
+  /// Set the memory kept for decoded audio of short local files
+  ///
+  /// Replaying a cached file skips decoding entirely; least recently played
+  /// files are dropped beyond [bytes] (default 64 MB, 0 disables the cache,
+  /// Linux only)
+  Future<void> setPcmCacheBudget(int bytes) {
+    return FlutterF2fSoundPlatform.instance.setPcmCacheBudget(bytes);
+  }
+
+  /// Get the decoded audio cache counters
+  ///
+  /// Returns a map keyed by `hits`, `misses`, `evictions`, `entries`, `bytes`
+  /// and `budgetBytes`
+  Future<Map<String, int>> getPcmCacheStats() {
+    return FlutterF2fSoundPlatform.instance.getPcmCacheStats();
+  }
+
+  /// Warm up the connection to an audio host before playing from it
+  ///
+  /// [url] - Any URL on the host, or a bare host name (taken as https)
+  /// The DNS answer and TLS session (Linux) or the connection (web) are
+  /// kept for the next download from that host, so it starts sooner.
+  /// Returns whether the host could be reached (Linux and web)
+  Future<bool> preconnect(String url) {
+    return FlutterF2fSoundPlatform.instance.preconnect(url);
+  }
+
+  /// Start audio recording into the native shared-memory capture ring
+  ///
+  /// [ringCapacityBytes] - Ring size used if the ring does not exist yet;
+  /// once it does, a different size fails with INVALID_ARGUMENT
+  /// Audio the previous session left unread is skipped by the reader
+  /// Read the PCM in place with `CaptureRingReader` (Linux only)
+  Future<void> startRecordingToRing({int? ringCapacityBytes}) {
+    return FlutterF2fSoundPlatform.instance.startRecordingToRing(
+      ringCapacityBytes: ringCapacityBytes,
+    );
+  }
+
+  /// Start system sound capture into the native shared-memory capture ring
+  ///
+  /// [ringCapacityBytes] - Ring size used if the ring does not exist yet;
+  /// once it does, a different size fails with INVALID_ARGUMENT
+  /// Audio the previous session left unread is skipped by the reader
+  /// Read the PCM in place with `CaptureRingReader` (Linux only)
+  Future<void> startSystemSoundCaptureToRing({int? ringCapacityBytes}) {
+    return FlutterF2fSoundPlatform.instance.startSystemSoundCaptureToRing(
+      ringCapacityBytes: ringCapacityBytes,
+    );
   }
 }
@@ -27,6 +27,12 @@ class MethodChannelFlutterF2fSound extends FlutterF2fSoundPlatform {
     'com.tecmore.flutter_f2f_sound/playback_stream',
   );
 
+  /// The event channel used to receive playback buffering state changes.
+  @visibleForTesting
+  final playbackStateEventChannel = const EventChannel(
+    'com.tecmore.flutter_f2f_sound/playback_state',
+  );
+
   @override
   Future<String?> getPlatformVersion() async {
     final version = await methodChannel.invokeMethod<String>(
@@ -40,12 +46,214 @@ class MethodChannelFlutterF2fSound extends FlutterF2fSoundPlatform {
     required String path,
     double volume = 1.0,
     bool loop = false,
+    int? latencyMs,
+    int? prebufferMs,
   }) async {
     await methodChannel.invokeMethod('play', {
       'path': path,
       'volume': volume,
       'loop': loop,
+      if (latencyMs != null) 'latencyMs': latencyMs,
+      if (prebufferMs != null) 'prebufferMs': prebufferMs,
+    });
+  }
+
+  @override
+  Future<void> playBytes(
+    Uint8List bytes, {
+    String? mimeHint,
+    double volume = 1.0,
+    int? latencyMs,
+  }) async {
+    await methodChannel.invokeMethod('playBytes', {
+      'bytes': bytes,
+      if (mimeHint != null) 'mimeHint': mimeHint,
+      'volume': volume,
+      if (latencyMs != null) 'latencyMs': latencyMs,
+    });
+  }
+
+  @override
+  Future<int> openPcmSink({
+    required int sampleRate,
+    int channels = 1,
+    PcmSampleFormat format = PcmSampleFormat.int16,
+    int targetLatencyMs = 40,
+    int? maxLatencyMs,
+    double volume = 1.0,
+    int? latencyMs,
+  }) async {
+    final handle = await methodChannel.invokeMethod<int>('openPcmSink', {
+      'sampleRate': sampleRate,
+      'channels': channels,
+      'format': format.name,
+      'targetLatencyMs': targetLatencyMs,
+      if (maxLatencyMs != null) 'maxLatencyMs': maxLatencyMs,
+      'volume': volume,
+      if (latencyMs != null) 'latencyMs': latencyMs,
+    });
+    return handle!;
+  }
+
+  @override
+  Future<int> feedPcmSink(int handle, TypedData samples) async {
+    final Object payload;
+    if (samples is Float32List) {
+      payload = samples;
+    } else if (samples is Int16List) {
+      // The codec has no Int16List, so the samples go as their bytes
+      payload = samples.buffer.asUint8List(
+        samples.offsetInBytes,
+        samples.lengthInBytes,
+      );
+    } else {
+      throw ArgumentError.value(
+          samples, 'samples', 'must be an Int16List or a Float32List');
+    }
+    final fed = await methodChannel.invokeMethod<int>('feedPcmSink', {
+      'handle': handle,
+      'samples': payload,
+    });
+    return fed ?? 0;
+  }
+
+  @override
+  Future<void> closePcmSink(int handle) async {
+    await methodChannel.invokeMethod('closePcmSink', {'handle': handle});
+  }
+
+  @override
+  Future<Map<String, int>> getPcmSinkStats(int handle) async {
+    final result = await methodChannel.invokeMapMethod<String, int>(
+      'getPcmSinkStats',
+      {'handle': handle},
+    );
+    return result ?? const {};
+  }
+
+  @override
+  Future<void> startMixer({int sampleRate = 48000, int? latencyMs}) async {
+    await methodChannel.invokeMethod('startMixer', {
+      'sampleRate': sampleRate,
+      if (latencyMs != null) 'latencyMs': latencyMs,
+    });
+  }
+
+  @override
+  Future<void> stopMixer() async {
+    await methodChannel.invokeMethod('stopMixer');
+  }
+
+  @override
+  Future<int> playSound(
+    String path, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) async {
+    final voice = await methodChannel.invokeMethod<int>('playSound', {
+      'path': path,
+      'gain': gain,
+      'pan': pan,
+      'rate': rate,
+      'loop': loop,
+    });
+    return voice!;
+  }
+
+  @override
+  Future<bool> setVoice(
+    int voice, {
+    double? gain,
+    double? pan,
+    double? rate,
+    bool? loop,
+  }) async {
+    final playing = await methodChannel.invokeMethod<bool>('setVoice', {
+      'voice': voice,
+      if (gain != null) 'gain': gain,
+      if (pan != null) 'pan': pan,
+      if (rate != null) 'rate': rate,
+      if (loop != null) 'loop': loop,
     });
+    return playing ?? false;
+  }
+
+  @override
+  Future<bool> stopVoice(int voice) async {
+    final playing = await methodChannel.invokeMethod<bool>('stopVoice', {
+      'voice': voice,
+    });
+    return playing ?? false;
+  }
+
+  @override
+  Future<void> stopAllVoices() async {
+    await methodChannel.invokeMethod('stopAllVoices');
+  }
+
+  @override
+  Future<bool> isVoicePlaying(int voice) async {
+    final playing = await methodChannel.invokeMethod<bool>('isVoicePlaying', {
+      'voice': voice,
+    });
+    return playing ?? false;
+  }
+
+  @override
+  Future<Map<String, int>> getMixerStats() async {
+    final result = await methodChannel.invokeMapMethod<String, int>(
+      'getMixerStats',
+    );
+    return result ?? const {};
+  }
+
+  @override
+  Future<int> loadSample(String path) async {
+    final id = await methodChannel.invokeMethod<int>('loadSample', {
+      'path': path,
+    });
+    return id!;
+  }
+
+  @override
+  Future<int> triggerSample(
+    int id, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) async {
+    final voice = await methodChannel.invokeMethod<int>('triggerSample', {
+      'id': id,
+      'gain': gain,
+      'pan': pan,
+      'rate': rate,
+      'loop': loop,
+    });
+    return voice!;
+  }
+
+  @override
+  Future<bool> unloadSample(int id) async {
+    final unloaded = await methodChannel.invokeMethod<bool>('unloadSample', {
+      'id': id,
+    });
+    return unloaded ?? false;
+  }
+
+  @override
+  Future<void> setSampleBankBudget(int bytes) async {
+    await methodChannel.invokeMethod('setSampleBankBudget', {'bytes': bytes});
+  }
+
+  @override
+  Future<Map<String, int>> getSampleBankStats() async {
+    final result = await methodChannel.invokeMapMethod<String, int>(
+      'getSampleBankStats',
+    );
+    return result ?? const {};
   }
 
   @override
@@ -63,6 +271,11 @@ class MethodChannelFlutterF2fSound extends FlutterF2fSoundPlatform {
     await methodChannel.invokeMethod('resume');
   }
 
+  @override
+  Future<void> seek(double position) async {
+    await methodChannel.invokeMethod('seek', {'position': position});
+  }
+
   @override
   Future<void> setVolume(double volume) async {
     await methodChannel.invokeMethod('setVolume', {'volume': volume});
@@ -88,12 +301,26 @@ class MethodChannelFlutterF2fSound extends FlutterF2fSoundPlatform {
   }
 
   @override
-  Stream<List<int>> startRecording() async* {
-    await methodChannel.invokeMethod('startRecording');
-    yield* eventChannel.receiveBroadcastStream().map((event) {
-      final list = event as List<dynamic>;
-      return list.map((e) => e as int).toList();
-    });
+  Stream<List<int>> startRecording({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
+    await methodChannel.invokeMethod(
+      'startRecording',
+      _captureArguments(
+        sampleRate: sampleRate,
+        channels: channels,
+        fragmentMs: fragmentMs,
+        packetDurationMs: packetDurationMs,
+        maxQueuedPackets: maxQueuedPackets,
+        overflowPolicy: overflowPolicy,
+      ),
+    );
+    yield* eventChannel.receiveBroadcastStream().map(_decodePcmBytes);
   }
 
   @override
@@ -102,20 +329,186 @@ class MethodChannelFlutterF2fSound extends FlutterF2fSoundPlatform {
   }
 
   @override
-  Stream<List<int>> startSystemSoundCapture() async* {
-    await methodChannel.invokeMethod('startSystemSoundCapture');
-    yield* systemSoundEventChannel.receiveBroadcastStream().map((event) {
-      final list = event as List<dynamic>;
-      return list.map((e) => e as int).toList();
+  Stream<List<int>> startSystemSoundCapture({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
+    await methodChannel.invokeMethod(
+      'startSystemSoundCapture',
+      _captureArguments(
+        fragmentMs: fragmentMs,
+        packetDurationMs: packetDurationMs,
+        maxQueuedPackets: maxQueuedPackets,
+        overflowPolicy: overflowPolicy,
+      ),
+    );
+    yield* systemSoundEventChannel.receiveBroadcastStream().map(
+      _decodePcmBytes,
+    );
+  }
+
+  @override
+  Stream<Float32List> startRecordingFloat32({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
+    await methodChannel.invokeMethod(
+      'startRecording',
+      _captureArguments(
+        format: 'float32',
+        sampleRate: sampleRate,
+        channels: channels,
+        fragmentMs: fragmentMs,
+        packetDurationMs: packetDurationMs,
+        maxQueuedPackets: maxQueuedPackets,
+        overflowPolicy: overflowPolicy,
+      ),
+    );
+    yield* eventChannel.receiveBroadcastStream().map(_decodeFloat32);
+  }
+
+  @override
+  Stream<Float32List> startSystemSoundCaptureFloat32({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
+    await methodChannel.invokeMethod(
+      'startSystemSoundCapture',
+      _captureArguments(
+        format: 'float32',
+        fragmentMs: fragmentMs,
+        packetDurationMs: packetDurationMs,
+        maxQueuedPackets: maxQueuedPackets,
+        overflowPolicy: overflowPolicy,
+      ),
+    );
+    yield* systemSoundEventChannel.receiveBroadcastStream().map(
+      _decodeFloat32,
+    );
+  }
+
+  @override
+  Future<double> getPlaybackLatency() async {
+    final latency = await methodChannel.invokeMethod<double>(
+      'getPlaybackLatency',
+    );
+    return latency ?? 0.0;
+  }
+
+  @override
+  Future<Map<String, int>> getDroppedFrames() async {
+    final result = await methodChannel.invokeMapMethod<String, int>(
+      'getDroppedFrames',
+    );
+    return result ?? const {};
+  }
+
+  @override
+  Future<bool> preconnect(String url) async {
+    final result = await methodChannel.invokeMethod<bool>('preconnect', {
+      'url': url,
+    });
+    return result ?? false;
+  }
+
+  @override
+  Future<void> setPcmCacheBudget(int bytes) async {
+    await methodChannel.invokeMethod('setPcmCacheBudget', {'bytes': bytes});
+  }
+
+  @override
+  Future<Map<String, int>> getPcmCacheStats() async {
+    final result = await methodChannel.invokeMapMethod<String, int>(
+      'getPcmCacheStats',
+    );
+    return result ?? const {};
+  }
+
+  @override
+  Future<void> startRecordingToRing({int? ringCapacityBytes}) async {
+    await methodChannel.invokeMethod('startRecording', {
+      'transport': 'ring',
+      if (ringCapacityBytes != null) 'ringCapacityBytes': ringCapacityBytes,
+    });
+  }
+
+  @override
+  Future<void> startSystemSoundCaptureToRing({int? ringCapacityBytes}) async {
+    await methodChannel.invokeMethod('startSystemSoundCapture', {
+      'transport': 'ring',
+      if (ringCapacityBytes != null) 'ringCapacityBytes': ringCapacityBytes,
     });
   }
 
   @override
   Stream<List<int>> startPlaybackStream(String path) async* {
     await methodChannel.invokeMethod('startPlaybackStream', {'path': path});
-    yield* playbackEventChannel.receiveBroadcastStream().map((event) {
-      final list = event as List<dynamic>;
-      return list.map((e) => e as int).toList();
+    yield* playbackEventChannel.receiveBroadcastStream().map(
+      _decodePcmBytes,
+    );
+  }
+
+  @override
+  Stream<PlaybackStateEvent> playbackStateEvents() {
+    return playbackStateEventChannel.receiveBroadcastStream().map((event) {
+      final map = event as Map<dynamic, dynamic>;
+      return PlaybackStateEvent(
+        PlaybackState.values.byName(map['event'] as String),
+        (map['position'] as num).toDouble(),
+      );
     });
   }
+
+  /// Builds the argument map shared by the capture methods.
+  static Map<String, Object> _captureArguments({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    String? format,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    return {
+      if (sampleRate != null) 'sampleRate': sampleRate,
+      if (channels != null) 'channels': channels,
+      if (fragmentMs != null) 'fragmentMs': fragmentMs,
+      if (format != null) 'format': format,
+      if (packetDurationMs != null) 'packetDurationMs': packetDurationMs,
+      if (maxQueuedPackets != null) 'maxQueuedPackets': maxQueuedPackets,
+      if (overflowPolicy != null) 'overflowPolicy': overflowPolicy.name,
+    };
+  }
+
+  /// Decodes a PCM packet received on one of the audio event channels.
+  ///
+  /// Desktop platforms deliver packets as a [Uint8List], which is passed
+  /// through without copying. Platforms that still send a plain list of byte
+  /// values are converted element by element.
+  static List<int> _decodePcmBytes(dynamic event) {
+    if (event is Uint8List) {
+      return event;
+    }
+    final list = event as List<dynamic>;
+    return list.map((e) => e as int).toList();
+  }
+
+  /// Decodes a float32 packet received on a capture event channel.
+  static Float32List _decodeFloat32(dynamic event) {
+    if (event is Float32List) {
+      return event;
+    }
+    final list = event as List<dynamic>;
+    return Float32List.fromList(
+      list.map((e) => (e as num).toDouble()).toList(),
+    );
+  }
 }
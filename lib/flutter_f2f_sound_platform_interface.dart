@@ -1,7 +1,58 @@
+import 'package:flutter/foundation.dart';
 import 'package:plugin_platform_interface/plugin_platform_interface.dart';
 
 import 'flutter_f2f_sound_method_channel.dart';
 
+/// What a capture stream does when the Dart listener falls behind and the
+/// native queue of undelivered packets is full.
+enum CaptureOverflowPolicy {
+  /// Discard the oldest queued packet, keeping latency bounded.
+  dropOldest,
+
+  /// Discard the packet being captured.
+  dropNewest,
+
+  /// Stall the capture thread until packets are delivered. Intended for
+  /// offline processing where frames should not be lost. On Windows the
+  /// wait is capped at 200 ms, after which the packet is dropped.
+  block,
+}
+
+/// Buffering state of the current playback, reported by
+/// [FlutterF2fSoundPlatform.playbackStateEvents].
+enum PlaybackState {
+  /// A network source is filling its pre-buffer; no audio plays yet.
+  buffering,
+
+  /// Enough audio is decoded and playback is running.
+  ready,
+
+  /// The decoder ran dry before the end of the source; silence plays until
+  /// more audio arrives.
+  underrun,
+}
+
+/// A change of [PlaybackState] at [position] seconds into the track.
+@immutable
+class PlaybackStateEvent {
+  const PlaybackStateEvent(this.state, this.position);
+
+  final PlaybackState state;
+  final double position;
+
+  @override
+  String toString() => 'PlaybackStateEvent($state, $position)';
+}
+
+/// Sample format of the audio fed to a PCM sink.
+enum PcmSampleFormat {
+  /// Signed 16-bit samples, fed as an `Int16List`.
+  int16,
+
+  /// Samples in -1.0 to 1.0, fed as a `Float32List`.
+  float32,
+}
+
 abstract class FlutterF2fSoundPlatform extends PlatformInterface {
   /// Constructs a FlutterF2fSoundPlatform.
   FlutterF2fSoundPlatform() : super(token: _token);
@@ -28,14 +79,161 @@ abstract class FlutterF2fSoundPlatform extends PlatformInterface {
   }
 
   /// Play audio from the given path
+  ///
+  /// [latencyMs] requests a target output buffer; the buffer actually granted
+  /// is reported by [getPlaybackLatency].
+  ///
+  /// Network sources start playing once [prebufferMs] of audio has been
+  /// decoded, while the rest is still downloading.
   Future<void> play({
     required String path,
     double volume = 1.0,
     bool loop = false,
+    int? latencyMs,
+    int? prebufferMs,
   }) {
     throw UnimplementedError('play() has not been implemented.');
   }
 
+  /// Play encoded audio held in memory, such as generated speech.
+  ///
+  /// Containers (WAV, FLAC, Ogg) are recognised from their header. Headerless
+  /// PCM needs [mimeHint]: `audio/L16` or `audio/L24` (big-endian) or
+  /// `audio/pcm` (little-endian 16-bit), each with `rate` and optional
+  /// `channels` parameters, e.g. `audio/pcm; rate=24000; channels=1`.
+  Future<void> playBytes(
+    Uint8List bytes, {
+    String? mimeHint,
+    double volume = 1.0,
+    int? latencyMs,
+  }) {
+    throw UnimplementedError('playBytes() has not been implemented.');
+  }
+
+  /// Start playing interleaved PCM that arrives a piece at a time, such as a
+  /// call or speech being synthesized, and return a handle for feeding it.
+  ///
+  /// Playback starts once [targetLatencyMs] of audio is buffered. When the
+  /// feed falls behind, the output fades to silence and rebuffers, and the
+  /// target grows with each underrun. Audio buffered beyond [maxLatencyMs]
+  /// (twice the target by default, never when 0) is dropped.
+  Future<int> openPcmSink({
+    required int sampleRate,
+    int channels = 1,
+    PcmSampleFormat format = PcmSampleFormat.int16,
+    int targetLatencyMs = 40,
+    int? maxLatencyMs,
+    double volume = 1.0,
+    int? latencyMs,
+  }) {
+    throw UnimplementedError('openPcmSink() has not been implemented.');
+  }
+
+  /// Append [samples] to the sink opened as [handle]: an `Int16List` or a
+  /// `Float32List` matching its format. Completes with the number of frames
+  /// that fitted in the buffer.
+  Future<int> feedPcmSink(int handle, TypedData samples) {
+    throw UnimplementedError('feedPcmSink() has not been implemented.');
+  }
+
+  /// Let the sink play out what it holds and then finish.
+  Future<void> closePcmSink(int handle) {
+    throw UnimplementedError('closePcmSink() has not been implemented.');
+  }
+
+  /// Counters of the sink opened as [handle], in frames.
+  Future<Map<String, int>> getPcmSinkStats(int handle) {
+    throw UnimplementedError('getPcmSinkStats() has not been implemented.');
+  }
+
+  /// Start the sound effect mixer's output stream, which otherwise starts
+  /// with the first [playSound]. Its [latencyMs] is the delay between
+  /// starting a sound and hearing it.
+  Future<void> startMixer({int sampleRate = 48000, int? latencyMs}) {
+    throw UnimplementedError('startMixer() has not been implemented.');
+  }
+
+  /// Stop the mixer's output stream and every sound in it.
+  Future<void> stopMixer() {
+    throw UnimplementedError('stopMixer() has not been implemented.');
+  }
+
+  /// Play a local file as a sound effect, over the track and any other
+  /// sounds, and return the id of its voice.
+  Future<int> playSound(
+    String path, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) {
+    throw UnimplementedError('playSound() has not been implemented.');
+  }
+
+  /// Change the parameters given for a playing voice. Completes with false
+  /// once the voice has finished.
+  Future<bool> setVoice(
+    int voice, {
+    double? gain,
+    double? pan,
+    double? rate,
+    bool? loop,
+  }) {
+    throw UnimplementedError('setVoice() has not been implemented.');
+  }
+
+  /// Fade a voice out and end it.
+  Future<bool> stopVoice(int voice) {
+    throw UnimplementedError('stopVoice() has not been implemented.');
+  }
+
+  /// Fade out and end every voice.
+  Future<void> stopAllVoices() {
+    throw UnimplementedError('stopAllVoices() has not been implemented.');
+  }
+
+  /// Whether [voice] is still playing.
+  Future<bool> isVoicePlaying(int voice) {
+    throw UnimplementedError('isVoicePlaying() has not been implemented.');
+  }
+
+  /// Mixer counters.
+  Future<Map<String, int>> getMixerStats() {
+    throw UnimplementedError('getMixerStats() has not been implemented.');
+  }
+
+  /// Decode a local file into the sample bank, at the mixer's output rate,
+  /// and return its id for [triggerSample].
+  Future<int> loadSample(String path) {
+    throw UnimplementedError('loadSample() has not been implemented.');
+  }
+
+  /// Play a loaded sample on a new mixer voice and return the voice id.
+  Future<int> triggerSample(
+    int id, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) {
+    throw UnimplementedError('triggerSample() has not been implemented.');
+  }
+
+  /// Drop a sample from the bank. Voices playing it finish first.
+  Future<bool> unloadSample(int id) {
+    throw UnimplementedError('unloadSample() has not been implemented.');
+  }
+
+  /// Set the memory budget of the sample bank, in bytes.
+  Future<void> setSampleBankBudget(int bytes) {
+    throw UnimplementedError('setSampleBankBudget() has not been implemented.');
+  }
+
+  /// Sample bank counters.
+  Future<Map<String, int>> getSampleBankStats() {
+    throw UnimplementedError('getSampleBankStats() has not been implemented.');
+  }
+
   /// Pause the currently playing audio
   Future<void> pause() {
     throw UnimplementedError('pause() has not been implemented.');
@@ -51,6 +249,11 @@ abstract class FlutterF2fSoundPlatform extends PlatformInterface {
     throw UnimplementedError('resume() has not been implemented.');
   }
 
+  /// Move the current playback to [position] seconds
+  Future<void> seek(double position) {
+    throw UnimplementedError('seek() has not been implemented.');
+  }
+
   /// Set the volume of the currently playing audio (0.0 to 1.0)
   Future<void> setVolume(double volume) {
     throw UnimplementedError('setVolume() has not been implemented.');
@@ -72,12 +275,108 @@ abstract class FlutterF2fSoundPlatform extends PlatformInterface {
   }
 
   // 音频录制流
-  Stream<List<int>> startRecording();
+  //
+  // [sampleRate] and [channels] select the capture format where the platform
+  // supports it. [fragmentMs] is the capture buffer the platform fills
+  // before each read; 5-10 ms keeps latency low.
+  //
+  // [packetDurationMs] gathers captured frames into packets of exactly that
+  // duration before they are delivered. Omit it to receive packets as the
+  // audio backend produces them.
+  //
+  // At most [maxQueuedPackets] packets wait natively for delivery; when the
+  // queue is full [overflowPolicy] decides what happens. Dropped frames are
+  // reported by [getDroppedFrames].
+  Stream<List<int>> startRecording({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  });
   Future<void> stopRecording();
 
   // 系统声音捕获流
-  Stream<List<int>> startSystemSoundCapture();
+  Stream<List<int>> startSystemSoundCapture({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  });
+
+  /// Start audio recording with samples delivered as normalized float32
+  Stream<Float32List> startRecordingFloat32({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    throw UnimplementedError('startRecordingFloat32() has not been implemented.');
+  }
+
+  /// Start system sound capture with samples delivered as normalized float32
+  Stream<Float32List> startSystemSoundCaptureFloat32({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) {
+    throw UnimplementedError(
+        'startSystemSoundCaptureFloat32() has not been implemented.');
+  }
+
+  /// Output buffering, in milliseconds, granted for the current playback.
+  Future<double> getPlaybackLatency() {
+    throw UnimplementedError('getPlaybackLatency() has not been implemented.');
+  }
+
+  /// Frames dropped by each stream since it started, keyed by `recording`,
+  /// `systemSound` and `playback` on every platform.
+  Future<Map<String, int>> getDroppedFrames() {
+    throw UnimplementedError('getDroppedFrames() has not been implemented.');
+  }
+
+  /// Memory budget, in bytes, for decoded audio of short local files kept
+  /// between plays. 0 disables the cache.
+  Future<void> setPcmCacheBudget(int bytes) {
+    throw UnimplementedError('setPcmCacheBudget() has not been implemented.');
+  }
+
+  /// Counters of the decoded audio cache, keyed by `hits`, `misses`,
+  /// `evictions`, `entries`, `bytes` and `budgetBytes`.
+  Future<Map<String, int>> getPcmCacheStats() {
+    throw UnimplementedError('getPcmCacheStats() has not been implemented.');
+  }
+
+  /// Opens a connection to the origin of [url] ahead of the first fetch so
+  /// that it skips the DNS, TCP and TLS handshakes. Completes with whether
+  /// the connection could be made.
+  Future<bool> preconnect(String url) {
+    throw UnimplementedError('preconnect() has not been implemented.');
+  }
+
+  /// Start audio recording into the native shared-memory capture ring.
+  ///
+  /// PCM is not sent over the event channel; read it in place with
+  /// `CaptureRingReader` from `flutter_f2f_sound_ring.dart`.
+  Future<void> startRecordingToRing({int? ringCapacityBytes}) {
+    throw UnimplementedError('startRecordingToRing() has not been implemented.');
+  }
+
+  /// Start system sound capture into the native shared-memory capture ring.
+  Future<void> startSystemSoundCaptureToRing({int? ringCapacityBytes}) {
+    throw UnimplementedError(
+        'startSystemSoundCaptureToRing() has not been implemented.');
+  }
 
   // 音频播放流
   Stream<List<int>> startPlaybackStream(String path);
+
+  /// Buffering and underrun events of the current playback.
+  Stream<PlaybackStateEvent> playbackStateEvents() {
+    throw UnimplementedError('playbackStateEvents() has not been implemented.');
+  }
 }
@@ -0,0 +1,108 @@
+import 'dart:ffi';
+import 'dart:typed_data';
+
+/// Capture sessions that can publish PCM into a native shared-memory ring.
+///
+/// The indices match `FLUTTER_F2F_SOUND_RING_*` in the Linux plugin header.
+enum CaptureRingId { recording, systemSound }
+
+/// Mirrors `FlutterF2fSoundRingState` in the Linux plugin header.
+final class _RingState extends Struct {
+  external Pointer<Uint8> data;
+
+  @Uint64()
+  external int capacity;
+
+  @Uint64()
+  external int writeIndex;
+
+  @Uint64()
+  external int readIndex;
+
+  @Uint64()
+  external int sessionStartIndex;
+
+  @Uint64()
+  external int overrunBytes;
+
+  @Uint64()
+  external int overrunCount;
+
+  @Int32()
+  external int notifyFd;
+}
+
+/// Reads captured PCM in place from a native capture ring (Linux only).
+///
+/// Start the session with `startRecordingToRing()` or
+/// `startSystemSoundCaptureToRing()`, then call [readable] to get views of
+/// the unread bytes and [consume] once they have been processed. Nothing is
+/// copied between the native capture callback and the views.
+///
+/// Dart code polls: call [readable] from a periodic `Timer` (or once per
+/// frame) at an interval well below the time the ring takes to fill, which
+/// is two seconds with the default capacity. Check [overrunBytes] to see
+/// whether the interval is short enough.
+class CaptureRingReader {
+  CaptureRingReader(this.id);
+
+  final CaptureRingId id;
+
+  static final DynamicLibrary _library = DynamicLibrary.open(
+    'libflutter_f2f_sound_plugin.so',
+  );
+
+  static final _RingState Function(int) _state = _library
+      .lookupFunction<_RingState Function(Int32), _RingState Function(int)>(
+        'flutter_f2f_sound_ring_state',
+      );
+
+  static final void Function(int, int) _consume = _library
+      .lookupFunction<Void Function(Int32, Uint64), void Function(int, int)>(
+        'flutter_f2f_sound_ring_consume',
+      );
+
+  /// Returns views over the unread bytes: one view, or two when the data
+  /// wraps past the end of the ring. The views stay valid until the bytes
+  /// are released with [consume].
+  ///
+  /// Bytes an earlier session left unread are consumed first, so the views
+  /// only ever hold the current session's audio.
+  List<Uint8List> readable() {
+    var state = _state(id.index);
+    if (state.data == nullptr) {
+      return const [];
+    }
+    if (state.readIndex < state.sessionStartIndex) {
+      _consume(id.index, state.sessionStartIndex - state.readIndex);
+      state = _state(id.index);
+    }
+
+    final ring = state.data.asTypedList(state.capacity);
+    final start = state.readIndex & (state.capacity - 1);
+    final length = state.writeIndex - state.readIndex;
+    final first = length < state.capacity - start
+        ? length
+        : state.capacity - start;
+
+    return [
+      if (first > 0) Uint8List.sublistView(ring, start, start + first),
+      if (length > first) Uint8List.sublistView(ring, 0, length - first),
+    ];
+  }
+
+  /// Releases [bytes] read bytes back to the native producer.
+  void consume(int bytes) => _consume(id.index, bytes);
+
+  /// Bytes dropped because the reader fell behind.
+  int get overrunBytes => _state(id.index).overrunBytes;
+
+  /// Number of native writes that dropped bytes.
+  int get overrunCount => _state(id.index).overrunCount;
+
+  /// An eventfd signalled after every native write, or -1.
+  ///
+  /// For native readers only: plain Dart has no way to wait on a file
+  /// descriptor, so Dart readers poll [readable] instead.
+  int get notifyFd => _state(id.index).notifyFd;
+}
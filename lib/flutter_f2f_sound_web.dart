@@ -121,6 +121,8 @@ class FlutterF2fSoundWeb extends FlutterF2fSoundPlatform {
     required String path,
     double volume = 1.0,
     bool loop = false,
+    int? latencyMs,
+    int? prebufferMs,
   }) async {
     try {
       // Stop any currently playing audio
@@ -189,6 +191,12 @@ class FlutterF2fSoundWeb extends FlutterF2fSoundPlatform {
     _audioElement?.play();
   }
 
+  /// Move the current playback to [position] seconds
+  @override
+  Future<void> seek(double position) async {
+    _audioElement?.currentTime = position;
+  }
+
   /// Set the volume of the currently playing audio (0.0 to 1.0)
   @override
   Future<void> setVolume(double volume) async {
@@ -218,12 +226,41 @@ class FlutterF2fSoundWeb extends FlutterF2fSoundPlatform {
     return 0.0;
   }
 
+  /// Hint the browser to connect to the origin of [url] ahead of a fetch
+  ///
+  /// Adds a `<link rel="preconnect">` to the document head; the browser
+  /// decides whether and when to connect, so this completes with true
+  /// unless [url] has no origin.
+  @override
+  Future<bool> preconnect(String url) async {
+    final uri = Uri.tryParse(url.contains('://') ? url : 'https://$url');
+    if (uri == null || uri.host.isEmpty) {
+      return false;
+    }
+    final link = HTMLLinkElement()
+      ..rel = 'preconnect'
+      ..href = uri.origin
+      ..crossOrigin = 'anonymous';
+    document.head?.append(link);
+    return true;
+  }
+
   /// Start audio recording and get a stream of recorded audio data
   ///
   /// Uses Web Audio API with ScriptProcessorNode to capture raw PCM audio data.
   /// Returns 16-bit PCM audio samples (mono, typically 44100 or 48000 Hz).
+  /// The native capture options ([sampleRate], [channels], [fragmentMs],
+  /// [packetDurationMs], [maxQueuedPackets], [overflowPolicy]) are ignored;
+  /// packets follow the processor buffer size.
   @override
-  Stream<List<int>> startRecording() async* {
+  Stream<List<int>> startRecording({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
     try {
       // Request microphone access
       final stream = await window.navigator.mediaDevices.getUserMedia(
@@ -327,7 +364,12 @@ class FlutterF2fSoundWeb extends FlutterF2fSoundPlatform {
   ///
   /// Note: On web, system sound capture is not supported due to browser security restrictions.
   @override
-  Stream<List<int>> startSystemSoundCapture() async* {
+  Stream<List<int>> startSystemSoundCapture({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
     throw UnimplementedError(
       'System sound capture is not supported on web platform due to browser security restrictions. '
       'This feature requires native platform access (Android/iOS/Windows/Desktop). '
@@ -0,0 +1,28 @@
+#include "audio_backend.h"
+
+#include <glib.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+std::unique_ptr<AudioBackend> audio_backend_new_from_environment(const char* wav_suffix) {
+  const char* backend = getenv("F2F_SOUND_BACKEND");
+  if (!backend || strcmp(backend, "pulse") == 0) {
+    return audio_backend_new_pulse();
+  }
+
+  const char* clock = getenv("F2F_SOUND_CLOCK");
+  const bool realtime = !clock || strcmp(clock, "fast") != 0;
+
+  if (strcmp(backend, "null") == 0) {
+    return audio_backend_new_null(nullptr, realtime);
+  }
+  if (strncmp(backend, "wav:", 4) == 0 && backend[4] != '\0') {
+    const std::string path = std::string(backend + 4) + wav_suffix;
+    return audio_backend_new_null(path.c_str(), realtime);
+  }
+
+  g_printerr("Unknown F2F_SOUND_BACKEND \"%s\", using PulseAudio\n", backend);
+  return audio_backend_new_pulse();
+}
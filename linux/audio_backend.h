@@ -0,0 +1,92 @@
+#ifndef FLUTTER_PLUGIN_AUDIO_BACKEND_H_
+#define FLUTTER_PLUGIN_AUDIO_BACKEND_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// Parameters of an interleaved s16 stream.
+struct AudioStreamConfig {
+  int sample_rate = 44100;
+  int channels = 2;
+  int latency_ms = 0;   // Playback buffering target; 0 = backend default
+  int fragment_ms = 0;  // Capture delivery size; 0 = backend default
+};
+
+// Largest rate and channel count any backend accepts.
+constexpr int kMaxBackendSampleRate = 384000;
+constexpr int kMaxBackendChannels = 32;
+
+inline bool audio_stream_config_valid(const AudioStreamConfig& config) {
+  return config.sample_rate > 0 && config.sample_rate <= kMaxBackendSampleRate &&
+         config.channels > 0 && config.channels <= kMaxBackendChannels;
+}
+
+enum class CaptureSource {
+  kMicrophone,   // Default input device
+  kSystemSound,  // Loopback of the default output device
+};
+
+// Fills all |length| bytes of |buffer| with the next output period. |length|
+// is always a whole number of frames.
+typedef void (*AudioRenderCallback)(uint8_t* buffer, size_t length, void* user_data);
+
+// Receives |length| bytes of captured audio.
+typedef void (*AudioCaptureCallback)(const uint8_t* data, size_t length, void* user_data);
+
+// Device layer under the playback and capture engine.
+//
+// A backend owns one audio thread. Render and capture callbacks run on that
+// thread with the backend lock held, so other threads call lock() before
+// touching state the callbacks read, and the stream methods below must be
+// called with the lock held. Callbacks must not call back into the backend.
+class AudioBackend {
+ public:
+  virtual ~AudioBackend() = default;
+
+  virtual const char* name() const = 0;
+
+  // Connects to the device or sound server. Safe to call again once open.
+  virtual bool open() = 0;
+
+  // Stops every stream and releases the device. Called without the lock.
+  virtual void close() = 0;
+
+  virtual void lock() = 0;
+  virtual void unlock() = 0;
+
+  // Replaces the playback stream; |render| is called for every period.
+  virtual bool start_playback(const AudioStreamConfig& config, AudioRenderCallback render,
+                              void* user_data) = 0;
+  virtual void set_playback_paused(bool paused) = 0;
+  virtual void stop_playback() = 0;
+
+  // Replaces the capture stream for |source|.
+  virtual bool start_capture(CaptureSource source, const AudioStreamConfig& config,
+                             AudioCaptureCallback capture, void* user_data) = 0;
+  virtual void stop_capture(CaptureSource source) = 0;
+
+  // Output clock: frames handed to the device since playback started.
+  virtual uint64_t playback_frames() const = 0;
+
+  // Output buffering granted for the current playback, or 0 until known.
+  virtual double playback_latency_ms() const = 0;
+};
+
+// Plays and records through PulseAudio on a threaded mainloop.
+std::unique_ptr<AudioBackend> audio_backend_new_pulse();
+
+// Runs without a device. Playback is rendered and discarded, or appended to
+// a WAV file when |wav_path| is set; capture delivers silence. With
+// |realtime| the audio thread keeps wall-clock pace, otherwise it renders as
+// fast as the callbacks allow, for headless benchmarks and soak tests.
+std::unique_ptr<AudioBackend> audio_backend_new_null(const char* wav_path, bool realtime);
+
+// Chooses a backend from the environment:
+//   F2F_SOUND_BACKEND=pulse (default) | null | wav:<path>
+//   F2F_SOUND_CLOCK=realtime (default) | fast   (null and wav only)
+// |wav_suffix| is appended to a wav path, so that a second backend writes a
+// file of its own.
+std::unique_ptr<AudioBackend> audio_backend_new_from_environment(const char* wav_suffix = "");
+
+#endif  // FLUTTER_PLUGIN_AUDIO_BACKEND_H_
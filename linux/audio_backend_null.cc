@@ -0,0 +1,280 @@
+#include "audio_backend.h"
+
+#include <glib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// The audio thread wakes this often and runs every period that fell due.
+constexpr int kTickMs = 5;
+
+// Period used when a stream does not ask for a latency or fragment size.
+constexpr int kDefaultPeriodMs = 10;
+
+// Streams interleaved s16 into a canonical 44-byte-header WAV file. The size
+// fields are patched when the file is finished.
+class WavWriter {
+ public:
+  ~WavWriter() { finish(); }
+
+  bool open(const std::string& path, int sample_rate, int channels) {
+    finish();
+    file_ = fopen(path.c_str(), "wb");
+    if (!file_) {
+      g_printerr("Failed to open WAV output: %s\n", path.c_str());
+      return false;
+    }
+    data_bytes_ = 0;
+    write_header(sample_rate, channels);
+    return true;
+  }
+
+  void write(const uint8_t* data, size_t length) {
+    if (file_) {
+      data_bytes_ += fwrite(data, 1, length, file_);
+    }
+  }
+
+  void finish() {
+    if (!file_) {
+      return;
+    }
+    fseek(file_, 4, SEEK_SET);
+    write_u32(36 + data_bytes_);
+    fseek(file_, 40, SEEK_SET);
+    write_u32(data_bytes_);
+    fclose(file_);
+    file_ = nullptr;
+  }
+
+ private:
+  void write_u16(uint16_t value) {
+    const uint8_t bytes[] = {(uint8_t)value, (uint8_t)(value >> 8)};
+    fwrite(bytes, 1, sizeof(bytes), file_);
+  }
+
+  void write_u32(uint32_t value) {
+    const uint8_t bytes[] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16),
+                             (uint8_t)(value >> 24)};
+    fwrite(bytes, 1, sizeof(bytes), file_);
+  }
+
+  void write_header(int sample_rate, int channels) {
+    const uint16_t block_align = (uint16_t)(channels * sizeof(int16_t));
+    fwrite("RIFF", 1, 4, file_);
+    write_u32(36);
+    fwrite("WAVEfmt ", 1, 8, file_);
+    write_u32(16);
+    write_u16(1);  // PCM
+    write_u16((uint16_t)channels);
+    write_u32((uint32_t)sample_rate);
+    write_u32((uint32_t)sample_rate * block_align);
+    write_u16(block_align);
+    write_u16(16);
+    fwrite("data", 1, 4, file_);
+    write_u32(0);
+  }
+
+  FILE* file_ = nullptr;
+  uint32_t data_bytes_ = 0;
+};
+
+// One simulated device stream. Time is kept in frames * 1000 so rates that
+// are not a multiple of 1000 Hz stay exact.
+struct NullStream {
+  bool active = false;
+  int sample_rate = 0;
+  uint64_t period_frames = 0;
+  uint64_t due = 0;
+  std::vector<uint8_t> buffer;  // One period
+
+  void reset(const AudioStreamConfig& config, int period_ms) {
+    active = true;
+    sample_rate = config.sample_rate;
+    period_frames = std::max<uint64_t>((uint64_t)config.sample_rate * period_ms / 1000, 1);
+    due = 0;
+    buffer.assign(period_frames * config.channels * sizeof(int16_t), 0);
+  }
+
+  // Advances the stream by one tick and returns how many periods fell due.
+  uint64_t tick() {
+    due += (uint64_t)sample_rate * kTickMs;
+    uint64_t periods = due / (period_frames * 1000);
+    due -= periods * period_frames * 1000;
+    return periods;
+  }
+};
+
+class NullBackend final : public AudioBackend {
+ public:
+  NullBackend(const char* wav_path, bool realtime)
+      : wav_path_(wav_path ? wav_path : ""), realtime_(realtime) {}
+  ~NullBackend() override { close(); }
+
+  const char* name() const override { return wav_path_.empty() ? "null" : "wav"; }
+
+  bool open() override {
+    if (!thread_.joinable()) {
+      quit_ = false;
+      thread_ = std::thread(&NullBackend::run, this);
+    }
+    return true;
+  }
+
+  void close() override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      quit_ = true;
+      playback_.active = false;
+      microphone_.stream.active = false;
+      system_sound_.stream.active = false;
+    }
+    wake_.notify_all();
+    if (thread_.joinable()) {
+      thread_.join();
+    }
+    wav_.finish();
+  }
+
+  void lock() override { mutex_.lock(); }
+  void unlock() override { mutex_.unlock(); }
+
+  bool start_playback(const AudioStreamConfig& config, AudioRenderCallback render,
+                      void* user_data) override {
+    const int period_ms = config.latency_ms > 0 ? config.latency_ms : kDefaultPeriodMs;
+    if (!wav_path_.empty() && !wav_.open(wav_path_, config.sample_rate, config.channels)) {
+      return false;
+    }
+    playback_.reset(config, period_ms);
+    render_ = render;
+    render_user_data_ = user_data;
+    paused_ = false;
+    playback_frames_ = 0;
+    playback_latency_ms_ = period_ms;
+    wake_.notify_all();
+    return true;
+  }
+
+  void set_playback_paused(bool paused) override {
+    paused_ = paused;
+    wake_.notify_all();
+  }
+
+  void stop_playback() override {
+    playback_.active = false;
+    wav_.finish();
+  }
+
+  bool start_capture(CaptureSource source, const AudioStreamConfig& config,
+                     AudioCaptureCallback capture, void* user_data) override {
+    NullCapture& stream = capture_stream(source);
+    stream.stream.reset(config, config.fragment_ms > 0 ? config.fragment_ms : kDefaultPeriodMs);
+    stream.callback = capture;
+    stream.user_data = user_data;
+    wake_.notify_all();
+    return true;
+  }
+
+  void stop_capture(CaptureSource source) override {
+    capture_stream(source).stream.active = false;
+  }
+
+  uint64_t playback_frames() const override { return playback_frames_.load(); }
+  double playback_latency_ms() const override { return playback_latency_ms_.load(); }
+
+ private:
+  struct NullCapture {
+    NullStream stream;
+    AudioCaptureCallback callback = nullptr;
+    void* user_data = nullptr;
+  };
+
+  NullCapture& capture_stream(CaptureSource source) {
+    return source == CaptureSource::kMicrophone ? microphone_ : system_sound_;
+  }
+
+  bool idle() const {
+    return (!playback_.active || paused_) && !microphone_.stream.active &&
+           !system_sound_.stream.active;
+  }
+
+  // Captured "audio" is silence, delivered at the stream's pace.
+  void run_capture(NullCapture& capture) {
+    if (!capture.stream.active) {
+      return;
+    }
+    for (uint64_t periods = capture.stream.tick(); periods > 0; periods--) {
+      capture.callback(capture.stream.buffer.data(), capture.stream.buffer.size(),
+                       capture.user_data);
+    }
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto next_tick = std::chrono::steady_clock::now();
+
+    while (!quit_) {
+      if (idle()) {
+        wake_.wait(lock);
+        next_tick = std::chrono::steady_clock::now();
+        continue;
+      }
+
+      if (playback_.active && !paused_) {
+        for (uint64_t periods = playback_.tick(); periods > 0; periods--) {
+          render_(playback_.buffer.data(), playback_.buffer.size(), render_user_data_);
+          wav_.write(playback_.buffer.data(), playback_.buffer.size());
+          playback_frames_ += playback_.period_frames;
+        }
+      }
+      run_capture(microphone_);
+      run_capture(system_sound_);
+
+      if (realtime_) {
+        next_tick += std::chrono::milliseconds(kTickMs);
+        while (!quit_ && std::chrono::steady_clock::now() < next_tick) {
+          wake_.wait_until(lock, next_tick);
+        }
+      } else {
+        // Let other threads take the lock between ticks
+        lock.unlock();
+        std::this_thread::yield();
+        lock.lock();
+      }
+    }
+  }
+
+  const std::string wav_path_;
+  const bool realtime_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  bool quit_ = false;
+
+  NullStream playback_;
+  bool paused_ = false;
+  AudioRenderCallback render_ = nullptr;
+  void* render_user_data_ = nullptr;
+  WavWriter wav_;
+  std::atomic<uint64_t> playback_frames_{0};
+  std::atomic<double> playback_latency_ms_{0.0};
+
+  NullCapture microphone_;
+  NullCapture system_sound_;
+};
+
+}  // namespace
+
+std::unique_ptr<AudioBackend> audio_backend_new_null(const char* wav_path, bool realtime) {
+  return std::unique_ptr<AudioBackend>(new NullBackend(wav_path, realtime));
+}
@@ -0,0 +1,425 @@
+#include "audio_backend.h"
+
+#include <glib.h>
+#include <pthread.h>
+#include <pulse/pulseaudio.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Releases an operation whose completion we do not wait for.
+void drop_operation(pa_operation* operation) {
+  if (operation) {
+    pa_operation_unref(operation);
+  }
+}
+
+// Disconnects and releases a stream. Called with the mainloop lock held.
+void release_stream(pa_stream** stream) {
+  if (*stream) {
+    pa_stream_set_write_callback(*stream, nullptr, nullptr);
+    pa_stream_set_read_callback(*stream, nullptr, nullptr);
+    pa_stream_set_state_callback(*stream, nullptr, nullptr);
+    pa_stream_disconnect(*stream);
+    pa_stream_unref(*stream);
+    *stream = nullptr;
+  }
+}
+
+pa_sample_spec sample_spec_for(const AudioStreamConfig& config) {
+  pa_sample_spec ss;
+  ss.format = PA_SAMPLE_S16LE;
+  ss.rate = (uint32_t)config.sample_rate;
+  ss.channels = (uint8_t)config.channels;
+  return ss;
+}
+
+// Buffer attributes for a playback stream with |latency_ms| of audio queued
+// in the server. The server asks for more in quarter-buffer requests and
+// starts playing once the first request has been written, so short sounds
+// begin within one request instead of after a full buffer.
+pa_buffer_attr playback_buffer_attr(const pa_sample_spec* ss, int latency_ms) {
+  pa_buffer_attr attr;
+  attr.maxlength = (uint32_t)-1;
+  attr.tlength = (uint32_t)pa_usec_to_bytes((pa_usec_t)latency_ms * 1000, ss);
+  attr.minreq = attr.tlength / 4;
+  attr.prebuf = attr.minreq;
+  attr.fragsize = (uint32_t)-1;
+  return attr;
+}
+
+// Buffer attributes for a capture stream that delivers |fragment_ms| of
+// audio per read callback. Fields left at -1 use the server defaults.
+pa_buffer_attr capture_buffer_attr(const pa_sample_spec* ss, int fragment_ms) {
+  pa_buffer_attr attr;
+  attr.maxlength = (uint32_t)-1;
+  attr.tlength = (uint32_t)-1;
+  attr.prebuf = (uint32_t)-1;
+  attr.minreq = (uint32_t)-1;
+  attr.fragsize = (uint32_t)pa_usec_to_bytes((pa_usec_t)fragment_ms * 1000, ss);
+  return attr;
+}
+
+// Runs once on the mainloop thread to ask for real-time scheduling. This is
+// best effort: without CAP_SYS_NICE or an RLIMIT_RTPRIO allowance the request
+// fails and the thread keeps its normal priority.
+void request_realtime_scheduling(pa_mainloop_api* api, void* userdata) {
+  struct sched_param param = {};
+  param.sched_priority = 5;
+  if (pthread_setschedparam(pthread_self(), SCHED_RR, &param) != 0) {
+    g_print("PulseAudio thread is running without real-time priority\n");
+  }
+}
+
+class PulseBackend final : public AudioBackend {
+ public:
+  PulseBackend() = default;
+  ~PulseBackend() override { close(); }
+
+  const char* name() const override { return "pulse"; }
+
+  bool open() override;
+  void close() override;
+
+  // No-ops until open() has created the mainloop
+  void lock() override {
+    if (mainloop_) {
+      pa_threaded_mainloop_lock(mainloop_);
+    }
+  }
+  void unlock() override {
+    if (mainloop_) {
+      pa_threaded_mainloop_unlock(mainloop_);
+    }
+  }
+
+  bool start_playback(const AudioStreamConfig& config, AudioRenderCallback render,
+                      void* user_data) override;
+  void set_playback_paused(bool paused) override;
+  void stop_playback() override;
+
+  bool start_capture(CaptureSource source, const AudioStreamConfig& config,
+                     AudioCaptureCallback capture, void* user_data) override;
+  void stop_capture(CaptureSource source) override;
+
+  uint64_t playback_frames() const override { return playback_frames_.load(); }
+  double playback_latency_ms() const override { return playback_latency_ms_.load(); }
+
+ private:
+  struct CaptureStream {
+    pa_stream* stream = nullptr;
+    pa_buffer_attr attr = {};  // Used when a monitor source is found
+    AudioCaptureCallback callback = nullptr;
+    void* user_data = nullptr;
+  };
+
+  static void context_state_cb(pa_context* c, void* userdata);
+  static void playback_state_cb(pa_stream* s, void* userdata);
+  static void playback_write_cb(pa_stream* s, size_t nbytes, void* userdata);
+  static void capture_read_cb(pa_stream* s, size_t nbytes, void* userdata);
+  static void monitor_sink_info_cb(pa_context* c, const pa_sink_info* i, int eol,
+                                   void* userdata);
+
+  CaptureStream& capture_stream(CaptureSource source) {
+    return source == CaptureSource::kMicrophone ? microphone_ : monitor_;
+  }
+
+  pa_threaded_mainloop* mainloop_ = nullptr;
+  pa_mainloop_api* mainloop_api_ = nullptr;
+  pa_context* context_ = nullptr;
+
+  pa_stream* playback_stream_ = nullptr;
+  size_t playback_frame_bytes_ = sizeof(int16_t);
+  AudioRenderCallback render_ = nullptr;
+  void* render_user_data_ = nullptr;
+  std::atomic<uint64_t> playback_frames_{0};
+  std::atomic<double> playback_latency_ms_{0.0};
+
+  CaptureStream microphone_;
+  CaptureStream monitor_;
+};
+
+void PulseBackend::context_state_cb(pa_context* c, void* userdata) {
+  auto* backend = static_cast<PulseBackend*>(userdata);
+
+  switch (pa_context_get_state(c)) {
+    case PA_CONTEXT_READY:
+      g_print("PulseAudio context ready\n");
+      break;
+    case PA_CONTEXT_FAILED:
+    case PA_CONTEXT_TERMINATED:
+      g_printerr("PulseAudio context failed or terminated\n");
+      break;
+    default:
+      break;
+  }
+
+  // Wake open(), which waits for the context to settle
+  pa_threaded_mainloop_signal(backend->mainloop_, 0);
+}
+
+bool PulseBackend::open() {
+  if (context_) {
+    return true;
+  }
+
+  mainloop_ = pa_threaded_mainloop_new();
+  if (!mainloop_) {
+    g_printerr("Failed to create PulseAudio mainloop\n");
+    return false;
+  }
+  pa_threaded_mainloop_set_name(mainloop_, "f2f-sound-pulse");
+
+  mainloop_api_ = pa_threaded_mainloop_get_api(mainloop_);
+
+  context_ = pa_context_new(mainloop_api_, "FlutterF2FSound");
+  if (!context_) {
+    g_printerr("Failed to create PulseAudio context\n");
+    close();
+    return false;
+  }
+
+  pa_context_set_state_callback(context_, context_state_cb, this);
+
+  if (pa_context_connect(context_, nullptr, PA_CONTEXT_NOAUTOSPAWN, nullptr) < 0) {
+    g_printerr("Failed to connect to PulseAudio: %s\n", pa_strerror(pa_context_errno(context_)));
+    close();
+    return false;
+  }
+
+  if (pa_threaded_mainloop_start(mainloop_) < 0) {
+    g_printerr("Failed to start PulseAudio mainloop\n");
+    close();
+    return false;
+  }
+
+  // Wait for context to be ready
+  bool ready = false;
+  lock();
+  while (true) {
+    pa_context_state_t state = pa_context_get_state(context_);
+    if (state == PA_CONTEXT_READY) {
+      ready = true;
+      break;
+    }
+    if (!PA_CONTEXT_IS_GOOD(state)) {
+      break;
+    }
+    pa_threaded_mainloop_wait(mainloop_);
+  }
+  if (ready) {
+    pa_mainloop_api_once(mainloop_api_, request_realtime_scheduling, nullptr);
+  }
+  unlock();
+
+  if (!ready) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void PulseBackend::close() {
+  if (!mainloop_) {
+    return;
+  }
+
+  lock();
+  release_stream(&playback_stream_);
+  release_stream(&microphone_.stream);
+  release_stream(&monitor_.stream);
+  if (context_) {
+    pa_context_disconnect(context_);
+    pa_context_unref(context_);
+    context_ = nullptr;
+  }
+  unlock();
+
+  // Stopping joins the mainloop thread, so it must run without the lock
+  pa_threaded_mainloop_stop(mainloop_);
+  pa_threaded_mainloop_free(mainloop_);
+  mainloop_ = nullptr;
+  mainloop_api_ = nullptr;
+}
+
+// Records the buffering the server actually granted once the stream is up.
+void PulseBackend::playback_state_cb(pa_stream* s, void* userdata) {
+  auto* backend = static_cast<PulseBackend*>(userdata);
+  if (pa_stream_get_state(s) != PA_STREAM_READY) {
+    return;
+  }
+
+  const pa_buffer_attr* attr = pa_stream_get_buffer_attr(s);
+  if (attr) {
+    backend->playback_latency_ms_ =
+        pa_bytes_to_usec(attr->tlength, pa_stream_get_sample_spec(s)) / 1000.0;
+    g_print("Playback latency: %.1f ms\n", backend->playback_latency_ms_.load());
+  }
+}
+
+// Renders the next period straight into the server's buffer, so the
+// callback neither allocates nor has PulseAudio copy our data.
+void PulseBackend::playback_write_cb(pa_stream* s, size_t nbytes, void* userdata) {
+  auto* backend = static_cast<PulseBackend*>(userdata);
+  const size_t frame_bytes = backend->playback_frame_bytes_;
+
+  // begin_write may hand out less than was asked for, so keep going until
+  // the request is met
+  size_t remaining = nbytes - nbytes % frame_bytes;
+  while (remaining > 0) {
+    void* buffer = nullptr;
+    size_t chunk = remaining;
+    if (pa_stream_begin_write(s, &buffer, &chunk) < 0 || !buffer) {
+      return;
+    }
+
+    chunk = std::min(chunk, remaining);
+    chunk -= chunk % frame_bytes;
+    if (chunk == 0) {
+      pa_stream_cancel_write(s);
+      return;
+    }
+
+    backend->render_(static_cast<uint8_t*>(buffer), chunk, backend->render_user_data_);
+    pa_stream_write(s, buffer, chunk, nullptr, 0, PA_SEEK_RELATIVE);
+    backend->playback_frames_ += chunk / frame_bytes;
+    remaining -= chunk;
+  }
+}
+
+bool PulseBackend::start_playback(const AudioStreamConfig& config, AudioRenderCallback render,
+                                  void* user_data) {
+  release_stream(&playback_stream_);
+  if (!context_) {
+    return false;
+  }
+
+  render_ = render;
+  render_user_data_ = user_data;
+  playback_frame_bytes_ = config.channels * sizeof(int16_t);
+  playback_frames_ = 0;
+  playback_latency_ms_ = 0.0;
+
+  pa_sample_spec ss = sample_spec_for(config);
+  playback_stream_ = pa_stream_new(context_, "FlutterF2FSound Playback", &ss, nullptr);
+  if (!playback_stream_) {
+    return false;
+  }
+
+  pa_stream_set_write_callback(playback_stream_, playback_write_cb, this);
+  pa_stream_set_state_callback(playback_stream_, playback_state_cb, this);
+
+  // Connect stream to default output, with server-default buffering unless
+  // a target latency was requested. Connected uncorked: a cork request is
+  // refused until the stream is ready, so playback starts on its own
+  pa_buffer_attr attr = playback_buffer_attr(&ss, config.latency_ms);
+  if (pa_stream_connect_playback(
+          playback_stream_,
+          nullptr,
+          config.latency_ms > 0 ? &attr : nullptr,
+          config.latency_ms > 0 ? PA_STREAM_ADJUST_LATENCY : PA_STREAM_NOFLAGS,
+          nullptr,
+          nullptr) < 0) {
+    g_printerr("Failed to connect playback stream: %s\n", pa_strerror(pa_context_errno(context_)));
+    release_stream(&playback_stream_);
+    return false;
+  }
+  return true;
+}
+
+void PulseBackend::set_playback_paused(bool paused) {
+  if (playback_stream_) {
+    drop_operation(pa_stream_cork(playback_stream_, paused ? 1 : 0, nullptr, nullptr));
+  }
+}
+
+void PulseBackend::stop_playback() {
+  release_stream(&playback_stream_);
+}
+
+// Hands every fragment readable on |s| to the capture callback. A fragment
+// can be a hole (data == nullptr), which is dropped without being delivered.
+void PulseBackend::capture_read_cb(pa_stream* s, size_t nbytes, void* userdata) {
+  auto* capture = static_cast<CaptureStream*>(userdata);
+
+  while (pa_stream_readable_size(s) > 0) {
+    const void* data;
+    if (pa_stream_peek(s, &data, &nbytes) < 0 || nbytes == 0) {
+      return;
+    }
+
+    if (data) {
+      capture->callback(static_cast<const uint8_t*>(data), nbytes, capture->user_data);
+    }
+
+    pa_stream_drop(s);
+  }
+}
+
+// Connects the system sound stream to the monitor of the default sink once
+// the server reports it.
+void PulseBackend::monitor_sink_info_cb(pa_context* c, const pa_sink_info* i, int eol,
+                                        void* userdata) {
+  auto* capture = static_cast<CaptureStream*>(userdata);
+  if (i && capture->stream && pa_stream_get_state(capture->stream) == PA_STREAM_UNCONNECTED) {
+    // Uncorked, like the microphone stream
+    if (pa_stream_connect_record(capture->stream, i->monitor_source_name, &capture->attr,
+                                 PA_STREAM_ADJUST_LATENCY) < 0) {
+      g_printerr("Failed to connect monitor stream: %s\n", pa_strerror(pa_context_errno(c)));
+    }
+  }
+}
+
+bool PulseBackend::start_capture(CaptureSource source, const AudioStreamConfig& config,
+                                 AudioCaptureCallback capture, void* user_data) {
+  CaptureStream& stream = capture_stream(source);
+  release_stream(&stream.stream);
+  if (!context_) {
+    return false;
+  }
+
+  pa_sample_spec ss = sample_spec_for(config);
+  stream.attr = capture_buffer_attr(&ss, config.fragment_ms);
+  stream.callback = capture;
+  stream.user_data = user_data;
+
+  const bool microphone = source == CaptureSource::kMicrophone;
+  stream.stream = pa_stream_new(
+      context_,
+      microphone ? "FlutterF2FSound Recording" : "FlutterF2FSound Monitor",
+      &ss,
+      nullptr);
+  if (!stream.stream) {
+    return false;
+  }
+  pa_stream_set_read_callback(stream.stream, capture_read_cb, &stream);
+
+  if (!microphone) {
+    drop_operation(pa_context_get_sink_info_by_name(context_, nullptr,  // Default sink
+                                                    monitor_sink_info_cb, &stream));
+    return true;
+  }
+
+  // Record from the default source; ADJUST_LATENCY makes the server honour
+  // fragsize instead of buffering up to its default latency
+  if (pa_stream_connect_record(stream.stream, nullptr, &stream.attr,
+                               PA_STREAM_ADJUST_LATENCY) < 0) {
+    g_printerr("Failed to connect recording stream: %s\n", pa_strerror(pa_context_errno(context_)));
+    release_stream(&stream.stream);
+    return false;
+  }
+  return true;
+}
+
+void PulseBackend::stop_capture(CaptureSource source) {
+  release_stream(&capture_stream(source).stream);
+}
+
+}  // namespace
+
+std::unique_ptr<AudioBackend> audio_backend_new_pulse() {
+  return std::unique_ptr<AudioBackend>(new PulseBackend());
+}
@@ -0,0 +1,229 @@
+#include "audio_cache.h"
+
+#include <curl/curl.h>
+#include <dirent.h>
+#include <glib.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <vector>
+
+namespace {
+
+constexpr const char kBodySuffix[] = ".audio";
+constexpr const char kMetaSuffix[] = ".meta";
+
+// Temporary files older than this were left behind by a crash mid-write.
+constexpr time_t kStaleTempSeconds = 60 * 60;
+
+bool ends_with(const std::string& value, const char* suffix) {
+  const size_t length = strlen(suffix);
+  return value.size() >= length && value.compare(value.size() - length, length, suffix) == 0;
+}
+
+// Writes |path| through a temporary file in the same directory and renames
+// it over |path|, so readers see the old file or the complete new one.
+bool write_atomically(const std::string& path, const std::function<bool(FILE* file)>& write) {
+  std::string temp_path = path + ".XXXXXX";
+  const int fd = mkstemp(&temp_path[0]);
+  if (fd < 0) {
+    g_printerr("Failed to create %s: %s\n", temp_path.c_str(), strerror(errno));
+    return false;
+  }
+  FILE* file = fdopen(fd, "wb");
+  if (!file) {
+    close(fd);
+    unlink(temp_path.c_str());
+    return false;
+  }
+
+  bool ok = write(file);
+  ok = fflush(file) == 0 && ok;
+  ok = fsync(fd) == 0 && ok;
+  ok = fclose(file) == 0 && ok;
+  if (ok && rename(temp_path.c_str(), path.c_str()) != 0) {
+    g_printerr("Failed to rename %s: %s\n", temp_path.c_str(), strerror(errno));
+    ok = false;
+  }
+  if (!ok) {
+    unlink(temp_path.c_str());
+  }
+  return ok;
+}
+
+size_t collect_validators(char* data, size_t size, size_t nmemb, void* user_data) {
+  static_cast<HttpValidators*>(user_data)->parse_header(data, size * nmemb);
+  return size * nmemb;
+}
+
+}  // namespace
+
+AudioCache::AudioCache(const std::string& directory, uint64_t budget_bytes,
+                       std::shared_ptr<HttpConnectionPool> pool)
+    : directory_(directory), budget_bytes_(budget_bytes), pool_(std::move(pool)) {}
+
+std::string AudioCache::default_directory() {
+  gchar* directory = g_build_filename(g_get_user_cache_dir(), "flutter_f2f_sound", "audio", nullptr);
+  std::string result = directory;
+  g_free(directory);
+  return result;
+}
+
+bool AudioCache::lookup(const std::string& url, Entry* entry) {
+  const std::string base = base_path(url);
+  std::ifstream meta(base + kMetaSuffix);
+  std::string stored_url;
+  if (!std::getline(meta, stored_url) || stored_url != url) {
+    return false;
+  }
+
+  Entry found;
+  std::getline(meta, found.validators.etag);
+  std::getline(meta, found.validators.last_modified);
+  found.path = base + kBodySuffix;
+  // Touching the body both checks that it exists and records the use
+  if (utimes(found.path.c_str(), nullptr) != 0) {
+    return false;
+  }
+  *entry = found;
+  return true;
+}
+
+bool AudioCache::revalidate(const std::string& url, const Entry& entry) {
+  const HttpValidators& cached = entry.validators;
+  if (cached.empty()) {
+    return false;
+  }
+  CURL* curl = curl_easy_init();
+  if (!curl) {
+    return false;
+  }
+
+  struct curl_slist* headers = nullptr;
+  if (!cached.etag.empty()) {
+    headers = curl_slist_append(headers, ("If-None-Match: " + cached.etag).c_str());
+  }
+  if (!cached.last_modified.empty()) {
+    headers = curl_slist_append(headers, ("If-Modified-Since: " + cached.last_modified).c_str());
+  }
+
+  HttpValidators current;
+  if (pool_) {
+    pool_->configure(curl);
+  }
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, collect_validators);
+  curl_easy_setopt(curl, CURLOPT_HEADERDATA, &current);
+  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "FlutterF2FSound/1.0");
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 5L);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+
+  CURLcode res = curl_easy_perform(curl);
+  long http_code = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+  curl_easy_cleanup(curl);
+  curl_slist_free_all(headers);
+
+  if (res != CURLE_OK) {
+    g_print("Cannot revalidate %s (%s), using the cached copy\n", url.c_str(),
+            curl_easy_strerror(res));
+    return true;
+  }
+  if (http_code == 304) {
+    return true;
+  }
+  // Servers that ignore conditional HEAD requests still send the validators
+  if (http_code == 200) {
+    return cached.etag.empty() ? current.last_modified == cached.last_modified
+                               : current.etag == cached.etag;
+  }
+  return false;
+}
+
+bool AudioCache::store(const std::string& url, const HttpValidators& validators,
+                       const std::function<bool(FILE* file)>& write) {
+  if (g_mkdir_with_parents(directory_.c_str(), 0700) != 0) {
+    g_printerr("Failed to create %s: %s\n", directory_.c_str(), strerror(errno));
+    return false;
+  }
+
+  const std::string base = base_path(url);
+  if (!write_atomically(base + kBodySuffix, write)) {
+    return false;
+  }
+  // The metadata goes last: a new body still paired with the previous
+  // validators just fails revalidation
+  const bool stored = write_atomically(base + kMetaSuffix, [&](FILE* file) {
+    return fprintf(file, "%s\n%s\n%s\n", url.c_str(), validators.etag.c_str(),
+                   validators.last_modified.c_str()) > 0;
+  });
+  evict(base + kBodySuffix);
+  return stored;
+}
+
+std::string AudioCache::base_path(const std::string& url) const {
+  gchar* hash = g_compute_checksum_for_string(G_CHECKSUM_SHA256, url.c_str(), -1);
+  std::string path = directory_ + "/" + hash;
+  g_free(hash);
+  return path;
+}
+
+void AudioCache::evict(const std::string& keep) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  DIR* dir = opendir(directory_.c_str());
+  if (!dir) {
+    return;
+  }
+
+  struct Body {
+    std::string path;
+    uint64_t size;
+    struct timespec used;
+  };
+  std::vector<Body> bodies;
+  uint64_t total = 0;
+  const time_t now = time(nullptr);
+  while (struct dirent* file = readdir(dir)) {
+    const std::string name = file->d_name;
+    const std::string path = directory_ + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+      continue;
+    }
+    if (ends_with(name, kBodySuffix)) {
+      bodies.push_back(Body{path, (uint64_t)st.st_size, st.st_mtim});
+      total += (uint64_t)st.st_size;
+    } else if (!ends_with(name, kMetaSuffix) && now - st.st_mtime > kStaleTempSeconds) {
+      unlink(path.c_str());
+    }
+  }
+  closedir(dir);
+
+  // Least recently used first
+  std::sort(bodies.begin(), bodies.end(), [](const Body& a, const Body& b) {
+    return a.used.tv_sec != b.used.tv_sec ? a.used.tv_sec < b.used.tv_sec
+                                          : a.used.tv_nsec < b.used.tv_nsec;
+  });
+  for (const Body& body : bodies) {
+    if (total <= budget_bytes_) {
+      break;
+    }
+    if (body.path == keep) {
+      continue;
+    }
+    const std::string base = body.path.substr(0, body.path.size() - strlen(kBodySuffix));
+    unlink((base + kMetaSuffix).c_str());
+    unlink(body.path.c_str());
+    total -= body.size;
+    g_print("Evicted %s from the audio cache\n", body.path.c_str());
+  }
+}
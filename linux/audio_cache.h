@@ -0,0 +1,62 @@
+#ifndef FLUTTER_PLUGIN_AUDIO_CACHE_H_
+#define FLUTTER_PLUGIN_AUDIO_CACHE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include "http_stream.h"
+
+// Downloaded audio kept on disk between plays, one file per URL named after
+// a SHA-256 of the URL. Next to each body a small metadata file holds the
+// URL and the response's validators, so the copy can be revalidated with a
+// conditional request before it is reused.
+//
+// Files are written under a temporary name and renamed into place, so a
+// crash or a concurrent reader never sees a partial entry. A body's
+// modification time records its last use; once the cache grows past its
+// budget the least recently used entries are deleted. Safe to use from
+// several threads.
+class AudioCache {
+ public:
+  struct Entry {
+    std::string path;  // Body
+    HttpValidators validators;
+  };
+
+  // Revalidates through |pool| when one is given.
+  AudioCache(const std::string& directory, uint64_t budget_bytes,
+             std::shared_ptr<HttpConnectionPool> pool = nullptr);
+
+  AudioCache(const AudioCache&) = delete;
+  AudioCache& operator=(const AudioCache&) = delete;
+
+  // $XDG_CACHE_HOME/flutter_f2f_sound/audio
+  static std::string default_directory();
+
+  // Finds the cached copy of |url| and marks it as used.
+  bool lookup(const std::string& url, Entry* entry);
+
+  // Asks the server whether |entry| is still current. Also true when the
+  // server cannot be reached, so cached audio plays offline.
+  bool revalidate(const std::string& url, const Entry& entry);
+
+  // Stores the body that |write| produces for |url|, then evicts older
+  // entries beyond the budget. |write| returns false to abandon the entry.
+  bool store(const std::string& url, const HttpValidators& validators,
+             const std::function<bool(FILE* file)>& write);
+
+ private:
+  std::string base_path(const std::string& url) const;
+  void evict(const std::string& keep);
+
+  const std::string directory_;
+  const uint64_t budget_bytes_;
+  const std::shared_ptr<HttpConnectionPool> pool_;
+  std::mutex mutex_;  // Serializes eviction
+};
+
+#endif  // FLUTTER_PLUGIN_AUDIO_CACHE_H_
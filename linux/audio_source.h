@@ -0,0 +1,43 @@
+#ifndef FLUTTER_PLUGIN_AUDIO_SOURCE_H_
+#define FLUTTER_PLUGIN_AUDIO_SOURCE_H_
+
+#include <cstddef>
+#include <cstdint>
+
+// Interleaved s16 audio that the playback render callback drains.
+//
+// All methods form the consumer side and must be called from one thread at
+// a time (the audio thread, or another thread holding the backend lock).
+class AudioSource {
+ public:
+  virtual ~AudioSource() = default;
+
+  virtual int sample_rate() const = 0;
+  virtual int channels() const = 0;
+  size_t frame_bytes() const { return (size_t)channels() * sizeof(int16_t); }
+
+  // Total length in frames.
+  virtual uint64_t frames() const = 0;
+
+  // Copies up to |length| bytes (a whole number of frames) into |out| and
+  // returns how many were copied. Never blocks; returning less than |length|
+  // before at_end() is an underrun.
+  virtual size_t read(uint8_t* out, size_t length) = 0;
+
+  // Like read(), but lends the source's own memory instead of copying:
+  // returns where the next frames are and sets |length| to how many bytes of
+  // them to use. The memory stays valid until the next call on the source.
+  // Sources that produce audio on the fly return nullptr and consume nothing.
+  virtual const uint8_t* read_in_place(size_t* length) { return nullptr; }
+
+  // Moves playback to |frame|, clamped to the end.
+  virtual void seek(uint64_t frame) = 0;
+
+  // True once every frame up to the end has been read.
+  virtual bool at_end() const = 0;
+
+  // Frame the next read() starts at.
+  virtual uint64_t position_frames() const = 0;
+};
+
+#endif  // FLUTTER_PLUGIN_AUDIO_SOURCE_H_
@@ -2,6 +2,7 @@
 
 #include <flutter_linux/flutter_linux.h>
 #include <gtk/gtk.h>
+#include <sys/eventfd.h>
 #include <sys/utsname.h>
 
 #include <cstring>
@@ -9,22 +10,166 @@
 #include <sstream>
 #include <fstream>
 #include <algorithm>
-
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include "audio_backend.h"
+#include "audio_cache.h"
+#include "http_connection_pool.h"
+#include "http_stream.h"
+#include "mapped_wav_source.h"
+#include "memory_input.h"
+#include "mixer.h"
 #include "flutter_f2f_sound_plugin_private.h"
+#include "pcm_cache.h"
+#include "pcm_sink.h"
+#include "sample_bank.h"
+#include "spsc_ring_buffer.h"
+#include "streaming_decoder.h"
+#include "worker_pool.h"
 
 #define FLUTTER_F2F_SOUND_PLUGIN(obj) \
   (G_TYPE_CHECK_INSTANCE_CAST((obj), flutter_f2f_sound_plugin_get_type(), \
                               FlutterF2fSoundPlugin))
 
+// Sample format delivered to Dart on a capture event channel
+enum class DeliveryFormat {
+  kPcm16,    // Uint8List of interleaved s16le bytes, as captured
+  kFloat32,  // Float32List of interleaved samples in [-1.0, 1.0)
+};
+
+// What a stream does when Dart falls behind and its event queue is full
+enum class OverflowPolicy {
+  kDropOldest,  // Discard the oldest queued packet (lowest latency)
+  kDropNewest,  // Discard the packet being added
+  kBlock,       // Wait for the main thread to drain (offline processing)
+};
+
+// Default bound on packets waiting for the main thread, per stream
+constexpr size_t kDefaultMaxQueuedPackets = 32;
+
+// Capture fragment size requested from the backend when the caller does not
+// pass "fragmentMs". Without an explicit fragsize PulseAudio picks about 2 s.
+constexpr int kDefaultFragmentMs = 10;
+
+// Decoded audio kept ahead of the output when streaming a file or URL.
+constexpr int kDecodeBufferMs = 1000;
+
+// Audio decoded from a URL before play() starts the output, unless the
+// caller passes "prebufferMs".
+constexpr int kDefaultPrebufferMs = 500;
+
+// Threads for downloads, file opens and probes.
+constexpr size_t kMaxWorkerThreads = 4;
+
+// Disk space for downloaded audio kept between plays.
+constexpr uint64_t kAudioCacheBytes = 256 * 1024 * 1024;
+
+// Memory for decoded local files kept between plays, unless changed with
+// setPcmCacheBudget.
+constexpr size_t kDefaultPcmCacheBytes = 64 * 1024 * 1024;
+
+// Memory for sounds loaded with loadSample, unless changed with
+// setSampleBankBudget.
+constexpr size_t kDefaultSampleBankBytes = 32 * 1024 * 1024;
+
+// Output of the sound effect mixer unless startMixer asks otherwise. Effects
+// want a short buffer: it is the delay between a trigger and the sound.
+constexpr int kDefaultMixerSampleRate = 48000;
+constexpr int kDefaultMixerLatencyMs = 20;
+
+// Played audio kept for the playback event channel between two drains,
+// about 1.5 s of 44.1 kHz stereo.
+constexpr size_t kPlaybackTapBytes = 256 * 1024;
+
+// How often the main thread sends tapped playback audio to Dart.
+constexpr guint kPlaybackTapIntervalMs = 10;
+
+// How often the main thread checks the audio thread's underrun state.
+constexpr guint kPlaybackStateIntervalMs = 20;
+
+// Bounded hand-off of encoded events from audio callbacks to the main
+// thread, where they are sent on |channel|.
+struct EventQueue {
+  struct Packet {
+    FlValue* value;
+    size_t frames;
+  };
+
+  FlEventChannel* channel = nullptr;
+  size_t max_packets = kDefaultMaxQueuedPackets;
+  OverflowPolicy policy = OverflowPolicy::kDropOldest;
+
+  std::mutex mutex;
+  std::condition_variable space_available;
+  std::deque<Packet> packets;
+  guint drain_source_id = 0;
+  bool closed = false;
+
+  std::atomic<uint64_t> dropped_frames{0};
+};
+
+// Shared-memory transport for one capture session. See
+// FlutterF2fSoundRingState in the public header for the reader contract.
+struct CaptureRing {
+  explicit CaptureRing(size_t capacity)
+      : buffer(capacity), notify_fd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) {}
+
+  SpscRingBuffer buffer;
+  int notify_fd;
+  // Write index at which the current session began. Only the reader
+  // consumes, so bytes before it are left for the reader to skip.
+  std::atomic<uint64_t> session_start{0};
+};
+
+// Copy of the audio being played for the playback event channel. The audio
+// thread only writes into a preallocated ring, and only while Dart listens;
+// the main thread drains it on a timer and builds the events.
+struct PlaybackTap {
+  SpscRingBuffer ring{kPlaybackTapBytes};
+  std::atomic<bool> listening{false};
+  std::atomic<uint64_t> dropped_frames{0};
+
+  // Main thread only
+  FlEventChannel* channel = nullptr;
+  guint drain_source_id = 0;
+  std::vector<uint8_t> packet;
+};
+
+// Underrun state for the playback state event channel. The audio thread only
+// updates the atomics; the main thread compares them on a timer and builds
+// the events. Counting underruns keeps one that ends between two checks from
+// going unreported.
+struct PlaybackStateWatch {
+  std::atomic<bool> underrun{false};
+  std::atomic<uint64_t> underruns{0};
+
+  // Main thread only
+  FlEventChannel* channel = nullptr;
+  guint poll_source_id = 0;
+  bool reported_underrun = false;
+  uint64_t reported_underruns = 0;
+};
+
+// Per-stream state for delivering captured PCM to Dart
+struct CaptureDelivery {
+  CaptureRing* ring = nullptr;  // When set, PCM bypasses the event channel
+  DeliveryFormat format = DeliveryFormat::kPcm16;
+  size_t frame_bytes = sizeof(int16_t);
+  std::vector<float> float_buffer;  // Float32 conversion scratch space
+  PacketCoalescer coalescer;
+  EventQueue events;
+};
+
 // Audio context structure with enhanced features
 struct AudioContext {
-  // PulseAudio components
-  pa_mainloop* mainloop = nullptr;
-  pa_mainloop_api* mainloop_api = nullptr;
-  pa_context* context = nullptr;
-  pa_stream* playback_stream = nullptr;
-  pa_stream* record_stream = nullptr;
-  pa_stream* monitor_stream = nullptr;  // For system audio capture
+  // Device layer, created on first use. Its callbacks run on the backend's
+  // audio thread with the backend lock held; everything below that they
+  // touch must be accessed from other threads under BackendLock.
+  std::unique_ptr<AudioBackend> backend;
 
   // State flags
   std::atomic<bool> is_playing{false};
@@ -34,24 +179,65 @@ struct AudioContext {
   std::atomic<double> current_position{0.0};
   std::atomic<double> duration{0.0};
 
-  // Audio data
-  std::vector<uint8_t> audio_data;
-  std::vector<uint8_t> recorded_data;
-  size_t playback_index = 0;
+  // Audio being played: a decoder streaming a file or URL, or a cached
+  // decoded buffer
+  std::unique_ptr<AudioSource> source;
+  bool underrun = false;  // Audio thread only
 
-  // Audio format
-  pa_sample_format_t sample_format = PA_SAMPLE_S16LE;
+  // Audio format (interleaved s16)
   int sample_rate = 44100;
   int channels = 2;
 
+  // Capture delivery state
+  CaptureDelivery recording_delivery;
+  CaptureDelivery system_sound_delivery;
+  PlaybackTap playback_tap;
+  PlaybackStateWatch playback_state;
+
   // Event channels
   FlEventChannel* recording_event_channel = nullptr;
   FlEventChannel* system_sound_event_channel = nullptr;
   FlEventChannel* playback_event_channel = nullptr;
-
-  // Seeking support
-  std::atomic<bool> seek_requested{false};
-  std::atomic<double> seek_position{0.0};
+  FlEventChannel* playback_state_event_channel = nullptr;
+
+  // Downloads, opens and probes files so the platform thread never waits on
+  // disk or network
+  WorkerPool workers{kMaxWorkerThreads};
+
+  // Connections kept open between fetches, shared by downloads, cache
+  // revalidation and preconnect()
+  std::shared_ptr<HttpConnectionPool> http_pool = std::make_shared<HttpConnectionPool>();
+
+  // Shared with downloads that finish on their own threads
+  std::shared_ptr<AudioCache> audio_cache = std::make_shared<AudioCache>(
+      AudioCache::default_directory(), kAudioCacheBytes, http_pool);
+
+  // Shared with the workers that load files
+  std::shared_ptr<PcmCache> pcm_cache = std::make_shared<PcmCache>(kDefaultPcmCacheBytes);
+
+  // The job loading the most recent play(), and a counter bumped by every
+  // play() and stop() so results of older requests are discarded. Main
+  // thread only.
+  std::shared_ptr<WorkerJob> playback_job;
+  uint64_t playback_generation = 0;
+
+  // The PCM sink being played, owned by |source|, with the handle and sample
+  // format openPcmSink() gave out for it. Main thread only; cleared when the
+  // source is replaced.
+  PcmSink* pcm_sink = nullptr;
+  int64_t pcm_sink_handle = 0;
+  bool pcm_sink_float = false;
+
+  // Sound effects, mixed into an output stream of their own so that they
+  // overlap each other and the track. Created on first use; the mixer's
+  // stream renders with |mixer_backend|'s lock held.
+  std::unique_ptr<AudioBackend> mixer_backend;
+  std::unique_ptr<Mixer> mixer;
+
+  // Sounds decoded at the mixer's rate for triggering. Shared with the
+  // workers that load them.
+  std::shared_ptr<SampleBank> sample_bank =
+      std::make_shared<SampleBank>(kDefaultSampleBankBytes);
 };
 
 struct _FlutterF2fSoundPlugin {
@@ -61,370 +247,1027 @@ struct _FlutterF2fSoundPlugin {
   FlEventChannel* recording_event_channel = nullptr;
   FlEventChannel* system_sound_event_channel = nullptr;
   FlEventChannel* playback_event_channel = nullptr;
+  FlEventChannel* playback_state_event_channel = nullptr;
 };
 
 G_DEFINE_TYPE(FlutterF2fSoundPlugin, flutter_f2f_sound_plugin, g_object_get_type())
 
-// ==================== libcurl Download Callback ====================
+// Number of main-thread callers waiting for the backend lock. Backend
+// callbacks hold that lock, so a capture callback blocked on a full event
+// queue gives up when this is non-zero instead of deadlocking the thread
+// that drains the queue.
+static std::atomic<int> main_thread_lock_waiters{0};
+
+// Holds the audio backend lock for the lifetime of the scope. Must not be
+// used from backend callbacks, which already run under the lock.
+class BackendLock {
+ public:
+  explicit BackendLock(AudioContext* audio_ctx)
+      : backend_(audio_ctx ? audio_ctx->backend.get() : nullptr) {
+    if (backend_) {
+      main_thread_lock_waiters++;
+      backend_->lock();
+      main_thread_lock_waiters--;
+    }
+  }
 
-size_t WriteCallback(void* contents, size_t size, size_t nmemb, void* userp) {
-  size_t totalSize = size * nmemb;
-  std::vector<uint8_t>* buffer = static_cast<std::vector<uint8_t>*>(userp);
+  ~BackendLock() {
+    if (backend_) {
+      backend_->unlock();
+    }
+  }
 
-  size_t oldSize = buffer->size();
-  buffer->resize(oldSize + totalSize);
-  std::memcpy(buffer->data() + oldSize, contents, totalSize);
+  BackendLock(const BackendLock&) = delete;
+  BackendLock& operator=(const BackendLock&) = delete;
 
-  return totalSize;
+ private:
+  AudioBackend* backend_;
+};
+
+// ==================== Event Encoding ====================
+
+// Wraps a block of PCM bytes for the audio event channels. The standard codec
+// encodes a Uint8List as one length-prefixed byte run, so the bytes are copied
+// exactly once, into the value's own storage, and no per-byte FlValues exist.
+FlValue* audio_data_value_new(const uint8_t* data, size_t length) {
+  return fl_value_new_uint8_list(data, length);
 }
 
-// ==================== Network Audio Download with libcurl ====================
+// Builds a playback state event: "buffering", "ready" or "underrun", with
+// the playback position in seconds.
+static FlValue* playback_state_value_new(const char* state, double position) {
+  FlValue* event = fl_value_new_map();
+  fl_value_set_string_take(event, "event", fl_value_new_string(state));
+  fl_value_set_string_take(event, "position", fl_value_new_float(position));
+  return event;
+}
 
-static bool download_audio_file(const std::string& url, std::vector<uint8_t>& audio_data) {
-  CURL* curl = curl_easy_init();
-  if (!curl) {
-    g_printerr("Failed to initialize libcurl\n");
-    return false;
+// Converts interleaved s16 samples to float32. The loop is kept free of
+// branches and aliasing so the compiler vectorizes it at -O3.
+void pcm16_to_float32(const int16_t* __restrict in, float* __restrict out, size_t count) {
+  constexpr float kScale = 1.0f / 32768.0f;
+  for (size_t i = 0; i < count; i++) {
+    out[i] = in[i] * kScale;
+  }
+}
+
+void render_pcm16(const int16_t* __restrict in, int16_t* __restrict out, size_t count,
+                  float gain) {
+  if (gain == 1.0f) {
+    std::memcpy(out, in, count * sizeof(int16_t));
+    return;
+  }
+  for (size_t i = 0; i < count; i++) {
+    float sample = in[i] * gain;
+    sample = sample > 32767.0f ? 32767.0f : (sample < -32768.0f ? -32768.0f : sample);
+    out[i] = (int16_t)sample;
+  }
+}
+
+void scale_pcm16(int16_t* __restrict samples, size_t count, float gain) {
+  if (gain == 1.0f) {
+    return;
   }
+  for (size_t i = 0; i < count; i++) {
+    float sample = samples[i] * gain;
+    sample = sample > 32767.0f ? 32767.0f : (sample < -32768.0f ? -32768.0f : sample);
+    samples[i] = (int16_t)sample;
+  }
+}
 
-  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &audio_data);
-  curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, "FlutterF2FSound/1.0");
+// ==================== Event Queue ====================
 
-  CURLcode res = curl_easy_perform(curl);
+// Sends every queued event. Runs on the main thread.
+static gboolean event_queue_drain(gpointer user_data) {
+  auto* queue = static_cast<EventQueue*>(user_data);
 
-  if (res != CURLE_OK) {
-    g_printerr("Failed to download audio: %s\n", curl_easy_strerror(res));
-    curl_easy_cleanup(curl);
-    return false;
+  std::deque<EventQueue::Packet> packets;
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    packets.swap(queue->packets);
+    queue->drain_source_id = 0;
   }
+  queue->space_available.notify_all();
 
-  long http_code = 0;
-  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-  curl_easy_cleanup(curl);
+  for (const EventQueue::Packet& packet : packets) {
+    if (queue->channel) {
+      fl_event_channel_send(queue->channel, packet.value, nullptr, nullptr);
+    }
+    fl_value_unref(packet.value);
+  }
+  return G_SOURCE_REMOVE;
+}
 
-  if (http_code != 200) {
-    g_printerr("HTTP error: %ld\n", http_code);
-    return false;
+// Takes ownership of |value| and queues it for the main thread, applying the
+// queue's overflow policy when it is full. Safe to call from any thread.
+static void event_queue_push(EventQueue* queue, FlValue* value, size_t frames) {
+  FlValue* dropped = nullptr;
+  {
+    std::unique_lock<std::mutex> lock(queue->mutex);
+
+    if (queue->policy == OverflowPolicy::kBlock &&
+        !g_main_context_is_owner(g_main_context_default())) {
+      // Wait for the main thread to drain, but never while it is itself
+      // waiting for the backend lock this callback holds.
+      while (!queue->closed && queue->packets.size() >= queue->max_packets &&
+             main_thread_lock_waiters.load() == 0) {
+        queue->space_available.wait_for(lock, std::chrono::milliseconds(10));
+      }
+    }
+
+    if (queue->closed) {
+      fl_value_unref(value);
+      return;
+    }
+
+    if (queue->packets.size() >= queue->max_packets) {
+      if (queue->policy != OverflowPolicy::kDropOldest) {
+        queue->dropped_frames += frames;
+        fl_value_unref(value);
+        return;
+      }
+      dropped = queue->packets.front().value;
+      queue->dropped_frames += queue->packets.front().frames;
+      queue->packets.pop_front();
+    }
+
+    queue->packets.push_back({value, frames});
+    if (queue->drain_source_id == 0) {
+      queue->drain_source_id = g_idle_add(event_queue_drain, queue);
+    }
   }
 
-  g_print("Downloaded %zu bytes from %s\n", audio_data.size(), url.c_str());
-  return true;
+  if (dropped) {
+    fl_value_unref(dropped);
+  }
 }
 
-// ==================== Audio Format Support with libsndfile ====================
+// Opens the queue for a new session on |channel|.
+static void event_queue_reset(EventQueue* queue, FlEventChannel* channel, size_t max_packets,
+                              OverflowPolicy policy) {
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  queue->channel = channel;
+  queue->max_packets = std::max<size_t>(max_packets, 1);
+  queue->policy = policy;
+  queue->closed = false;
+  queue->dropped_frames = 0;
+}
 
-static bool load_audio_file(const std::string& path, std::vector<uint8_t>& raw_data,
-                           int& sample_rate, int& channels) {
-  SF_INFO sfinfo;
-  memset(&sfinfo, 0, sizeof(sfinfo));
+// Discards queued events and releases any blocked producer. Runs on the main
+// thread, so a pending drain can be cancelled safely.
+static void event_queue_close(EventQueue* queue) {
+  std::deque<EventQueue::Packet> packets;
+  {
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    queue->closed = true;
+    packets.swap(queue->packets);
+    if (queue->drain_source_id != 0) {
+      g_source_remove(queue->drain_source_id);
+      queue->drain_source_id = 0;
+    }
+  }
+  queue->space_available.notify_all();
 
-  SNDFILE* sndfile = sf_open(path.c_str(), SFM_READ, &sfinfo);
-  if (!sndfile) {
-    g_printerr("Failed to open audio file: %s\n", path.c_str());
-    return false;
+  for (const EventQueue::Packet& packet : packets) {
+    fl_value_unref(packet.value);
   }
+}
 
-  sample_rate = sfinfo.samplerate;
-  channels = sfinfo.channels;
+// ==================== Playback Tap ====================
+
+// Sends everything tapped since the last drain as one event. Runs on the
+// main thread.
+static gboolean playback_tap_drain(gpointer user_data) {
+  auto* tap = static_cast<PlaybackTap*>(user_data);
+  const size_t length = tap->ring.readable();
+  if (length > 0) {
+    // The ring holds whole frames, so a packet never splits one
+    tap->packet.resize(length);
+    tap->ring.read(tap->packet.data(), length);
+    g_autoptr(FlValue) event = audio_data_value_new(tap->packet.data(), length);
+    fl_event_channel_send(tap->channel, event, nullptr, nullptr);
+  }
+  return G_SOURCE_CONTINUE;
+}
 
-  // Read audio data
-  std::vector<short> samples(sfinfo.frames * channels);
-  sf_count_t count = sf_readf_short(sndfile, samples.data(), sfinfo.frames);
+static FlMethodErrorResponse* playback_tap_listen_cb(FlEventChannel* channel, FlValue* args,
+                                                    gpointer user_data) {
+  auto* tap = static_cast<PlaybackTap*>(user_data);
+  // Audio tapped for an earlier listener is not sent to this one
+  tap->ring.consume(tap->ring.readable());
+  tap->dropped_frames = 0;
+  tap->listening = true;
+  if (tap->drain_source_id == 0) {
+    tap->drain_source_id = g_timeout_add(kPlaybackTapIntervalMs, playback_tap_drain, tap);
+  }
+  return nullptr;
+}
 
-  // Convert to bytes (16-bit PCM)
-  raw_data.resize(samples.size() * sizeof(short));
-  std::memcpy(raw_data.data(), samples.data(), raw_data.size());
+static void playback_tap_stop(PlaybackTap* tap) {
+  tap->listening = false;
+  if (tap->drain_source_id != 0) {
+    g_source_remove(tap->drain_source_id);
+    tap->drain_source_id = 0;
+  }
+}
 
-  sf_close(sndfile);
+static FlMethodErrorResponse* playback_tap_cancel_cb(FlEventChannel* channel, FlValue* args,
+                                                    gpointer user_data) {
+  playback_tap_stop(static_cast<PlaybackTap*>(user_data));
+  return nullptr;
+}
 
-  g_print("Loaded audio: %d Hz, %d channels, %zu frames\n",
-          sample_rate, channels, (size_t)sfinfo.frames);
+// ==================== Playback State ====================
 
-  return true;
+// Sends a playback state event at the current position. Main thread only.
+static void playback_state_send(AudioContext* audio_ctx, const char* state) {
+  if (!audio_ctx->playback_state.channel) {
+    return;
+  }
+  g_autoptr(FlValue) event = playback_state_value_new(state, audio_ctx->current_position.load());
+  fl_event_channel_send(audio_ctx->playback_state.channel, event, nullptr, nullptr);
 }
 
-// ==================== Sample Rate Conversion with libsamplerate ====================
+// Reports underruns the audio thread saw since the last check, and the
+// recovery from them. Runs on the main thread.
+static gboolean playback_state_poll(gpointer user_data) {
+  auto* audio_ctx = static_cast<AudioContext*>(user_data);
+  PlaybackStateWatch& watch = audio_ctx->playback_state;
+  const uint64_t underruns = watch.underruns.load(std::memory_order_acquire);
+  const bool underrun = watch.underrun.load(std::memory_order_acquire);
+  if (underruns != watch.reported_underruns) {
+    watch.reported_underruns = underruns;
+    watch.reported_underrun = true;
+    playback_state_send(audio_ctx, "underrun");
+  }
+  if (!underrun && watch.reported_underrun) {
+    watch.reported_underrun = false;
+    playback_state_send(audio_ctx, "ready");
+  }
+  return G_SOURCE_CONTINUE;
+}
 
-static bool convert_sample_rate(const std::vector<int16_t>& input,
-                               int input_rate,
-                               int output_rate,
-                               std::vector<int16_t>& output) {
-  if (input_rate == output_rate) {
-    output = input;
-    return true;
+static FlMethodErrorResponse* playback_state_listen_cb(FlEventChannel* channel, FlValue* args,
+                                                      gpointer user_data) {
+  auto* audio_ctx = static_cast<AudioContext*>(user_data);
+  PlaybackStateWatch& watch = audio_ctx->playback_state;
+  // Underruns from before this listener are not reported to it
+  watch.reported_underruns = watch.underruns.load();
+  watch.reported_underrun = watch.underrun.load();
+  if (watch.poll_source_id == 0) {
+    watch.poll_source_id = g_timeout_add(kPlaybackStateIntervalMs, playback_state_poll, audio_ctx);
   }
+  return nullptr;
+}
 
-  SRC_DATA src_data;
-  double ratio = (double)output_rate / (double)input_rate;
+static void playback_state_stop(PlaybackStateWatch* watch) {
+  if (watch->poll_source_id != 0) {
+    g_source_remove(watch->poll_source_id);
+    watch->poll_source_id = 0;
+  }
+}
 
-  src_data.data_in = input.data();
-  src_data.input_frames = input.size();
-  src_data.src_ratio = ratio;
+static FlMethodErrorResponse* playback_state_cancel_cb(FlEventChannel* channel, FlValue* args,
+                                                      gpointer user_data) {
+  playback_state_stop(&static_cast<AudioContext*>(user_data)->playback_state);
+  return nullptr;
+}
 
-  size_t output_size = (size_t)(input.size() * ratio) + 1;
-  src_data.data_out = new float[output_size];
-  src_data.output_frames = output_size;
-  src_data.end_of_input = 0;
+// Queues one captured s16 packet in the format the listener asked for.
+// Float32 conversion reuses the delivery's buffer so steady-state capture
+// allocates only the event itself.
+static void send_capture_packet(const uint8_t* data, size_t length, gpointer user_data) {
+  auto* delivery = static_cast<CaptureDelivery*>(user_data);
+  if (!data || length < sizeof(int16_t)) {
+    return;
+  }
 
-  SRC_STATE* src_state = src_new(SRC_SINC_BEST_QUALITY, 1, nullptr);
-  if (!src_state) {
-    g_printerr("Failed to create sample rate converter\n");
-    return false;
+  FlValue* event;
+  if (delivery->format == DeliveryFormat::kPcm16) {
+    event = audio_data_value_new(data, length);
+  } else {
+    size_t sample_count = length / sizeof(int16_t);
+    if (delivery->float_buffer.size() < sample_count) {
+      delivery->float_buffer.resize(sample_count);
+    }
+    pcm16_to_float32(reinterpret_cast<const int16_t*>(data), delivery->float_buffer.data(),
+                     sample_count);
+    event = fl_value_new_float32_list(delivery->float_buffer.data(), sample_count);
   }
+  event_queue_push(&delivery->events, event, length / delivery->frame_bytes);
+}
 
-  int error = src_process(src_state, &src_data);
-  src_delete(src_state);
+// ==================== Packet Coalescing ====================
 
-  if (error) {
-    g_printerr("Sample rate conversion error: %s\n", src_strerror(error));
-    delete[] src_data.data_out;
-    return false;
+size_t packet_bytes_for_duration(int duration_ms, int sample_rate, size_t frame_bytes) {
+  if (duration_ms <= 0 || sample_rate <= 0) {
+    return 0;
+  }
+  size_t frames = (size_t)((int64_t)sample_rate * duration_ms / 1000);
+  return frames * frame_bytes;
+}
+
+void packet_coalescer_reset(PacketCoalescer* coalescer, size_t packet_bytes) {
+  coalescer->packet_bytes = packet_bytes;
+  coalescer->pending.clear();
+  coalescer->pending.reserve(packet_bytes);
+}
+
+void packet_coalescer_push(PacketCoalescer* coalescer, const uint8_t* data, size_t length,
+                           PacketCallback callback, gpointer user_data) {
+  const size_t packet_bytes = coalescer->packet_bytes;
+  if (packet_bytes == 0) {
+    callback(data, length, user_data);
+    return;
   }
 
-  // Convert float back to int16
-  output.resize(src_data.output_frames_gen);
-  for (size_t i = 0; i < src_data.output_frames_gen; i++) {
-    float sample = src_data.data_out[i];
-    if (sample > 1.0f) sample = 1.0f;
-    if (sample < -1.0f) sample = -1.0f;
-    output[i] = (int16_t)(sample * 32767.0f);
+  // Complete the packet left over from the previous fragment first
+  std::vector<uint8_t>& pending = coalescer->pending;
+  if (!pending.empty()) {
+    size_t take = std::min(packet_bytes - pending.size(), length);
+    pending.insert(pending.end(), data, data + take);
+    data += take;
+    length -= take;
+    if (pending.size() < packet_bytes) {
+      return;
+    }
+    callback(pending.data(), packet_bytes, user_data);
+    pending.clear();
   }
 
-  delete[] src_data.data_out;
-  return true;
+  // Whole packets are sent straight from the fragment without copying
+  while (length >= packet_bytes) {
+    callback(data, packet_bytes, user_data);
+    data += packet_bytes;
+    length -= packet_bytes;
+  }
+
+  pending.assign(data, data + length);
 }
 
-// ==================== PulseAudio Callbacks ====================
+// ==================== Capture Ring Transport ====================
 
-static void context_state_cb(pa_context* c, void* userdata) {
-  auto* audio_ctx = static_cast<AudioContext*>(userdata);
+static std::atomic<CaptureRing*> capture_rings[2];
 
-  switch (pa_context_get_state(c)) {
-    case PA_CONTEXT_READY:
-      g_print("PulseAudio context ready\n");
-      break;
-    case PA_CONTEXT_FAILED:
-    case PA_CONTEXT_TERMINATED:
-      g_printerr("PulseAudio context failed or terminated\n");
-      if (audio_ctx->mainloop) {
-        pa_mainloop_quit(audio_ctx->mainloop, 1);
-      }
-      break;
-    default:
-      break;
+// Returns the ring for |ring_id|, creating it with |capacity| bytes on first
+// use. Called on the main thread only; rings are never freed because Dart
+// readers may hold their address for the life of the process.
+static CaptureRing* capture_ring_get_or_create(int ring_id, size_t capacity) {
+  CaptureRing* ring = capture_rings[ring_id].load(std::memory_order_acquire);
+  if (!ring) {
+    ring = new CaptureRing(capacity);
+    capture_rings[ring_id].store(ring, std::memory_order_release);
   }
+  return ring;
 }
 
-static void stream_write_cb(pa_stream* s, size_t nbytes, void* userdata) {
-  auto* audio_ctx = static_cast<AudioContext*>(userdata);
+static CaptureRing* capture_ring_lookup(int32_t ring_id) {
+  if (ring_id < 0 || ring_id >= (int32_t)G_N_ELEMENTS(capture_rings)) {
+    return nullptr;
+  }
+  return capture_rings[ring_id].load(std::memory_order_acquire);
+}
 
-  if (!audio_ctx || audio_ctx->audio_data.empty() ||
-      audio_ctx->playback_index >= audio_ctx->audio_data.size()) {
-    // No more data - write silence
-    uint8_t* silence = new uint8_t[nbytes];
-    memset(silence, 0, nbytes);
-    pa_stream_write(s, silence, nbytes, [](void* p) { delete[] (uint8_t*)p; }, 0, PA_SEEK_RELATIVE);
+FlutterF2fSoundRingState flutter_f2f_sound_ring_state(int32_t ring_id) {
+  FlutterF2fSoundRingState state = {};
+  state.notify_fd = -1;
+
+  CaptureRing* ring = capture_ring_lookup(ring_id);
+  if (ring) {
+    state.data = ring->buffer.data();
+    state.capacity = ring->buffer.capacity();
+    state.read_index = ring->buffer.read_index();
+    state.write_index = ring->buffer.write_index();
+    state.session_start_index = ring->session_start.load(std::memory_order_acquire);
+    state.overrun_bytes = ring->buffer.overrun_bytes();
+    state.overrun_count = ring->buffer.overrun_count();
+    state.notify_fd = ring->notify_fd;
+  }
+  return state;
+}
 
-    // Mark as finished
-    if (audio_ctx) {
-      audio_ctx->is_playing = false;
+void flutter_f2f_sound_ring_consume(int32_t ring_id, uint64_t bytes) {
+  CaptureRing* ring = capture_ring_lookup(ring_id);
+  if (ring) {
+    ring->buffer.consume((size_t)bytes);
+  }
+}
+
+// Marks the start of a new session on |delivery|'s ring, if it uses one.
+// Called with the backend lock held, before the capture stream starts, so no
+// write of the previous session lands after the mark.
+static void capture_ring_begin_session(CaptureDelivery* delivery) {
+  if (delivery->ring) {
+    delivery->ring->session_start.store(delivery->ring->buffer.write_index(),
+                                        std::memory_order_release);
+  }
+}
+
+// Feeds a captured fragment to Dart, through the shared ring or through the
+// stream's coalescer and event channel.
+static void send_capture_data(CaptureDelivery* delivery, const uint8_t* data, size_t length) {
+  if (!data || length == 0) {
+    return;
+  }
+  if (delivery->ring) {
+    delivery->ring->buffer.write(data, length);
+    if (delivery->ring->notify_fd >= 0) {
+      eventfd_write(delivery->ring->notify_fd, 1);
     }
     return;
   }
+  packet_coalescer_push(&delivery->coalescer, data, length, send_capture_packet, delivery);
+}
 
-  // Check for seek request
-  if (audio_ctx->seek_requested) {
-    size_t new_index = (size_t)(audio_ctx->seek_position * audio_ctx->sample_rate *
-                               audio_ctx->channels * sizeof(int16_t));
-    audio_ctx->playback_index = new_index;
-    audio_ctx->seek_requested = false;
-    g_print("Seeked to position: %.2f seconds\n", audio_ctx->seek_position.load());
+// ==================== Audio Callbacks ====================
+
+// Renders the next output period into |buffer|, the backend's own storage,
+// at the current volume. Past the end of the audio the period is silence.
+static void render_playback(uint8_t* buffer, size_t length, void* user_data) {
+  auto* audio_ctx = static_cast<AudioContext*>(user_data);
+  const size_t frame_bytes = audio_ctx->channels * sizeof(int16_t);
+  AudioSource* source = audio_ctx->source.get();
+
+  if (!source || source->at_end()) {
+    // No more data - write silence and mark as finished
+    memset(buffer, 0, length);
+    audio_ctx->is_playing = false;
+    return;
   }
 
-  // Calculate how much data we can write
-  size_t bytes_available = audio_ctx->audio_data.size() - audio_ctx->playback_index;
-  size_t bytes_to_write = std::min(nbytes, bytes_available);
+  // Whatever the source has ready, read in place when it holds the samples
+  // in memory and straight into |buffer| otherwise; silence fills an
+  // underrun. Either way the samples are copied once.
+  const float gain = (float)audio_ctx->volume.load();
+  size_t bytes_to_write = length;
+  const uint8_t* data_to_write = source->read_in_place(&bytes_to_write);
+  if (!data_to_write) {
+    data_to_write = buffer;
+    bytes_to_write = source->read(buffer, length);
+  }
 
-  // Get the current audio data
-  const uint8_t* data_to_write = audio_ctx->audio_data.data() + audio_ctx->playback_index;
+  // Copy for the playback event channel while Dart listens, before the
+  // volume applies
+  PlaybackTap& tap = audio_ctx->playback_tap;
+  if (bytes_to_write > 0 && tap.listening.load(std::memory_order_relaxed)) {
+    const size_t accepted = tap.ring.write(data_to_write, bytes_to_write);
+    if (accepted < bytes_to_write) {
+      tap.dropped_frames.fetch_add((bytes_to_write - accepted) / frame_bytes,
+                                   std::memory_order_relaxed);
+    }
+  }
 
-  // Write data to stream
-  pa_stream_write(s,
-                  data_to_write,
-                  bytes_to_write,
-                  nullptr,
-                  0,
-                  PA_SEEK_RELATIVE);
+  // Render at the current volume
+  if (data_to_write == buffer) {
+    scale_pcm16(reinterpret_cast<int16_t*>(buffer), bytes_to_write / sizeof(int16_t), gain);
+  } else {
+    render_pcm16(reinterpret_cast<const int16_t*>(data_to_write),
+                 reinterpret_cast<int16_t*>(buffer), bytes_to_write / sizeof(int16_t), gain);
+  }
+  memset(buffer + bytes_to_write, 0, length - bytes_to_write);
 
-  // Send audio data to Flutter via event channel
-  if (audio_ctx->playback_event_channel) {
-    // Create a list of integers from the audio data
-    g_autoptr(FlValue) list = fl_value_new_list();
-    for (size_t i = 0; i < bytes_to_write; i++) {
-      fl_value_append_take(list, fl_value_new_int(data_to_write[i]));
+  // Update position
+  audio_ctx->current_position = source->position_frames() / (double)audio_ctx->sample_rate;
+
+  // Note when the source runs dry before the end, and when it catches up;
+  // the main thread turns this into events
+  const bool underrun = bytes_to_write < length && !source->at_end();
+  if (underrun != audio_ctx->underrun) {
+    audio_ctx->underrun = underrun;
+    if (underrun) {
+      audio_ctx->playback_state.underruns.fetch_add(1, std::memory_order_release);
     }
+    audio_ctx->playback_state.underrun.store(underrun, std::memory_order_release);
+  }
+}
 
-    // Create event data
-    g_autoptr(FlValue) event = fl_value_new_map();
-    fl_value_set_string_take(event, "event", fl_value_new_string("data"));
-    fl_value_set_string_take(event, "data", g_steal_pointer(&list));
+// Microphone capture callback
+static void capture_recording(const uint8_t* data, size_t length, void* user_data) {
+  auto* audio_ctx = static_cast<AudioContext*>(user_data);
+  if (audio_ctx->is_recording) {
+    send_capture_data(&audio_ctx->recording_delivery, data, length);
+  }
+}
 
-    // Send the event
-    fl_event_channel_send(audio_ctx->playback_event_channel, event, nullptr, nullptr, nullptr);
+// System audio capture callback
+static void capture_system_sound(const uint8_t* data, size_t length, void* user_data) {
+  auto* audio_ctx = static_cast<AudioContext*>(user_data);
+  if (audio_ctx->is_capturing_system) {
+    send_capture_data(&audio_ctx->system_sound_delivery, data, length);
   }
+}
 
-  audio_ctx->playback_index += bytes_to_write;
+// ==================== Backend Lifecycle ====================
 
-  // Update position
-  double bytes_per_second = audio_ctx->sample_rate * audio_ctx->channels * sizeof(int16_t);
-  audio_ctx->current_position = audio_ctx->playback_index / bytes_per_second;
+// Creates the backend selected by the environment and opens it on first use.
+static bool ensure_audio_backend(AudioContext* audio_ctx) {
+  if (!audio_ctx->backend) {
+    audio_ctx->backend = audio_backend_new_from_environment();
+    g_print("Using %s audio backend\n", audio_ctx->backend->name());
+  }
+  return audio_ctx->backend->open();
+}
+
+static void cleanup_audio_backend(AudioContext* audio_ctx) {
+  if (audio_ctx && audio_ctx->backend) {
+    audio_ctx->backend->close();
+    audio_ctx->backend.reset();
+  }
+  // The mixer outlives its stream
+  if (audio_ctx && audio_ctx->mixer_backend) {
+    audio_ctx->mixer_backend->close();
+    audio_ctx->mixer_backend.reset();
+    audio_ctx->mixer.reset();
+  }
 }
 
-static void stream_read_cb(pa_stream* s, size_t nbytes, void* userdata) {
-  auto* audio_ctx = static_cast<AudioContext*>(userdata);
+// Renders the mixer's next period. Runs on the mixer backend's audio thread.
+static void render_mixer(uint8_t* buffer, size_t length, void* user_data) {
+  static_cast<Mixer*>(user_data)->render(reinterpret_cast<int16_t*>(buffer),
+                                         length / (Mixer::kChannels * sizeof(int16_t)));
+}
 
-  if (!audio_ctx || !audio_ctx->is_recording) {
+// Stops the mixer's stream and drops its voices.
+static void stop_mixer(AudioContext* audio_ctx) {
+  if (!audio_ctx->mixer) {
     return;
   }
+  audio_ctx->mixer_backend->lock();
+  audio_ctx->mixer_backend->stop_playback();
+  audio_ctx->mixer_backend->unlock();
+  audio_ctx->mixer.reset();
+}
 
-  const void* data;
-  if (pa_stream_peek(s, &data, &nbytes) < 0) {
-    return;
+// Starts the mixer's stream at |sample_rate| unless it already runs at that
+// rate. The stream keeps running while idle, so a new sound starts within
+// one period.
+static bool ensure_mixer(AudioContext* audio_ctx, int sample_rate, int latency_ms) {
+  if (audio_ctx->mixer && audio_ctx->mixer->sample_rate() == sample_rate) {
+    return true;
   }
+  stop_mixer(audio_ctx);
 
-  if (data) {
-    // Send audio data to Flutter via event channel
-    if (audio_ctx->recording_event_channel) {
-      const uint8_t* byte_data = static_cast<const uint8_t*>(data);
+  if (!audio_ctx->mixer_backend) {
+    audio_ctx->mixer_backend = audio_backend_new_from_environment(".mixer.wav");
+  }
+  if (!audio_ctx->mixer_backend->open()) {
+    return false;
+  }
 
-      g_autoptr(FlValue) list = fl_value_new_list();
-      for (size_t i = 0; i < nbytes; i++) {
-        fl_value_append_take(list, fl_value_new_int(byte_data[i]));
-      }
+  auto mixer = std::make_unique<Mixer>(sample_rate);
+  AudioStreamConfig config;
+  config.sample_rate = sample_rate;
+  config.channels = Mixer::kChannels;
+  config.latency_ms = latency_ms;
+  audio_ctx->mixer_backend->lock();
+  const bool started =
+      audio_ctx->mixer_backend->start_playback(config, render_mixer, mixer.get());
+  audio_ctx->mixer_backend->unlock();
+  if (!started) {
+    return false;
+  }
+  audio_ctx->mixer = std::move(mixer);
+  return true;
+}
 
-      g_autoptr(FlValue) event = fl_value_new_map();
-      fl_value_set_string_take(event, "event", fl_value_new_string("data"));
-      fl_value_set_string_take(event, "data", g_steal_pointer(&list));
+// ==================== Helper Functions ====================
 
-      fl_event_channel_send(audio_ctx->recording_event_channel, event, nullptr, nullptr, nullptr);
-    }
+static bool is_url(const std::string& path) {
+  return (path.find("http://") == 0 || path.find("https://") == 0);
+}
 
-    // Store recorded data
-    size_t old_size = audio_ctx->recorded_data.size();
-    audio_ctx->recorded_data.resize(old_size + nbytes);
-    std::memcpy(audio_ctx->recorded_data.data() + old_size, data, nbytes);
+// Reads the optional "format" argument of the capture methods.
+static DeliveryFormat parse_delivery_format(FlValue* args) {
+  FlValue* format_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                              ? fl_value_lookup_string(args, "format")
+                              : nullptr;
+  if (format_value && fl_value_get_type(format_value) == FL_VALUE_TYPE_STRING &&
+      strcmp(fl_value_get_string(format_value), "float32") == 0) {
+    return DeliveryFormat::kFloat32;
   }
+  return DeliveryFormat::kPcm16;
+}
 
-  pa_stream_drop(s);
+// Reads the optional "packetDurationMs" argument of the capture methods.
+static int parse_packet_duration_ms(FlValue* args) {
+  FlValue* duration_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                                ? fl_value_lookup_string(args, "packetDurationMs")
+                                : nullptr;
+  if (duration_value && fl_value_get_type(duration_value) == FL_VALUE_TYPE_INT) {
+    return (int)fl_value_get_int(duration_value);
+  }
+  return 0;
 }
 
-// System audio capture callback (using PulseAudio monitor)
-static void monitor_read_cb(pa_stream* s, size_t nbytes, void* userdata) {
-  auto* audio_ctx = static_cast<AudioContext*>(userdata);
+// Sets |ring| to the capture ring selected by a "transport": "ring"
+// argument, or to null when captured PCM should go over the event channel.
+// Without an explicit "ringCapacityBytes" a new ring holds two seconds of
+// audio. Returns an error message for arguments the ring cannot honour: it
+// carries s16 only, has no packets or queue, and keeps its first capacity.
+static const gchar* parse_capture_ring(FlValue* args, int ring_id, int sample_rate,
+                                       int channels, CaptureRing** ring) {
+  *ring = nullptr;
+  if (!args || fl_value_get_type(args) != FL_VALUE_TYPE_MAP) {
+    return nullptr;
+  }
+  FlValue* transport_value = fl_value_lookup_string(args, "transport");
+  if (!transport_value || fl_value_get_type(transport_value) != FL_VALUE_TYPE_STRING ||
+      strcmp(fl_value_get_string(transport_value), "ring") != 0) {
+    return nullptr;
+  }
 
-  if (!audio_ctx || !audio_ctx->is_capturing_system) {
-    return;
+  if (parse_delivery_format(args) != DeliveryFormat::kPcm16) {
+    return "The ring transport only carries pcm16";
+  }
+  static const char* const kQueueArguments[] = {"packetDurationMs", "maxQueuedPackets",
+                                                "overflowPolicy"};
+  for (const char* name : kQueueArguments) {
+    if (fl_value_lookup_string(args, name)) {
+      return "packetDurationMs, maxQueuedPackets and overflowPolicy do not apply to the "
+             "ring transport";
+    }
   }
 
-  const void* data;
-  if (pa_stream_peek(s, &data, &nbytes) < 0) {
-    return;
+  size_t capacity = (size_t)sample_rate * channels * sizeof(int16_t) * 2;
+  FlValue* capacity_value = fl_value_lookup_string(args, "ringCapacityBytes");
+  const bool explicit_capacity = capacity_value &&
+                                 fl_value_get_type(capacity_value) == FL_VALUE_TYPE_INT &&
+                                 fl_value_get_int(capacity_value) > 0;
+  if (explicit_capacity) {
+    capacity = (size_t)fl_value_get_int(capacity_value);
   }
 
-  if (data) {
-    // Send system audio data to Flutter
-    if (audio_ctx->system_sound_event_channel) {
-      const uint8_t* byte_data = static_cast<const uint8_t*>(data);
+  CaptureRing* existing = capture_ring_lookup(ring_id);
+  if (existing && explicit_capacity) {
+    // The ring rounds its capacity up to a power of two
+    const size_t existing_capacity = existing->buffer.capacity();
+    if (capacity > existing_capacity || capacity <= existing_capacity / 2) {
+      return "ringCapacityBytes differs from the existing capture ring";
+    }
+  }
+  *ring = capture_ring_get_or_create(ring_id, capacity);
+  return nullptr;
+}
 
-      g_autoptr(FlValue) list = fl_value_new_list();
-      for (size_t i = 0; i < nbytes; i++) {
-        fl_value_append_take(list, fl_value_new_int(byte_data[i]));
-      }
+// Reads the optional "overflowPolicy" argument of the capture methods.
+static OverflowPolicy parse_overflow_policy(FlValue* args) {
+  FlValue* policy_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                              ? fl_value_lookup_string(args, "overflowPolicy")
+                              : nullptr;
+  if (policy_value && fl_value_get_type(policy_value) == FL_VALUE_TYPE_STRING) {
+    const gchar* policy = fl_value_get_string(policy_value);
+    if (strcmp(policy, "dropNewest") == 0) {
+      return OverflowPolicy::kDropNewest;
+    }
+    if (strcmp(policy, "block") == 0) {
+      return OverflowPolicy::kBlock;
+    }
+  }
+  return OverflowPolicy::kDropOldest;
+}
 
-      g_autoptr(FlValue) event = fl_value_new_map();
-      fl_value_set_string_take(event, "event", fl_value_new_string("data"));
-      fl_value_set_string_take(event, "data", g_steal_pointer(&list));
+// Reads the optional "maxQueuedPackets" argument of the capture methods.
+static size_t parse_max_queued_packets(FlValue* args) {
+  FlValue* max_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                           ? fl_value_lookup_string(args, "maxQueuedPackets")
+                           : nullptr;
+  if (max_value && fl_value_get_type(max_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(max_value) > 0) {
+    return (size_t)fl_value_get_int(max_value);
+  }
+  return kDefaultMaxQueuedPackets;
+}
 
-      fl_event_channel_send(audio_ctx->system_sound_event_channel, event, nullptr, nullptr, nullptr);
-    }
+// Reads the optional "fragmentMs" argument of the capture methods.
+static int parse_fragment_ms(FlValue* args) {
+  FlValue* fragment_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                                ? fl_value_lookup_string(args, "fragmentMs")
+                                : nullptr;
+  if (fragment_value && fl_value_get_type(fragment_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(fragment_value) > 0) {
+    return (int)fl_value_get_int(fragment_value);
   }
+  return kDefaultFragmentMs;
+}
 
-  pa_stream_drop(s);
+// Builds the capture stream config from the optional "sampleRate",
+// "channels" and "fragmentMs" arguments. Samples are always captured as s16;
+// a "format" of float32 is converted on delivery.
+static AudioStreamConfig parse_capture_config(FlValue* args, int default_rate,
+                                              int default_channels) {
+  AudioStreamConfig config;
+  config.sample_rate = default_rate;
+  config.channels = default_channels;
+  config.fragment_ms = parse_fragment_ms(args);
+
+  if (args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP) {
+    FlValue* rate_value = fl_value_lookup_string(args, "sampleRate");
+    if (rate_value && fl_value_get_type(rate_value) == FL_VALUE_TYPE_INT) {
+      config.sample_rate = (int)fl_value_get_int(rate_value);
+    }
+    FlValue* channels_value = fl_value_lookup_string(args, "channels");
+    if (channels_value && fl_value_get_type(channels_value) == FL_VALUE_TYPE_INT) {
+      config.channels = (int)fl_value_get_int(channels_value);
+    }
+  }
+  return config;
 }
 
-// ==================== PulseAudio Initialization ====================
+// Prepares a capture stream's delivery state from the method arguments.
+// Returns an error message when the arguments do not fit the selected
+// transport, or null.
+static const gchar* configure_capture_delivery(CaptureDelivery* delivery,
+                                               FlEventChannel* channel, FlValue* args,
+                                               int ring_id, int sample_rate, int channels) {
+  const gchar* error = parse_capture_ring(args, ring_id, sample_rate, channels, &delivery->ring);
+  if (error) {
+    return error;
+  }
+  delivery->format = parse_delivery_format(args);
+  delivery->frame_bytes = channels * sizeof(int16_t);
+  packet_coalescer_reset(&delivery->coalescer,
+                         packet_bytes_for_duration(parse_packet_duration_ms(args), sample_rate,
+                                                   delivery->frame_bytes));
+  event_queue_reset(&delivery->events, channel, parse_max_queued_packets(args),
+                    parse_overflow_policy(args));
+  return nullptr;
+}
 
-static bool init_pulse_audio(AudioContext* audio_ctx) {
-  if (!audio_ctx) return false;
+FlMethodResponse* get_platform_version() {
+  struct utsname uname_data = {};
+  uname(&uname_data);
+  g_autofree gchar *version = g_strdup_printf("Linux %s", uname_data.version);
+  g_autoptr(FlValue) result = fl_value_new_string(version);
+  return FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+}
 
-  audio_ctx->mainloop = pa_mainloop_new();
-  if (!audio_ctx->mainloop) {
-    g_printerr("Failed to create PulseAudio mainloop\n");
-    return false;
+// ==================== Playback Setup ====================
+
+// Reads the optional "latencyMs" argument of play. 0 keeps the server's
+// default buffering.
+static int parse_latency_ms(FlValue* args) {
+  FlValue* latency_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                               ? fl_value_lookup_string(args, "latencyMs")
+                               : nullptr;
+  if (latency_value && fl_value_get_type(latency_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(latency_value) > 0) {
+    return (int)fl_value_get_int(latency_value);
   }
+  return 0;
+}
 
-  audio_ctx->mainloop_api = pa_mainloop_get_api(audio_ctx->mainloop);
+// Reads the optional "prebufferMs" argument of play: how much audio from a
+// URL is decoded before the output starts.
+static int parse_prebuffer_ms(FlValue* args) {
+  FlValue* prebuffer_value = args && fl_value_get_type(args) == FL_VALUE_TYPE_MAP
+                                 ? fl_value_lookup_string(args, "prebufferMs")
+                                 : nullptr;
+  if (prebuffer_value && fl_value_get_type(prebuffer_value) == FL_VALUE_TYPE_INT &&
+      fl_value_get_int(prebuffer_value) >= 0) {
+    return (int)fl_value_get_int(prebuffer_value);
+  }
+  return kDefaultPrebufferMs;
+}
 
-  audio_ctx->context = pa_context_new(audio_ctx->mainloop_api, "FlutterF2FSound");
-  if (!audio_ctx->context) {
-    g_printerr("Failed to create PulseAudio context\n");
+bool raw_format_from_mime(const char* mime, SF_INFO* info) {
+  g_auto(GStrv) parts = g_strsplit(mime, ";", -1);
+  if (!parts[0]) {
+    return false;
+  }
+  g_autofree gchar* type = g_ascii_strdown(g_strstrip(parts[0]), -1);
+  int format = 0;
+  if (strcmp(type, "audio/l16") == 0) {
+    format = SF_FORMAT_RAW | SF_FORMAT_PCM_16 | SF_ENDIAN_BIG;
+  } else if (strcmp(type, "audio/l24") == 0) {
+    format = SF_FORMAT_RAW | SF_FORMAT_PCM_24 | SF_ENDIAN_BIG;
+  } else if (strcmp(type, "audio/pcm") == 0) {
+    format = SF_FORMAT_RAW | SF_FORMAT_PCM_16 | SF_ENDIAN_LITTLE;
+  } else {
     return false;
   }
 
-  pa_context_set_state_callback(audio_ctx->context, context_state_cb, audio_ctx);
-
-  if (pa_context_connect(audio_ctx->context, nullptr, PA_CONTEXT_NOAUTOSPAWN, nullptr) < 0) {
-    g_printerr("Failed to connect to PulseAudio: %s\n",
-               pa_strerror(pa_context_errno(audio_ctx->context)));
+  int rate = 0;
+  int channels = 1;
+  for (gchar** part = parts + 1; *part; part++) {
+    gchar* parameter = g_strstrip(*part);
+    if (g_ascii_strncasecmp(parameter, "rate=", 5) == 0) {
+      rate = atoi(parameter + 5);
+    } else if (g_ascii_strncasecmp(parameter, "channels=", 9) == 0) {
+      channels = atoi(parameter + 9);
+    }
+  }
+  if (rate <= 0 || channels <= 0) {
     return false;
   }
+  memset(info, 0, sizeof(*info));
+  info->format = format;
+  info->samplerate = rate;
+  info->channels = channels;
+  return true;
+}
 
-  // Wait for context to be ready
-  while (pa_context_get_state(audio_ctx->context) != PA_CONTEXT_READY) {
-    pa_mainloop_iterate(audio_ctx->mainloop, 1, nullptr);
+// Waits until |decoder| holds |prebuffer_ms| of audio, has decoded the whole
+// input or |job| is cancelled. Runs on a worker.
+static void wait_for_prebuffer(const StreamingDecoder* decoder, int prebuffer_ms,
+                               const WorkerJob& job) {
+  const size_t target = (size_t)decoder->sample_rate() * prebuffer_ms / 1000;
+  while (decoder->buffered_frames() < target && !decoder->fully_decoded() && !job.cancelled()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
   }
+}
 
+// Replaces the current playback with |source| and starts a backend stream
+// for it. The render callback reads the source on the audio thread, so the
+// hand-over happens under the backend lock.
+static bool start_playback_stream(AudioContext* audio_ctx, std::unique_ptr<AudioSource> source,
+                                  double volume, int latency_ms) {
+  // Released after the lock so joining a decoder thread never stalls the
+  // audio thread
+  std::unique_ptr<AudioSource> previous_source;
+
+  BackendLock lock(audio_ctx);
+  audio_ctx->backend->stop_playback();
+
+  previous_source = std::move(audio_ctx->source);
+  audio_ctx->source = std::move(source);
+  audio_ctx->pcm_sink = nullptr;
+  audio_ctx->sample_rate = audio_ctx->source->sample_rate();
+  audio_ctx->channels = audio_ctx->source->channels();
+  audio_ctx->is_playing = true;
+  audio_ctx->underrun = false;
+  audio_ctx->playback_state.underrun = false;
+  audio_ctx->playback_state.reported_underrun = false;
+  audio_ctx->playback_state.reported_underruns = audio_ctx->playback_state.underruns.load();
+  audio_ctx->current_position = 0.0;
+  audio_ctx->volume = volume;
+  audio_ctx->duration = audio_ctx->source->frames() / (double)audio_ctx->sample_rate;
+
+  AudioStreamConfig config;
+  config.sample_rate = audio_ctx->sample_rate;
+  config.channels = audio_ctx->channels;
+  config.latency_ms = latency_ms;
+  if (!audio_ctx->backend->start_playback(config, render_playback, audio_ctx)) {
+    audio_ctx->is_playing = false;
+    return false;
+  }
   return true;
 }
 
-static void cleanup_pulse_audio(AudioContext* audio_ctx) {
-  if (!audio_ctx) return;
+// Reads the duration of a local file from its header. Runs on a worker.
+static double probe_duration(const std::string& path) {
+  SF_INFO sfinfo;
+  memset(&sfinfo, 0, sizeof(sfinfo));
+  SNDFILE* sndfile = sf_open(path.c_str(), SFM_READ, &sfinfo);
+  if (!sndfile) {
+    return 0.0;
+  }
+  double duration = sfinfo.samplerate > 0 ? (double)sfinfo.frames / sfinfo.samplerate : 0.0;
+  sf_close(sndfile);
+  return duration;
+}
 
-  if (audio_ctx->playback_stream) {
-    pa_stream_unref(audio_ctx->playback_stream);
-    audio_ctx->playback_stream = nullptr;
+// Opens a local file for playback: uncompressed WAV straight from a memory
+// mapping, other files from the decoded-PCM cache when they are short enough
+// to be kept there, otherwise as a stream. Runs on a worker.
+static std::unique_ptr<AudioSource> open_local_source(PcmCache* pcm_cache, const std::string& path) {
+  std::unique_ptr<AudioSource> mapped = MappedWavSource::open(path);
+  if (mapped) {
+    return mapped;
   }
+  std::shared_ptr<const DecodedPcm> pcm = pcm_cache->get(path);
+  if (pcm) {
+    return std::unique_ptr<AudioSource>(new PcmBufferSource(std::move(pcm)));
+  }
+  return StreamingDecoder::open_file(path, kDecodeBufferMs);
+}
+
+// State handed from a worker back to the main thread for one play() call.
+struct PendingPlayback {
+  FlutterF2fSoundPlugin* plugin = nullptr;
+  FlMethodCall* method_call = nullptr;
+  std::string path;
+  double volume = 1.0;
+  int latency_ms = 0;
+  int prebuffer_ms = 0;
+  uint64_t generation = 0;
+  std::unique_ptr<AudioSource> source;
+};
+
+// Starts the playback a worker prepared, unless a newer play() or stop()
+// has superseded it in the meantime.
+static void finish_pending_playback(PendingPlayback* playback, const WorkerJob& job) {
+  AudioContext* audio_ctx = playback->plugin->audio_ctx;
+  const bool downloaded = is_url(playback->path);
 
-  if (audio_ctx->record_stream) {
-    pa_stream_unref(audio_ctx->record_stream);
-    audio_ctx->record_stream = nullptr;
+  g_autoptr(FlMethodResponse) response = nullptr;
+  if (audio_ctx && (job.cancelled() || playback->generation != audio_ctx->playback_generation)) {
+    g_print("Discarding superseded playback of %s\n", playback->path.c_str());
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  } else if (!playback->source || !audio_ctx) {
+    response = downloaded
+        ? FL_METHOD_RESPONSE(fl_method_error_response_new("DOWNLOAD_ERROR", "Failed to download audio", nullptr))
+        : FL_METHOD_RESPONSE(fl_method_error_response_new("LOAD_ERROR", "Failed to load audio file", nullptr));
+  } else {
+    if (start_playback_stream(audio_ctx, std::move(playback->source), playback->volume,
+                              playback->latency_ms)) {
+      g_print("Playing audio: %s (%.2f seconds)\n", playback->path.c_str(), audio_ctx->duration.load());
+      if (downloaded) {
+        playback_state_send(audio_ctx, "ready");
+      }
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(
+          fl_method_error_response_new("STREAM_ERROR", "Failed to create playback stream", nullptr));
+    }
+  }
+  if (audio_ctx && audio_ctx->playback_job.get() == &job) {
+    audio_ctx->playback_job.reset();
   }
 
-  if (audio_ctx->monitor_stream) {
-    pa_stream_unref(audio_ctx->monitor_stream);
-    audio_ctx->monitor_stream = nullptr;
+  fl_method_call_respond(playback->method_call, response, nullptr);
+  fl_method_call_unref(playback->method_call);
+  g_object_unref(playback->plugin);
+}
+
+// Abandons whatever an earlier play() is still loading.
+static void supersede_pending_playback(AudioContext* audio_ctx) {
+  audio_ctx->playback_generation++;
+  if (audio_ctx->playback_job) {
+    audio_ctx->playback_job->cancel();
+    audio_ctx->playback_job.reset();
   }
+}
+
+// Supersedes the previous track and describes a new one with the playback
+// options of |args|, responding to |method_call| once it starts.
+static std::shared_ptr<PendingPlayback> pending_playback_new(FlutterF2fSoundPlugin* self,
+                                                             FlMethodCall* method_call,
+                                                             FlValue* args,
+                                                             const std::string& path) {
+  FlValue* volume_value = fl_value_lookup_string(args, "volume");
+
+  // A newer track aborts the download or open of the previous one
+  supersede_pending_playback(self->audio_ctx);
+
+  auto playback = std::make_shared<PendingPlayback>();
+  playback->plugin = FLUTTER_F2F_SOUND_PLUGIN(g_object_ref(self));
+  playback->method_call = fl_method_call_ref(method_call);
+  playback->path = path;
+  playback->volume = volume_value ? fl_value_get_float(volume_value) : 1.0;
+  playback->latency_ms = parse_latency_ms(args);
+  playback->prebuffer_ms = parse_prebuffer_ms(args);
+  playback->generation = self->audio_ctx->playback_generation;
+  return playback;
+}
 
-  if (audio_ctx->context) {
-    pa_context_disconnect(audio_ctx->context);
-    pa_context_unref(audio_ctx->context);
-    audio_ctx->context = nullptr;
+// Returns the sink named by the "handle" argument while it is still the one
+// playing, or null.
+static PcmSink* lookup_pcm_sink(AudioContext* audio_ctx, FlValue* args) {
+  FlValue* handle_value = fl_value_lookup_string(args, "handle");
+  if (!handle_value || fl_value_get_type(handle_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(handle_value) != audio_ctx->pcm_sink_handle) {
+    return nullptr;
   }
+  return audio_ctx->pcm_sink;
+}
 
-  if (audio_ctx->mainloop) {
-    pa_mainloop_free(audio_ctx->mainloop);
-    audio_ctx->mainloop = nullptr;
+// Reads the optional "gain", "pan", "rate" and "loop" arguments of playSound
+// and setVoice over |params|.
+static void parse_voice_params(FlValue* args, Mixer::VoiceParams* params) {
+  FlValue* gain_value = fl_value_lookup_string(args, "gain");
+  FlValue* pan_value = fl_value_lookup_string(args, "pan");
+  FlValue* rate_value = fl_value_lookup_string(args, "rate");
+  FlValue* loop_value = fl_value_lookup_string(args, "loop");
+  if (gain_value && fl_value_get_type(gain_value) == FL_VALUE_TYPE_FLOAT) {
+    params->gain = (float)fl_value_get_float(gain_value);
+  }
+  if (pan_value && fl_value_get_type(pan_value) == FL_VALUE_TYPE_FLOAT) {
+    params->pan = (float)fl_value_get_float(pan_value);
+  }
+  if (rate_value && fl_value_get_type(rate_value) == FL_VALUE_TYPE_FLOAT) {
+    params->rate = (float)fl_value_get_float(rate_value);
+  }
+  if (loop_value && fl_value_get_type(loop_value) == FL_VALUE_TYPE_BOOL) {
+    params->loop = fl_value_get_bool(loop_value);
   }
 }
 
-// ==================== Helper Functions ====================
+// Reads a voice or sample id argument, or 0.
+static uint32_t parse_id(FlValue* args, const char* name) {
+  FlValue* id_value = fl_value_lookup_string(args, name);
+  if (!id_value || fl_value_get_type(id_value) != FL_VALUE_TYPE_INT ||
+      fl_value_get_int(id_value) <= 0 || fl_value_get_int(id_value) > UINT32_MAX) {
+    return 0;
+  }
+  return (uint32_t)fl_value_get_int(id_value);
+}
 
-static bool is_url(const std::string& path) {
-  return (path.find("http://") == 0 || path.find("https://") == 0);
+// Starts the mixer at its current rate, or the default one if it is not
+// running.
+static bool ensure_default_mixer(AudioContext* audio_ctx) {
+  return ensure_mixer(audio_ctx,
+                      audio_ctx->mixer ? audio_ctx->mixer->sample_rate() : kDefaultMixerSampleRate,
+                      kDefaultMixerLatencyMs);
 }
 
 // ==================== Method Handler ====================
@@ -442,216 +1285,449 @@ static void flutter_f2f_sound_plugin_handle_method_call(
   }
 
   if (strcmp(method, "getPlatformVersion") == 0) {
-    struct utsname uname_data = {};
-    uname(&uname_data);
-    g_autofree gchar *version = g_strdup_printf("Linux %s", uname_data.version);
-    g_autoptr(FlValue) result = fl_value_new_string(version);
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    response = get_platform_version();
   }
   else if (strcmp(method, "play") == 0) {
-    FlValue* path_value = fl_value_get_map_value(args, fl_value_new_string("path"));
-    FlValue* volume_value = fl_value_get_map_value(args, fl_value_new_string("volume"));
+    FlValue* path_value = fl_value_lookup_string(args, "path");
 
     if (!path_value || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
-      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Path is required"));
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Path is required", nullptr));
+    } else if (!ensure_audio_backend(self->audio_ctx)) {
+      // Initialize PulseAudio if needed
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to initialize audio", nullptr));
     } else {
       const gchar* path = fl_value_get_string(path_value);
-      double volume = volume_value ? fl_value_get_float(volume_value) : 1.0;
+      std::shared_ptr<PendingPlayback> playback =
+          pending_playback_new(self, method_call, args, path);
 
-      // Initialize PulseAudio if needed
-      if (!self->audio_ctx->context && !init_pulse_audio(self->audio_ctx)) {
-        response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to initialize audio"));
-      } else {
-        std::vector<uint8_t> audio_data;
-        int sample_rate = 44100;
-        int channels = 2;
-
-        // Load audio file (local or network)
-        if (is_url(path)) {
-          g_print("Downloading audio from: %s\n", path);
-          
-          // Create a copy of the path for thread safety
-          std::string url_path = path;
-          FlutterF2fSoundPlugin* plugin_ptr = self;
-          FlMethodCall* method_call_copy = fl_method_call_ref(method_call);
-          
-          // Start asynchronous download in a separate thread
-          std::thread download_thread([plugin_ptr, url_path, method_call_copy]() {
-            std::vector<uint8_t> audio_data;
-            int sample_rate = 44100;
-            int channels = 2;
-            
-            bool success = download_audio_file(url_path, audio_data);
-            
-            // Create a response on the main thread
-            g_main_context_invoke(nullptr, [plugin_ptr, url_path, audio_data, sample_rate, channels, success, method_call_copy]() {
-              if (!success) {
-                g_autoptr(FlMethodResponse) error_response = FL_METHOD_RESPONSE(
-                    fl_method_error_response_new("DOWNLOAD_ERROR", "Failed to download audio"));
-                fl_method_call_respond(method_call_copy, error_response, nullptr);
-              } else {
-                // Try to parse as audio file using libsndfile
-                // For downloaded data, we'd need to save to temp file first
-                // For now, use the raw data
-                plugin_ptr->audio_ctx->audio_data = audio_data;
-                plugin_ptr->audio_ctx->sample_rate = sample_rate;
-                plugin_ptr->audio_ctx->channels = channels;
-                
-                // Continue with playback setup
-                plugin_ptr->audio_ctx->is_playing = true;
-                plugin_ptr->audio_ctx->current_position = 0.0;
-                plugin_ptr->audio_ctx->volume = fl_value_get_float(fl_value_get_map_value(
-                    fl_method_call_get_args(method_call_copy), fl_value_new_string("volume")));
-                plugin_ptr->audio_ctx->playback_index = 0;
-                
-                // Create playback stream
-                pa_sample_spec ss;
-                ss.format = PA_SAMPLE_S16LE;
-                ss.rate = plugin_ptr->audio_ctx->sample_rate;
-                ss.channels = plugin_ptr->audio_ctx->channels;
-                
-                plugin_ptr->audio_ctx->playback_stream = pa_stream_new(
-                    plugin_ptr->audio_ctx->context,
-                    "FlutterF2FSound Playback",
-                    &ss,
-                    nullptr);
-                
-                if (plugin_ptr->audio_ctx->playback_stream) {
-                  pa_stream_set_write_callback(plugin_ptr->audio_ctx->playback_stream, stream_write_cb, plugin_ptr->audio_ctx);
-                  
-                  // Connect stream to default output
-                  pa_stream_connect_playback(
-                      plugin_ptr->audio_ctx->playback_stream,
-                      nullptr,
-                      nullptr,
-                      PA_STREAM_START_CORKED,
-                      nullptr,
-                      nullptr);
-                  
-                  // Start playback
-                  pa_stream_cork(plugin_ptr->audio_ctx->playback_stream, 0, nullptr, nullptr);
-                  
-                  g_print("Playing audio: %s (%.2f seconds)\n", url_path.c_str(),
-                          audio_data.size() / (double)(sample_rate * channels * sizeof(int16_t)));
-                  
-                  g_autoptr(FlMethodResponse) success_response = FL_METHOD_RESPONSE(
-                      fl_method_success_response_new(nullptr));
-                  fl_method_call_respond(method_call_copy, success_response, nullptr);
-                } else {
-                  g_autoptr(FlMethodResponse) error_response = FL_METHOD_RESPONSE(
-                      fl_method_error_response_new("STREAM_ERROR", "Failed to create playback stream"));
-                  fl_method_call_respond(method_call_copy, error_response, nullptr);
-                }
-              }
-              
-              fl_method_call_unref(method_call_copy);
-            });
+      WorkerPool::Callback load;
+      if (is_url(path)) {
+        // Play a current cached copy from disk; otherwise decode while
+        // downloading and start once the pre-buffer is full
+        g_print("Streaming audio from: %s\n", path);
+        playback_state_send(self->audio_ctx, "buffering");
+        std::shared_ptr<AudioCache> cache = self->audio_ctx->audio_cache;
+        std::shared_ptr<PcmCache> pcm_cache = self->audio_ctx->pcm_cache;
+        std::shared_ptr<HttpConnectionPool> pool = self->audio_ctx->http_pool;
+        load = [playback, cache, pcm_cache, pool](WorkerJob& job) {
+          AudioCache::Entry entry;
+          if (cache->lookup(playback->path, &entry) && cache->revalidate(playback->path, entry)) {
+            g_print("Playing cached copy: %s\n", entry.path.c_str());
+            playback->source = open_local_source(pcm_cache.get(), entry.path);
+            if (playback->source || job.cancelled()) {
+              return;
+            }
+          }
+
+          const std::string url = playback->path;
+          std::shared_ptr<HttpStream> stream = HttpStream::start(url, pool, [cache, url](HttpStream& stream) {
+            // Without validators a copy could never be reused
+            const HttpValidators validators = stream.validators();
+            if (!validators.empty()) {
+              cache->store(url, validators, [&stream](FILE* file) { return stream.write_to(file); });
+            }
           });
-          
-          // Detach the thread to allow it to run independently
-          download_thread.detach();
-          
-          // Return early since we'll respond asynchronously
-          return;
-        } else {
-          // Load local file using libsndfile
-          if (!load_audio_file(path, audio_data, sample_rate, channels)) {
-            response = FL_METHOD_RESPONSE(fl_method_error_response_new("LOAD_ERROR", "Failed to load audio file"));
-          } else {
-            self->audio_ctx->audio_data = audio_data;
-            self->audio_ctx->sample_rate = sample_rate;
-            self->audio_ctx->channels = channels;
+          job.on_cancel([stream]() { stream->interrupt(); });
+          std::unique_ptr<StreamingDecoder> decoder = StreamingDecoder::open_virtual(
+              stream, std::max(kDecodeBufferMs, 2 * playback->prebuffer_ms));
+          if (decoder) {
+            wait_for_prebuffer(decoder.get(), playback->prebuffer_ms, job);
           }
-        }
+          job.on_cancel(nullptr);
+          if (!job.cancelled()) {
+            playback->source = std::move(decoder);
+          }
+        };
+      } else {
+        // Open the file off the platform thread, and decode it whole or its
+        // first chunks
+        std::shared_ptr<PcmCache> pcm_cache = self->audio_ctx->pcm_cache;
+        load = [playback, pcm_cache](WorkerJob& job) {
+          playback->source = open_local_source(pcm_cache.get(), playback->path);
+          if (job.cancelled()) {
+            playback->source.reset();
+          }
+        };
+      }
+      self->audio_ctx->playback_job = self->audio_ctx->workers.post(
+          load,
+          [playback](WorkerJob& job) { finish_pending_playback(playback.get(), job); });
 
-        if (!response) {
-          self->audio_ctx->is_playing = true;
-          self->audio_ctx->current_position = 0.0;
-          self->audio_ctx->volume = volume;
-          self->audio_ctx->playback_index = 0;
-
-          // Create playback stream
-          pa_sample_spec ss;
-          ss.format = PA_SAMPLE_S16LE;
-          ss.rate = self->audio_ctx->sample_rate;
-          ss.channels = self->audio_ctx->channels;
-
-          self->audio_ctx->playback_stream = pa_stream_new(
-              self->audio_ctx->context,
-              "FlutterF2FSound Playback",
-              &ss,
-              nullptr);
-
-          if (!self->audio_ctx->playback_stream) {
-            response = FL_METHOD_RESPONSE(fl_method_error_response_new("STREAM_ERROR", "Failed to create playback stream"));
-          } else {
-            pa_stream_set_write_callback(self->audio_ctx->playback_stream, stream_write_cb, self->audio_ctx);
-
-            // Connect stream to default output
-            pa_stream_connect_playback(
-                self->audio_ctx->playback_stream,
-                nullptr,
-                nullptr,
-                PA_STREAM_START_CORKED,
-                nullptr,
-                nullptr);
-
-            // Start playback
-            pa_stream_cork(self->audio_ctx->playback_stream, 0, nullptr, nullptr);
-
-          g_print("Playing audio: %s (%.2f seconds)\n", path,
-                  audio_data.size() / (double)(sample_rate * channels * sizeof(int16_t)));
-          response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+      // Respond once the audio is loaded
+      return;
+    }
+  }
+  else if (strcmp(method, "playBytes") == 0) {
+    FlValue* bytes_value = fl_value_lookup_string(args, "bytes");
+    FlValue* mime_value = fl_value_lookup_string(args, "mimeHint");
+
+    if (!bytes_value || fl_value_get_type(bytes_value) != FL_VALUE_TYPE_UINT8_LIST) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Bytes are required", nullptr));
+    } else if (!ensure_audio_backend(self->audio_ctx)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to initialize audio", nullptr));
+    } else {
+      const uint8_t* data = fl_value_get_uint8_list(bytes_value);
+      const size_t length = fl_value_get_length(bytes_value);
+      g_autofree gchar* description = g_strdup_printf("%zu bytes from memory", length);
+      std::shared_ptr<PendingPlayback> playback =
+          pending_playback_new(self, method_call, args, description);
+
+      // Containers are recognised by their header; raw PCM needs the hint
+      SF_INFO raw_format = {};
+      const bool raw = mime_value && fl_value_get_type(mime_value) == FL_VALUE_TYPE_STRING &&
+                       raw_format_from_mime(fl_value_get_string(mime_value), &raw_format);
+
+      // The method call keeps |data| alive until the reply, so the worker
+      // copies it straight out of the message, once
+      WorkerPool::Callback load = [playback, data, length, raw, raw_format](WorkerJob& job) {
+        auto input = std::make_shared<MemoryInput>(std::vector<uint8_t>(data, data + length));
+        playback->source =
+            StreamingDecoder::open_virtual(input, kDecodeBufferMs, raw ? &raw_format : nullptr);
+        if (job.cancelled()) {
+          playback->source.reset();
         }
+      };
+      self->audio_ctx->playback_job = self->audio_ctx->workers.post(
+          load,
+          [playback](WorkerJob& job) { finish_pending_playback(playback.get(), job); });
+
+      // Respond once the audio is decoded
+      return;
+    }
+  }
+  else if (strcmp(method, "openPcmSink") == 0) {
+    FlValue* rate_value = fl_value_lookup_string(args, "sampleRate");
+    FlValue* channels_value = fl_value_lookup_string(args, "channels");
+    FlValue* format_value = fl_value_lookup_string(args, "format");
+    FlValue* target_value = fl_value_lookup_string(args, "targetLatencyMs");
+    FlValue* max_value = fl_value_lookup_string(args, "maxLatencyMs");
+    FlValue* volume_value = fl_value_lookup_string(args, "volume");
+    const char* format = format_value && fl_value_get_type(format_value) == FL_VALUE_TYPE_STRING
+                             ? fl_value_get_string(format_value)
+                             : "int16";
+
+    if (!rate_value || fl_value_get_type(rate_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(rate_value) < 8000 || fl_value_get_int(rate_value) > 384000 ||
+        !channels_value || fl_value_get_type(channels_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(channels_value) < 1 || fl_value_get_int(channels_value) > 8) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "sampleRate and channels are required", nullptr));
+    } else if (strcmp(format, "int16") != 0 && strcmp(format, "float32") != 0) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "format must be int16 or float32", nullptr));
+    } else if (!ensure_audio_backend(self->audio_ctx)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to initialize audio", nullptr));
+    } else {
+      const int target_ms = target_value && fl_value_get_type(target_value) == FL_VALUE_TYPE_INT
+                                ? (int)std::max<int64_t>(1, fl_value_get_int(target_value))
+                                : 40;
+      const int max_latency_ms = max_value && fl_value_get_type(max_value) == FL_VALUE_TYPE_INT
+                                     ? (int)std::max<int64_t>(0, fl_value_get_int(max_value))
+                                     : -1;
+      supersede_pending_playback(self->audio_ctx);
+
+      auto sink = std::make_unique<PcmSink>((int)fl_value_get_int(rate_value),
+                                            (int)fl_value_get_int(channels_value), target_ms,
+                                            max_latency_ms);
+      PcmSink* sink_ptr = sink.get();
+      if (!start_playback_stream(self->audio_ctx, std::move(sink),
+                                 volume_value ? fl_value_get_float(volume_value) : 1.0,
+                                 parse_latency_ms(args))) {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new("PLAYBACK_ERROR", "Failed to start playback stream", nullptr));
+      } else {
+        self->audio_ctx->pcm_sink = sink_ptr;
+        self->audio_ctx->pcm_sink_float = strcmp(format, "float32") == 0;
+        g_autoptr(FlValue) result = fl_value_new_int(++self->audio_ctx->pcm_sink_handle);
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+      }
+    }
+  }
+  else if (strcmp(method, "feedPcmSink") == 0) {
+    // Called for every packet, so it stays on the platform thread: the
+    // samples go straight from the message into the jitter buffer
+    PcmSink* sink = lookup_pcm_sink(self->audio_ctx, args);
+    FlValue* samples_value = fl_value_lookup_string(args, "samples");
+    const FlValueType expected =
+        self->audio_ctx->pcm_sink_float ? FL_VALUE_TYPE_FLOAT32_LIST : FL_VALUE_TYPE_UINT8_LIST;
+
+    if (!sink) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_HANDLE", "The PCM sink is closed or was replaced", nullptr));
+    } else if (!samples_value || fl_value_get_type(samples_value) != expected) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "samples do not match the sink format", nullptr));
+    } else {
+      const size_t length = fl_value_get_length(samples_value);
+      size_t fed;
+      if (self->audio_ctx->pcm_sink_float) {
+        fed = sink->feed_float(fl_value_get_float32_list(samples_value), length / sink->channels());
+      } else {
+        // Int16List sent as its bytes, in host order
+        fed = sink->feed(reinterpret_cast<const int16_t*>(fl_value_get_uint8_list(samples_value)),
+                         length / sizeof(int16_t) / sink->channels());
+      }
+      g_autoptr(FlValue) result = fl_value_new_int((int64_t)fed);
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  }
+  else if (strcmp(method, "closePcmSink") == 0) {
+    PcmSink* sink = lookup_pcm_sink(self->audio_ctx, args);
+    if (sink) {
+      sink->close();
+    }
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  }
+  else if (strcmp(method, "getPcmSinkStats") == 0) {
+    PcmSink* sink = lookup_pcm_sink(self->audio_ctx, args);
+    if (!sink) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_HANDLE", "The PCM sink is closed or was replaced", nullptr));
+    } else {
+      PcmSink::Stats stats = sink->stats();
+      g_autoptr(FlValue) result = fl_value_new_map();
+      fl_value_set_string_take(result, "fedFrames", fl_value_new_int((int64_t)stats.fed_frames));
+      fl_value_set_string_take(result, "playedFrames", fl_value_new_int((int64_t)stats.played_frames));
+      fl_value_set_string_take(result, "underruns", fl_value_new_int((int64_t)stats.underruns));
+      fl_value_set_string_take(result, "trimmedFrames", fl_value_new_int((int64_t)stats.trimmed_frames));
+      fl_value_set_string_take(result, "rejectedFrames", fl_value_new_int((int64_t)stats.rejected_frames));
+      fl_value_set_string_take(result, "bufferedFrames", fl_value_new_int((int64_t)stats.buffered_frames));
+      fl_value_set_string_take(result, "targetFrames", fl_value_new_int((int64_t)stats.target_frames));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+    }
+  }
+  else if (strcmp(method, "startMixer") == 0) {
+    FlValue* rate_value = fl_value_lookup_string(args, "sampleRate");
+    const int sample_rate = rate_value && fl_value_get_type(rate_value) == FL_VALUE_TYPE_INT
+                                ? (int)fl_value_get_int(rate_value)
+                                : kDefaultMixerSampleRate;
+    const int latency_ms = parse_latency_ms(args);
+
+    if (sample_rate < 8000 || sample_rate > 192000) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "sampleRate is out of range", nullptr));
+    } else if (!ensure_mixer(self->audio_ctx, sample_rate,
+                             latency_ms > 0 ? latency_ms : kDefaultMixerLatencyMs)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to start the mixer", nullptr));
+    } else {
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  }
+  else if (strcmp(method, "stopMixer") == 0) {
+    stop_mixer(self->audio_ctx);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  }
+  else if (strcmp(method, "playSound") == 0) {
+    FlValue* path_value = fl_value_lookup_string(args, "path");
+    if (!path_value || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Path is required", nullptr));
+    } else if (is_url(fl_value_get_string(path_value))) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Sounds must be local files", nullptr));
+    } else {
+      Mixer::VoiceParams params;
+      parse_voice_params(args, &params);
+
+      // Decode on a worker, through the PCM cache so a repeated sound costs
+      // a lookup, then start the voice on the platform thread
+      auto pcm = std::make_shared<std::shared_ptr<const DecodedPcm>>();
+      FlutterF2fSoundPlugin* plugin = FLUTTER_F2F_SOUND_PLUGIN(g_object_ref(self));
+      FlMethodCall* call = fl_method_call_ref(method_call);
+      std::shared_ptr<PcmCache> pcm_cache = self->audio_ctx->pcm_cache;
+      std::string path = fl_value_get_string(path_value);
+
+      self->audio_ctx->workers.post(
+          [pcm, pcm_cache, path](const WorkerJob&) { *pcm = pcm_cache->get(path); },
+          [pcm, params, plugin, call](const WorkerJob&) {
+            AudioContext* audio_ctx = plugin->audio_ctx;
+            g_autoptr(FlMethodResponse) response = nullptr;
+            if (!*pcm) {
+              response = FL_METHOD_RESPONSE(fl_method_error_response_new("LOAD_ERROR", "Failed to load sound", nullptr));
+            } else if (!audio_ctx || !ensure_default_mixer(audio_ctx)) {
+              response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to start the mixer", nullptr));
+            } else {
+              const uint32_t voice = audio_ctx->mixer->play(*pcm, params);
+              if (voice == 0) {
+                response = FL_METHOD_RESPONSE(fl_method_error_response_new("MIXER_BUSY", "Too many mixer commands pending", nullptr));
+              } else {
+                g_autoptr(FlValue) result = fl_value_new_int(voice);
+                response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+              }
+            }
+            fl_method_call_respond(call, response, nullptr);
+            fl_method_call_unref(call);
+            g_object_unref(plugin);
+          });
+      return;
+    }
+  }
+  else if (strcmp(method, "setVoice") == 0) {
+    // Only the arguments given change
+    Mixer::VoiceParams params;
+    const uint32_t voice = parse_id(args, "voice");
+    const bool playing = self->audio_ctx->mixer && self->audio_ctx->mixer->params(voice, &params);
+    parse_voice_params(args, &params);
+    g_autoptr(FlValue) result =
+        fl_value_new_bool(playing && self->audio_ctx->mixer->set_params(voice, params));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "stopVoice") == 0) {
+    const uint32_t voice = parse_id(args, "voice");
+    g_autoptr(FlValue) result =
+        fl_value_new_bool(self->audio_ctx->mixer && self->audio_ctx->mixer->stop(voice));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "stopAllVoices") == 0) {
+    if (self->audio_ctx->mixer) {
+      self->audio_ctx->mixer->stop_all();
+    }
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+  }
+  else if (strcmp(method, "isVoicePlaying") == 0) {
+    Mixer::VoiceParams params;
+    g_autoptr(FlValue) result = fl_value_new_bool(
+        self->audio_ctx->mixer && self->audio_ctx->mixer->params(parse_id(args, "voice"), &params));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "getMixerStats") == 0) {
+    Mixer::Stats stats;
+    if (self->audio_ctx->mixer) {
+      stats = self->audio_ctx->mixer->stats();
+    }
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "activeVoices", fl_value_new_int((int64_t)stats.active_voices));
+    fl_value_set_string_take(result, "peakVoices", fl_value_new_int((int64_t)stats.peak_voices));
+    fl_value_set_string_take(result, "maxVoices", fl_value_new_int((int64_t)Mixer::kMaxVoices));
+    fl_value_set_string_take(result, "stolenVoices", fl_value_new_int((int64_t)stats.stolen_voices));
+    fl_value_set_string_take(result, "droppedCommands", fl_value_new_int((int64_t)stats.dropped_commands));
+    fl_value_set_string_take(result, "lostFinishes", fl_value_new_int((int64_t)stats.lost_finishes));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "loadSample") == 0) {
+    FlValue* path_value = fl_value_lookup_string(args, "path");
+    if (!path_value || fl_value_get_type(path_value) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Path is required", nullptr));
+    } else if (is_url(fl_value_get_string(path_value))) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Samples must be local files", nullptr));
+    } else if (!ensure_default_mixer(self->audio_ctx)) {
+      // Started now so that the first trigger finds the stream running
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to start the mixer", nullptr));
+    } else {
+      // Decode and convert to the mixer's rate on a worker
+      auto id = std::make_shared<uint32_t>(0);
+      FlutterF2fSoundPlugin* plugin = FLUTTER_F2F_SOUND_PLUGIN(g_object_ref(self));
+      FlMethodCall* call = fl_method_call_ref(method_call);
+      std::shared_ptr<SampleBank> bank = self->audio_ctx->sample_bank;
+      std::string path = fl_value_get_string(path_value);
+      const int sample_rate = self->audio_ctx->mixer->sample_rate();
+
+      self->audio_ctx->workers.post(
+          [id, bank, path, sample_rate](const WorkerJob&) { *id = bank->load(path, sample_rate); },
+          [id, plugin, call](const WorkerJob&) {
+            if (*id == 0) {
+              fl_method_call_respond_error(call, "LOAD_ERROR", "Failed to load sample", nullptr, nullptr);
+            } else {
+              g_autoptr(FlValue) result = fl_value_new_int(*id);
+              fl_method_call_respond_success(call, result, nullptr);
+            }
+            fl_method_call_unref(call);
+            g_object_unref(plugin);
+          });
+      return;
+    }
+  }
+  else if (strcmp(method, "triggerSample") == 0) {
+    // The sound is ready in the bank, so this is a lookup and one command
+    // for the next audio callback
+    std::shared_ptr<const DecodedPcm> pcm = self->audio_ctx->sample_bank->get(parse_id(args, "id"));
+    Mixer::VoiceParams params;
+    parse_voice_params(args, &params);
+
+    if (!pcm) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("NOT_LOADED", "The sample is not loaded", nullptr));
+    } else if (!ensure_default_mixer(self->audio_ctx)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to start the mixer", nullptr));
+    } else {
+      const uint32_t voice = self->audio_ctx->mixer->play(std::move(pcm), params);
+      if (voice == 0) {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new("MIXER_BUSY", "Too many mixer commands pending", nullptr));
+      } else {
+        g_autoptr(FlValue) result = fl_value_new_int(voice);
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
       }
     }
   }
+  else if (strcmp(method, "unloadSample") == 0) {
+    g_autoptr(FlValue) result =
+        fl_value_new_bool(self->audio_ctx->sample_bank->unload(parse_id(args, "id")));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "setSampleBankBudget") == 0) {
+    FlValue* bytes_value = fl_value_lookup_string(args, "bytes");
+    if (!bytes_value || fl_value_get_type(bytes_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(bytes_value) < 0) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "bytes must be a non-negative integer", nullptr));
+    } else {
+      self->audio_ctx->sample_bank->set_budget((size_t)fl_value_get_int(bytes_value));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  }
+  else if (strcmp(method, "getSampleBankStats") == 0) {
+    SampleBank::Stats stats = self->audio_ctx->sample_bank->stats();
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "loads", fl_value_new_int((int64_t)stats.loads));
+    fl_value_set_string_take(result, "evictions", fl_value_new_int((int64_t)stats.evictions));
+    fl_value_set_string_take(result, "entries", fl_value_new_int((int64_t)stats.entries));
+    fl_value_set_string_take(result, "bytes", fl_value_new_int((int64_t)stats.bytes));
+    fl_value_set_string_take(result, "budgetBytes", fl_value_new_int((int64_t)stats.budget_bytes));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
   else if (strcmp(method, "pause") == 0) {
-    if (self->audio_ctx->playback_stream) {
-      pa_stream_cork(self->audio_ctx->playback_stream, 1, nullptr, nullptr);
+    BackendLock lock(self->audio_ctx);
+    if (self->audio_ctx->backend) {
+      self->audio_ctx->backend->set_playback_paused(true);
     }
     self->audio_ctx->is_playing = false;
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
   }
   else if (strcmp(method, "stop") == 0) {
-    if (self->audio_ctx->playback_stream) {
-      pa_stream_cork(self->audio_ctx->playback_stream, 1, nullptr, nullptr);
+    supersede_pending_playback(self->audio_ctx);
+
+    BackendLock lock(self->audio_ctx);
+    if (self->audio_ctx->backend) {
+      self->audio_ctx->backend->set_playback_paused(true);
     }
     self->audio_ctx->is_playing = false;
     self->audio_ctx->current_position = 0.0;
-    self->audio_ctx->playback_index = 0;
+    if (self->audio_ctx->source) {
+      self->audio_ctx->source->seek(0);
+    }
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
   }
   else if (strcmp(method, "resume") == 0) {
-    if (self->audio_ctx->playback_stream) {
-      pa_stream_cork(self->audio_ctx->playback_stream, 0, nullptr, nullptr);
+    BackendLock lock(self->audio_ctx);
+    if (self->audio_ctx->backend) {
+      self->audio_ctx->backend->set_playback_paused(false);
     }
     self->audio_ctx->is_playing = true;
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
   }
+  else if (strcmp(method, "seek") == 0) {
+    FlValue* position_value = fl_value_lookup_string(args, "position");
+    if (!position_value || fl_value_get_type(position_value) != FL_VALUE_TYPE_FLOAT) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "Position is required", nullptr));
+    } else {
+      // A decoder restarts there; a network source fetches the missing
+      // bytes with a range request
+      const double position = std::max(0.0, fl_value_get_float(position_value));
+      BackendLock lock(self->audio_ctx);
+      AudioSource* source = self->audio_ctx->source.get();
+      if (source) {
+        source->seek((uint64_t)(position * source->sample_rate()));
+        self->audio_ctx->current_position = source->position_frames() / (double)source->sample_rate();
+      }
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  }
   else if (strcmp(method, "setVolume") == 0) {
-    FlValue* volume_value = fl_value_get_map_value(args, fl_value_new_string("volume"));
+    FlValue* volume_value = fl_value_lookup_string(args, "volume");
     if (volume_value) {
       double volume = fl_value_get_float(volume_value);
+      // Applied by render_playback from the next period on
       self->audio_ctx->volume = volume;
 
-      // Set PulseAudio stream volume
-      if (self->audio_ctx->playback_stream) {
-        pa_cvolume cvolume;
-        pa_cvolume_init(&cvolume);
-        cvolume.channels = self->audio_ctx->channels;
-        for (int i = 0; i < cvolume.channels; i++) {
-          cvolume.values[i] = pa_sw_volume_from_linear(volume);
-        }
-
-        pa_context_set_sink_input_volume(
-            self->audio_ctx->context,
-            pa_stream_get_index(self->audio_ctx->playback_stream),
-            &cvolume,
-            nullptr,
-            nullptr);
-      }
-
       g_print("Volume set to: %.2f\n", volume);
     }
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
@@ -665,23 +1741,27 @@ static void flutter_f2f_sound_plugin_handle_method_call(
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_float(pos)));
   }
   else if (strcmp(method, "getDuration") == 0) {
-    FlValue* path_value = fl_value_get_map_value(args, fl_value_new_string("path"));
+    FlValue* path_value = fl_value_lookup_string(args, "path");
     if (path_value && fl_value_get_type(path_value) == FL_VALUE_TYPE_STRING) {
       const gchar* path = fl_value_get_string(path_value);
       if (is_url(path)) {
         response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_float(0.0)));
       } else {
-        // Use libsndfile to get duration
-        SF_INFO sfinfo;
-        memset(&sfinfo, 0, sizeof(sfinfo));
-        SNDFILE* sndfile = sf_open(path, SFM_READ, &sfinfo);
-        if (sndfile) {
-          double duration = (double)sfinfo.frames / sfinfo.samplerate;
-          sf_close(sndfile);
-          response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_float(duration)));
-        } else {
-          response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_float(0.0)));
-        }
+        // Read the header with libsndfile on a worker
+        auto duration = std::make_shared<double>(0.0);
+        FlutterF2fSoundPlugin* plugin = FLUTTER_F2F_SOUND_PLUGIN(g_object_ref(self));
+        FlMethodCall* call = fl_method_call_ref(method_call);
+        std::string file_path = path;
+
+        self->audio_ctx->workers.post(
+            [duration, file_path](const WorkerJob&) { *duration = probe_duration(file_path); },
+            [duration, plugin, call](const WorkerJob&) {
+              g_autoptr(FlValue) result = fl_value_new_float(*duration);
+              fl_method_call_respond_success(call, result, nullptr);
+              fl_method_call_unref(call);
+              g_object_unref(plugin);
+            });
+        return;
       }
     } else {
       response = FL_METHOD_RESPONSE(fl_method_success_response_new(fl_value_new_float(0.0)));
@@ -689,56 +1769,142 @@ static void flutter_f2f_sound_plugin_handle_method_call(
   }
   else if (strcmp(method, "startRecording") == 0) {
     g_print("Starting recording\n");
-    self->audio_ctx->is_recording = true;
-    response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+
+    AudioStreamConfig config = parse_capture_config(args, 44100, 2);
+    if (!audio_stream_config_valid(config)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENTS", "Unsupported sampleRate or channels", nullptr));
+    } else if (!ensure_audio_backend(self->audio_ctx)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to initialize audio", nullptr));
+    } else if (const gchar* error = configure_capture_delivery(
+                   &self->audio_ctx->recording_delivery, self->audio_ctx->recording_event_channel,
+                   args, FLUTTER_F2F_SOUND_RING_RECORDING, config.sample_rate, config.channels)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", error, nullptr));
+    } else {
+      BackendLock lock(self->audio_ctx);
+      capture_ring_begin_session(&self->audio_ctx->recording_delivery);
+      if (self->audio_ctx->backend->start_capture(CaptureSource::kMicrophone, config,
+                                                  capture_recording, self->audio_ctx)) {
+        self->audio_ctx->is_recording = true;
+        response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+      } else {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new("RECORD_INIT_ERROR", "Failed to start recording stream", nullptr));
+      }
+    }
   }
   else if (strcmp(method, "stopRecording") == 0) {
     g_print("Stopping recording\n");
     self->audio_ctx->is_recording = false;
+    event_queue_close(&self->audio_ctx->recording_delivery.events);
+
+    BackendLock lock(self->audio_ctx);
+    if (self->audio_ctx->backend) {
+      self->audio_ctx->backend->stop_capture(CaptureSource::kMicrophone);
+    }
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
   }
   else if (strcmp(method, "startSystemSoundCapture") == 0) {
     g_print("Starting system sound capture\n");
 
-    // Create monitor stream to capture system audio
-    pa_sample_spec ss;
-    ss.format = PA_SAMPLE_S16LE;
-    ss.rate = 44100;
-    ss.channels = 2;
-
-    self->audio_ctx->monitor_stream = pa_stream_new(
-        self->audio_ctx->context,
-        "FlutterF2FSound Monitor",
-        &ss,
-        nullptr);
-
-    if (self->audio_ctx->monitor_stream) {
-      pa_stream_set_read_callback(self->audio_ctx->monitor_stream, monitor_read_cb, self->audio_ctx);
-
-      // Connect to monitor of default sink
-      pa_context_get_sink_info_by_name(
-          self->audio_ctx->context,
-          nullptr,  // Default sink
-          [](pa_context* c, const pa_sink_info* i, int eol, void* userdata) {
-            if (i) {
-              AudioContext* ctx = static_cast<AudioContext*>(userdata);
-              pa_stream_connect_record(
-                  ctx->monitor_stream,
-                  i->monitor_source_name,
-                  nullptr,
-                  PA_STREAM_START_CORKED);
-
-              pa_stream_cork(ctx->monitor_stream, 0, nullptr, nullptr);
-            }
-          },
-          self->audio_ctx);
-
-      pa_mainloop_iterate(self->audio_ctx->mainloop, 1, nullptr);
+    if (!ensure_audio_backend(self->audio_ctx)) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("AUDIO_INIT_ERROR", "Failed to initialize audio", nullptr));
+    } else {
+      // Capture what the default output device plays
+      AudioStreamConfig config;
+      config.sample_rate = 44100;
+      config.channels = 2;
+      config.fragment_ms = parse_fragment_ms(args);
+
+      if (const gchar* error = configure_capture_delivery(
+              &self->audio_ctx->system_sound_delivery,
+              self->audio_ctx->system_sound_event_channel, args,
+              FLUTTER_F2F_SOUND_RING_SYSTEM_SOUND, config.sample_rate, config.channels)) {
+        response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", error, nullptr));
+      } else {
+        BackendLock lock(self->audio_ctx);
+        capture_ring_begin_session(&self->audio_ctx->system_sound_delivery);
+        if (self->audio_ctx->backend->start_capture(CaptureSource::kSystemSound, config,
+                                                    capture_system_sound, self->audio_ctx)) {
+          self->audio_ctx->is_capturing_system = true;
+          response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+        } else {
+          response = FL_METHOD_RESPONSE(fl_method_error_response_new("SYSTEM_SOUND_CAPTURE_ERROR", "Failed to start system sound capture", nullptr));
+        }
+      }
+    }
+  }
+  else if (strcmp(method, "stopSystemSoundCapture") == 0) {
+    g_print("Stopping system sound capture\n");
+    self->audio_ctx->is_capturing_system = false;
+    event_queue_close(&self->audio_ctx->system_sound_delivery.events);
+
+    BackendLock lock(self->audio_ctx);
+    if (self->audio_ctx->backend) {
+      self->audio_ctx->backend->stop_capture(CaptureSource::kSystemSound);
     }
-
-    self->audio_ctx->is_capturing_system = true;
     response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
   }
+  else if (strcmp(method, "getPlaybackLatency") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_float(
+        self->audio_ctx->backend ? self->audio_ctx->backend->playback_latency_ms() : 0.0);
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "setPcmCacheBudget") == 0) {
+    FlValue* bytes_value = fl_value_lookup_string(args, "bytes");
+    if (!bytes_value || fl_value_get_type(bytes_value) != FL_VALUE_TYPE_INT ||
+        fl_value_get_int(bytes_value) < 0) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "bytes must be a non-negative integer", nullptr));
+    } else {
+      self->audio_ctx->pcm_cache->set_budget((size_t)fl_value_get_int(bytes_value));
+      response = FL_METHOD_RESPONSE(fl_method_success_response_new(nullptr));
+    }
+  }
+  else if (strcmp(method, "getPcmCacheStats") == 0) {
+    PcmCache::Stats stats = self->audio_ctx->pcm_cache->stats();
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(result, "hits", fl_value_new_int((int64_t)stats.hits));
+    fl_value_set_string_take(result, "misses", fl_value_new_int((int64_t)stats.misses));
+    fl_value_set_string_take(result, "evictions", fl_value_new_int((int64_t)stats.evictions));
+    fl_value_set_string_take(result, "entries", fl_value_new_int((int64_t)stats.entries));
+    fl_value_set_string_take(result, "bytes", fl_value_new_int((int64_t)stats.bytes));
+    fl_value_set_string_take(result, "budgetBytes", fl_value_new_int((int64_t)stats.budget_bytes));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
+  else if (strcmp(method, "preconnect") == 0) {
+    FlValue* url_value = fl_value_lookup_string(args, "url");
+    if (!url_value || fl_value_get_type(url_value) != FL_VALUE_TYPE_STRING) {
+      response = FL_METHOD_RESPONSE(fl_method_error_response_new("INVALID_ARGUMENT", "url must be a string", nullptr));
+    } else {
+      // Connect on a worker and answer whether it worked
+      auto connected = std::make_shared<bool>(false);
+      FlutterF2fSoundPlugin* plugin = FLUTTER_F2F_SOUND_PLUGIN(g_object_ref(self));
+      FlMethodCall* call = fl_method_call_ref(method_call);
+      std::shared_ptr<HttpConnectionPool> pool = self->audio_ctx->http_pool;
+      std::string url = fl_value_get_string(url_value);
+
+      self->audio_ctx->workers.post(
+          [connected, pool, url](const WorkerJob&) { *connected = pool->preconnect(url); },
+          [connected, plugin, call](const WorkerJob&) {
+            g_autoptr(FlValue) result = fl_value_new_bool(*connected);
+            fl_method_call_respond_success(call, result, nullptr);
+            fl_method_call_unref(call);
+            g_object_unref(plugin);
+          });
+      return;
+    }
+  }
+  else if (strcmp(method, "getDroppedFrames") == 0) {
+    g_autoptr(FlValue) result = fl_value_new_map();
+    fl_value_set_string_take(
+        result, "recording",
+        fl_value_new_int(self->audio_ctx->recording_delivery.events.dropped_frames.load()));
+    fl_value_set_string_take(
+        result, "systemSound",
+        fl_value_new_int(self->audio_ctx->system_sound_delivery.events.dropped_frames.load()));
+    fl_value_set_string_take(
+        result, "playback",
+        fl_value_new_int(self->audio_ctx->playback_tap.dropped_frames.load()));
+    response = FL_METHOD_RESPONSE(fl_method_success_response_new(result));
+  }
   else {
     response = FL_METHOD_RESPONSE(fl_method_not_implemented_response_new());
   }
@@ -752,7 +1918,20 @@ static void flutter_f2f_sound_plugin_dispose(GObject* object) {
   FlutterF2fSoundPlugin* self = FLUTTER_F2F_SOUND_PLUGIN(object);
 
   if (self->audio_ctx) {
-    cleanup_pulse_audio(self->audio_ctx);
+    // Release any producer blocked on a full queue before tearing down streams
+    event_queue_close(&self->audio_ctx->recording_delivery.events);
+    event_queue_close(&self->audio_ctx->system_sound_delivery.events);
+    playback_tap_stop(&self->audio_ctx->playback_tap);
+    if (self->playback_event_channel) {
+      fl_event_channel_set_stream_handlers(self->playback_event_channel, nullptr, nullptr, nullptr,
+                                           nullptr);
+    }
+    playback_state_stop(&self->audio_ctx->playback_state);
+    if (self->playback_state_event_channel) {
+      fl_event_channel_set_stream_handlers(self->playback_state_event_channel, nullptr, nullptr,
+                                           nullptr, nullptr);
+    }
+    cleanup_audio_backend(self->audio_ctx);
     delete self->audio_ctx;
     self->audio_ctx = nullptr;
   }
@@ -761,6 +1940,7 @@ static void flutter_f2f_sound_plugin_dispose(GObject* object) {
   g_clear_object(&self->recording_event_channel);
   g_clear_object(&self->system_sound_event_channel);
   g_clear_object(&self->playback_event_channel);
+  g_clear_object(&self->playback_state_event_channel);
 
   G_OBJECT_CLASS(flutter_f2f_sound_plugin_parent_class)->dispose(object);
 }
@@ -770,10 +1950,10 @@ static void flutter_f2f_sound_plugin_class_init(FlutterF2fSoundPluginClass* klas
 }
 
 static void flutter_f2f_sound_plugin_init(FlutterF2fSoundPlugin* self) {
-  self->audio_ctx = new AudioContext();
-
-  // Initialize libcurl globally
+  // Initialize libcurl globally, before the context creates its share handle
   curl_global_init(CURL_GLOBAL_DEFAULT);
+
+  self->audio_ctx = new AudioContext();
 }
 
 static void method_call_cb(FlMethodChannel* channel, FlMethodCall* method_call,
@@ -825,6 +2005,24 @@ void flutter_f2f_sound_plugin_register_with_registrar(FlPluginRegistrar* registr
   plugin->playback_event_channel = FL_EVENT_CHANNEL(g_steal_pointer(&playback_event_channel));
   if (plugin->audio_ctx) {
     plugin->audio_ctx->playback_event_channel = plugin->playback_event_channel;
+    plugin->audio_ctx->playback_tap.channel = plugin->playback_event_channel;
+    fl_event_channel_set_stream_handlers(plugin->playback_event_channel, playback_tap_listen_cb,
+                                         playback_tap_cancel_cb, &plugin->audio_ctx->playback_tap,
+                                         nullptr);
+  }
+
+  // Create playback state event channel
+  g_autoptr(FlEventChannel) playback_state_event_channel =
+      fl_event_channel_new(fl_plugin_registrar_get_messenger(registrar),
+                          "com.tecmore.flutter_f2f_sound/playback_state",
+                          FL_METHOD_CODEC(event_codec));
+  plugin->playback_state_event_channel = FL_EVENT_CHANNEL(g_steal_pointer(&playback_state_event_channel));
+  if (plugin->audio_ctx) {
+    plugin->audio_ctx->playback_state_event_channel = plugin->playback_state_event_channel;
+    plugin->audio_ctx->playback_state.channel = plugin->playback_state_event_channel;
+    fl_event_channel_set_stream_handlers(plugin->playback_state_event_channel,
+                                         playback_state_listen_cb, playback_state_cancel_cb,
+                                         plugin->audio_ctx, nullptr);
   }
 
   g_object_unref(plugin);
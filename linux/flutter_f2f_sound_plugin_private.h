@@ -2,9 +2,50 @@
 
 #include "include/flutter_f2f_sound/flutter_f2f_sound_plugin.h"
 
+#include <vector>
+
 // This file exposes some plugin internals for unit testing. See
 // https://github.com/flutter/flutter/issues/88724 for current limitations
 // in the unit-testable API.
 
 // Handles the getPlatformVersion method call.
 FlMethodResponse *get_platform_version();
+
+// Wraps a block of PCM bytes in the value sent on the audio event channels.
+FlValue *audio_data_value_new(const uint8_t *data, size_t length);
+
+// Converts interleaved s16 samples to float32 in [-1.0, 1.0).
+void pcm16_to_float32(const int16_t *in, float *out, size_t count);
+
+// Copies interleaved s16 samples to |out| scaled by |gain|, saturating at
+// the s16 range. A gain of 1.0 is a plain copy.
+void render_pcm16(const int16_t *in, int16_t *out, size_t count, float gain);
+
+// Scales interleaved s16 samples by |gain| in place, saturating like
+// render_pcm16.
+void scale_pcm16(int16_t *samples, size_t count, float gain);
+
+// Fills |info| for headerless PCM named by a MIME type: audio/L16 or
+// audio/L24 (big-endian, RFC 2586) or audio/pcm (little-endian 16-bit), with
+// a "rate" and an optional "channels" parameter. Returns false for any other
+// type, whose header libsndfile reads instead.
+bool raw_format_from_mime(const char *mime, SF_INFO *info);
+
+// Gathers captured bytes into packets of exactly |packet_bytes| bytes before
+// they are sent to Dart. A packet size of zero forwards fragments unchanged.
+struct PacketCoalescer {
+  size_t packet_bytes = 0;
+  std::vector<uint8_t> pending;
+};
+
+typedef void (*PacketCallback)(const uint8_t *data, size_t length, gpointer user_data);
+
+// Returns the byte size of a |duration_ms| packet, rounded down to whole frames.
+size_t packet_bytes_for_duration(int duration_ms, int sample_rate, size_t frame_bytes);
+
+// Sets the packet size and discards any partially gathered packet.
+void packet_coalescer_reset(PacketCoalescer *coalescer, size_t packet_bytes);
+
+// Appends captured bytes, invoking |callback| once per completed packet.
+void packet_coalescer_push(PacketCoalescer *coalescer, const uint8_t *data, size_t length,
+                           PacketCallback callback, gpointer user_data);
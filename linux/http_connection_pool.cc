@@ -0,0 +1,62 @@
+#include "http_connection_pool.h"
+
+#include <glib.h>
+
+HttpConnectionPool::HttpConnectionPool() : share_(curl_share_init()) {
+  if (!share_) {
+    g_printerr("Failed to create the libcurl share handle\n");
+    return;
+  }
+  curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, lock);
+  curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, unlock);
+  curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+  curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+  if (share_) {
+    curl_share_cleanup(share_);
+  }
+}
+
+void HttpConnectionPool::configure(CURL* curl) {
+  if (share_) {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share_);
+  }
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+  // Keeps idle pooled connections from being dropped by NATs and proxies
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+}
+
+bool HttpConnectionPool::preconnect(const std::string& url) {
+  CURL* curl = curl_easy_init();
+  if (!curl) {
+    return false;
+  }
+  const std::string target = url.find("://") == std::string::npos ? "https://" + url + "/" : url;
+  configure(curl);
+  curl_easy_setopt(curl, CURLOPT_URL, target.c_str());
+  curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "FlutterF2FSound/1.0");
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
+
+  // Any response will do: the point is the resolved host and TLS session
+  const CURLcode res = curl_easy_perform(curl);
+  curl_easy_cleanup(curl);
+  if (res != CURLE_OK) {
+    g_printerr("Failed to preconnect to %s: %s\n", target.c_str(), curl_easy_strerror(res));
+    return false;
+  }
+  g_print("Preconnected to %s\n", target.c_str());
+  return true;
+}
+
+void HttpConnectionPool::lock(CURL*, curl_lock_data data, curl_lock_access, void* user_data) {
+  static_cast<HttpConnectionPool*>(user_data)->mutexes_[data].lock();
+}
+
+void HttpConnectionPool::unlock(CURL*, curl_lock_data data, void* user_data) {
+  static_cast<HttpConnectionPool*>(user_data)->mutexes_[data].unlock();
+}
@@ -0,0 +1,44 @@
+#ifndef FLUTTER_PLUGIN_HTTP_CONNECTION_POOL_H_
+#define FLUTTER_PLUGIN_HTTP_CONNECTION_POOL_H_
+
+#include <curl/curl.h>
+
+#include <mutex>
+#include <string>
+
+// DNS answers and TLS sessions shared by every transfer through a curl share
+// handle. A request to a host fetched from within the last couple of
+// minutes skips the DNS lookup and resumes the TLS session, saving a round
+// trip of the handshake.
+//
+// Connections themselves are not shared: transfers run their own easy
+// handles on their own threads, and libcurl does not support one connection
+// cache used by concurrent threads. An easy handle reused for several
+// requests, as HttpStream does for its range restarts, keeps its own
+// connection open between them. Transfers negotiate HTTP/2 over TLS. Safe
+// to use from several threads.
+class HttpConnectionPool {
+ public:
+  HttpConnectionPool();
+  ~HttpConnectionPool();
+
+  HttpConnectionPool(const HttpConnectionPool&) = delete;
+  HttpConnectionPool& operator=(const HttpConnectionPool&) = delete;
+
+  // Makes |curl| use the pool. The pool must outlive the handle.
+  void configure(CURL* curl);
+
+  // Resolves and connects to the origin of |url| (or a bare host, taken as
+  // https) with a HEAD request, leaving the DNS answer and TLS session in
+  // the pool for the next fetch. Blocks, so call it from a worker.
+  bool preconnect(const std::string& url);
+
+ private:
+  static void lock(CURL* curl, curl_lock_data data, curl_lock_access access, void* user_data);
+  static void unlock(CURL* curl, curl_lock_data data, void* user_data);
+
+  CURLSH* share_;
+  std::mutex mutexes_[CURL_LOCK_DATA_LAST];
+};
+
+#endif  // FLUTTER_PLUGIN_HTTP_CONNECTION_POOL_H_
@@ -0,0 +1,547 @@
+#include "http_stream.h"
+
+#include <glib.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <iterator>
+#include <strings.h>
+
+namespace {
+
+// Storage granularity. Blocks are only allocated for bytes that arrive, so a
+// seek far into a large file does not allocate everything before it.
+constexpr int64_t kBlockBytes = 256 * 1024;
+
+// A read this far ahead of the running transfer waits for it rather than
+// paying for a new request.
+constexpr int64_t kReadAheadBytes = 512 * 1024;
+
+// Files at least this large are fetched over kDownloadSegments connections
+// when the server accepts ranges. Smaller ones finish before the extra
+// handshakes would pay off.
+constexpr int64_t kSegmentedDownloadBytes = 8 * 1024 * 1024;
+constexpr int64_t kDownloadSegments = 4;
+
+}  // namespace
+
+void HttpValidators::parse_header(const char* line, size_t length) {
+  std::string header(line, length);
+  const size_t colon = header.find(':');
+  if (colon == std::string::npos) {
+    return;
+  }
+  std::string name = header.substr(0, colon);
+  std::transform(name.begin(), name.end(), name.begin(),
+                 [](unsigned char c) { return (char)tolower(c); });
+  const size_t begin = header.find_first_not_of(" \t", colon + 1);
+  const size_t end = header.find_last_not_of(" \t\r\n");
+  const std::string value =
+      (begin == std::string::npos || end < begin) ? "" : header.substr(begin, end - begin + 1);
+  if (name == "etag") {
+    etag = value;
+  } else if (name == "last-modified") {
+    last_modified = value;
+  }
+}
+
+std::shared_ptr<HttpStream> HttpStream::start(const std::string& url,
+                                              std::shared_ptr<HttpConnectionPool> pool,
+                                              CompletionCallback on_complete) {
+  std::shared_ptr<HttpStream> stream(
+      new HttpStream(url, std::move(pool), std::move(on_complete)));
+  stream->thread_ = std::thread(&HttpStream::run, stream.get());
+  return stream;
+}
+
+HttpStream::HttpStream(const std::string& url, std::shared_ptr<HttpConnectionPool> pool,
+                       CompletionCallback on_complete)
+    : url_(url), pool_(std::move(pool)), on_complete_(std::move(on_complete)) {}
+
+HttpStream::~HttpStream() {
+  interrupt();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  // Only the download thread starts segments, so the list is final now
+  for (std::thread& thread : segment_threads_) {
+    thread.join();
+  }
+}
+
+int64_t HttpStream::length() {
+  // Only the response headers are waited for, never the whole body
+  std::unique_lock<std::mutex> lock(mutex_);
+  data_available_.wait(lock, [this]() {
+    return content_length_ >= 0 || transfer_started_ || failed_ || interrupted_;
+  });
+  return content_length_;
+}
+
+int64_t HttpStream::read(void* out, int64_t offset, int64_t count) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (!interrupted_) {
+    int64_t wanted = count;
+    if (content_length_ >= 0) {
+      wanted = std::max<int64_t>(0, std::min(count, content_length_ - offset));
+    }
+    const int64_t available = fetched_end(offset) - offset;
+    // Reads end where a failed transfer stopped; one that needs bytes
+    // elsewhere starts a new transfer
+    const bool at_failure = failed_ && offset + available == cursor_;
+    if (available >= wanted || at_failure) {
+      // Copy out of the blocks the range spans
+      const int64_t length = std::min(wanted, available);
+      auto* dest = static_cast<uint8_t*>(out);
+      for (int64_t done = 0; done < length;) {
+        const int64_t position = offset + done;
+        const int64_t in_block = position % kBlockBytes;
+        const int64_t piece = std::min(length - done, kBlockBytes - in_block);
+        memcpy(dest + done, blocks_[(size_t)(position / kBlockBytes)].get() + in_block,
+               (size_t)piece);
+        done += piece;
+      }
+      return length;
+    }
+
+    // Restart the download at the first missing byte unless the running
+    // transfer or a segment is about to deliver it
+    const int64_t missing = offset + available;
+    Segment* segment = segment_at(missing);
+    if (segment) {
+      if (missing - segment->cursor <= kReadAheadBytes) {
+        data_available_.wait(lock);
+        continue;
+      }
+      // The segment stops here and the restarted transfer takes over
+      segment->end = missing;
+    }
+    if (!transfer_active_ ||
+        (ranges_supported_ && (missing < cursor_ || missing - cursor_ > kReadAheadBytes))) {
+      request_range(missing);
+    }
+    data_available_.wait(lock);
+  }
+  return 0;
+}
+
+void HttpStream::interrupt() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    interrupted_ = true;
+  }
+  data_available_.notify_all();
+  range_requested_.notify_all();
+}
+
+HttpValidators HttpStream::validators() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return validators_;
+}
+
+bool HttpStream::write_to(FILE* file) {
+  // A block at a time, so reads of the stream are not held up for the whole
+  // write
+  for (size_t block = 0;; block++) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const int64_t offset = (int64_t)block * kBlockBytes;
+    if (!fully_fetched() || offset >= content_length_) {
+      return fully_fetched();
+    }
+    const size_t length = (size_t)std::min(kBlockBytes, content_length_ - offset);
+    if (fwrite(blocks_[block].get(), 1, length, file) != length) {
+      return false;
+    }
+  }
+}
+
+bool HttpStream::fully_fetched() const {
+  return content_length_ >= 0 &&
+         (content_length_ == 0 ||
+          (fetched_.size() == 1 && fetched_.begin()->first == 0 &&
+           fetched_.begin()->second == content_length_));
+}
+
+int64_t HttpStream::fetched_end(int64_t offset) const {
+  auto it = fetched_.upper_bound(offset);
+  if (it == fetched_.begin()) {
+    return offset;
+  }
+  --it;
+  return std::max(it->second, offset);
+}
+
+void HttpStream::mark_fetched(int64_t start, int64_t end) {
+  // Merge with the ranges it touches
+  auto it = fetched_.upper_bound(start);
+  if (it != fetched_.begin()) {
+    auto previous = std::prev(it);
+    if (previous->second >= start) {
+      start = previous->first;
+      end = std::max(end, previous->second);
+      it = fetched_.erase(previous);
+    }
+  }
+  while (it != fetched_.end() && it->first <= end) {
+    end = std::max(end, it->second);
+    it = fetched_.erase(it);
+  }
+  fetched_[start] = end;
+}
+
+void HttpStream::store(const char* data, int64_t offset, int64_t length) {
+  for (int64_t done = 0; done < length;) {
+    const int64_t position = offset + done;
+    const size_t block = (size_t)(position / kBlockBytes);
+    const int64_t in_block = position % kBlockBytes;
+    const int64_t piece = std::min(length - done, kBlockBytes - in_block);
+    if (block >= blocks_.size()) {
+      blocks_.resize(block + 1);
+    }
+    if (!blocks_[block]) {
+      blocks_[block].reset(new uint8_t[kBlockBytes]);
+    }
+    memcpy(blocks_[block].get() + in_block, data + done, (size_t)piece);
+    done += piece;
+  }
+}
+
+void HttpStream::request_range(int64_t offset) {
+  if (restart_requested_ && restart_offset_ == offset) {
+    return;
+  }
+  g_print("Requesting %s from byte %lld\n", url_.c_str(), (long long)offset);
+  restart_offset_ = offset;
+  restart_requested_ = true;
+  range_requested_.notify_one();
+}
+
+void HttpStream::start_segments() {
+  // Whole blocks per segment from the running transfer to the end of the
+  // file; the running transfer keeps the first
+  const int64_t per_segment =
+      ((content_length_ - cursor_) / kDownloadSegments + kBlockBytes - 1) / kBlockBytes *
+      kBlockBytes;
+  for (int64_t start = cursor_ + per_segment; start < content_length_; start += per_segment) {
+    std::unique_ptr<Segment> segment(new Segment());
+    segment->stream = this;
+    segment->curl = nullptr;
+    segment->start = start;
+    segment->end = std::min(start + per_segment, content_length_);
+    segment->cursor = start;
+    segment->started = false;
+    segment->running = true;
+    segment->failed = false;
+    running_segments_++;
+    segment_threads_.emplace_back(&HttpStream::run_segment, this, segment.get());
+    segments_.push_back(std::move(segment));
+  }
+  g_print("Downloading %s in %zu segments\n", url_.c_str(), segments_.size() + 1);
+}
+
+HttpStream::Segment* HttpStream::segment_at(int64_t offset) {
+  for (const std::unique_ptr<Segment>& segment : segments_) {
+    if (segment->running && offset >= segment->cursor && offset < segment->end) {
+      return segment.get();
+    }
+  }
+  return nullptr;
+}
+
+int64_t HttpStream::transfer_limit() const {
+  // The main transfer stops where the next segment after its start begins
+  int64_t limit = -1;
+  if (!ranges_supported_) {
+    return limit;
+  }
+  for (const std::unique_ptr<Segment>& segment : segments_) {
+    if (!segment->failed && segment->start > transfer_offset_ &&
+        (limit < 0 || segment->start < limit)) {
+      limit = segment->start;
+    }
+  }
+  return limit;
+}
+
+size_t HttpStream::header_callback(char* data, size_t size, size_t nmemb, void* user_data) {
+  auto* stream = static_cast<HttpStream*>(user_data);
+  const size_t length = size * nmemb;
+  std::lock_guard<std::mutex> lock(stream->mutex_);
+  stream->validators_.parse_header(data, length);
+  static const char kAcceptRanges[] = "accept-ranges:";
+  if (length > sizeof(kAcceptRanges) - 1 &&
+      strncasecmp(data, kAcceptRanges, sizeof(kAcceptRanges) - 1) == 0) {
+    stream->accept_ranges_ = std::string(data, length).find("bytes") != std::string::npos;
+  }
+  return length;
+}
+
+size_t HttpStream::write_callback(char* data, size_t size, size_t nmemb, void* user_data) {
+  auto* stream = static_cast<HttpStream*>(user_data);
+  const size_t length = size * nmemb;
+
+  std::lock_guard<std::mutex> lock(stream->mutex_);
+  if (stream->restart_requested_ || stream->interrupted_) {
+    return 0;  // Aborts the transfer
+  }
+  if (!stream->transfer_started_) {
+    long http_code = 0;
+    curl_easy_getinfo(stream->curl_, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code == 200) {
+      // No range, or the server ignored it: the whole file from the start
+      if (stream->cursor_ > 0) {
+        stream->ranges_supported_ = false;
+      }
+      stream->cursor_ = 0;
+    } else if (http_code != 206) {
+      g_printerr("HTTP error: %ld\n", http_code);
+      return 0;
+    }
+    if (stream->content_length_ < 0) {
+      curl_off_t content_length = -1;
+      curl_easy_getinfo(stream->curl_, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+      if (content_length >= 0) {
+        stream->content_length_ = stream->cursor_ + content_length;
+        stream->blocks_.resize((size_t)((stream->content_length_ + kBlockBytes - 1) / kBlockBytes));
+      }
+    }
+    // Split the file between parallel transfers on the first response, while
+    // all of it is still missing. A 206 shows ranges work even when the
+    // server does not advertise them.
+    if (stream->segments_.empty() && stream->fetched_.empty() &&
+        (http_code == 206 || stream->accept_ranges_) &&
+        stream->content_length_ - stream->cursor_ >= kSegmentedDownloadBytes) {
+      stream->start_segments();
+    }
+    stream->transfer_started_ = true;
+  }
+
+  // Leave the bytes of the next segment to it
+  int64_t accepted = (int64_t)length;
+  const int64_t limit = stream->transfer_limit();
+  if (limit >= 0) {
+    accepted = std::max<int64_t>(0, std::min(accepted, limit - stream->cursor_));
+  }
+  if (accepted > 0) {
+    stream->store(data, stream->cursor_, accepted);
+    stream->mark_fetched(stream->cursor_, stream->cursor_ + accepted);
+    stream->cursor_ += accepted;
+    stream->data_available_.notify_all();
+  }
+  if (accepted < (int64_t)length) {
+    stream->transfer_reached_limit_ = true;
+    return 0;
+  }
+  return length;
+}
+
+int HttpStream::progress_callback(void* user_data, curl_off_t, curl_off_t, curl_off_t,
+                                  curl_off_t) {
+  auto* stream = static_cast<HttpStream*>(user_data);
+  return (stream->interrupted_ || stream->restart_requested_) ? 1 : 0;
+}
+
+size_t HttpStream::segment_write_callback(char* data, size_t size, size_t nmemb,
+                                          void* user_data) {
+  auto* segment = static_cast<Segment*>(user_data);
+  HttpStream* stream = segment->stream;
+  const size_t length = size * nmemb;
+
+  std::lock_guard<std::mutex> lock(stream->mutex_);
+  if (stream->interrupted_) {
+    return 0;
+  }
+  if (!segment->started) {
+    long http_code = 0;
+    curl_easy_getinfo(segment->curl, CURLINFO_RESPONSE_CODE, &http_code);
+    if (http_code != 206) {
+      // Ranges after all are not honoured; the first transfer reads on
+      if (http_code == 200 && stream->ranges_supported_) {
+        g_print("Server ignored the range, downloading %s as one stream\n", stream->url_.c_str());
+        stream->ranges_supported_ = false;
+      }
+      return 0;
+    }
+    segment->started = true;
+  }
+
+  const int64_t accepted =
+      std::max<int64_t>(0, std::min((int64_t)length, segment->end - segment->cursor));
+  if (accepted > 0) {
+    stream->store(data, segment->cursor, accepted);
+    stream->mark_fetched(segment->cursor, segment->cursor + accepted);
+    segment->cursor += accepted;
+    stream->data_available_.notify_all();
+  }
+  return accepted == (int64_t)length ? length : 0;
+}
+
+int HttpStream::segment_progress_callback(void* user_data, curl_off_t, curl_off_t, curl_off_t,
+                                          curl_off_t) {
+  auto* segment = static_cast<Segment*>(user_data);
+  return segment->stream->interrupted_ ? 1 : 0;
+}
+
+void HttpStream::run_segment(Segment* segment) {
+  std::string range;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    range = std::to_string(segment->start) + "-" + std::to_string(segment->end - 1);
+  }
+
+  CURLcode res = CURLE_FAILED_INIT;
+  // A handle of its own: the pool shares no connections between threads
+  CURL* curl = curl_easy_init();
+  if (curl) {
+    if (pool_) {
+      pool_->configure(curl);
+    }
+    segment->curl = curl;
+    curl_easy_setopt(curl, CURLOPT_URL, url_.c_str());
+    curl_easy_setopt(curl, CURLOPT_RANGE, range.c_str());
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, segment_write_callback);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, segment);
+    curl_easy_setopt(curl, CURLOPT_XFERINFOFUNCTION, segment_progress_callback);
+    curl_easy_setopt(curl, CURLOPT_XFERINFODATA, segment);
+    curl_easy_setopt(curl, CURLOPT_NOPROGRESS, 0L);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_USERAGENT, "FlutterF2FSound/1.0");
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 30L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, 1L);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, 30L);
+    res = curl_easy_perform(curl);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (curl) {
+    segment->curl = nullptr;
+    curl_easy_cleanup(curl);
+  }
+  segment->running = false;
+  running_segments_--;
+  if (segment->cursor < segment->end && !interrupted_) {
+    // What is left becomes a gap for the download thread to fetch
+    g_printerr("Failed to download bytes %s of %s: %s\n", range.c_str(), url_.c_str(),
+               curl_easy_strerror(res));
+    segment->failed = true;
+  }
+  data_available_.notify_all();
+  range_requested_.notify_all();
+}
+
+void HttpStream::run() {
+  curl_ = curl_easy_init();
+  if (!curl_) {
+    g_printerr("Failed to initialize libcurl\n");
+    std::lock_guard<std::mutex> lock(mutex_);
+    // No transfer will ever run, so reads return at once
+    failed_ = true;
+    interrupted_ = true;
+    data_available_.notify_all();
+    return;
+  }
+
+  if (pool_) {
+    pool_->configure(curl_);
+  }
+  curl_easy_setopt(curl_, CURLOPT_URL, url_.c_str());
+  curl_easy_setopt(curl_, CURLOPT_HEADERFUNCTION, header_callback);
+  curl_easy_setopt(curl_, CURLOPT_HEADERDATA, this);
+  curl_easy_setopt(curl_, CURLOPT_WRITEFUNCTION, write_callback);
+  curl_easy_setopt(curl_, CURLOPT_WRITEDATA, this);
+  curl_easy_setopt(curl_, CURLOPT_XFERINFOFUNCTION, progress_callback);
+  curl_easy_setopt(curl_, CURLOPT_XFERINFODATA, this);
+  curl_easy_setopt(curl_, CURLOPT_NOPROGRESS, 0L);
+  curl_easy_setopt(curl_, CURLOPT_FOLLOWLOCATION, 1L);
+  curl_easy_setopt(curl_, CURLOPT_USERAGENT, "FlutterF2FSound/1.0");
+  // The transfer lasts as long as the track, so only a stalled connection
+  // times out
+  curl_easy_setopt(curl_, CURLOPT_CONNECTTIMEOUT, 30L);
+  curl_easy_setopt(curl_, CURLOPT_LOW_SPEED_LIMIT, 1L);
+  curl_easy_setopt(curl_, CURLOPT_LOW_SPEED_TIME, 30L);
+
+  // One transfer per requested range; the handle keeps the connection alive
+  // between them
+  int64_t offset = 0;
+  int64_t end = -1;  // Exclusive; -1 runs to the end of the file
+  while (true) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (restart_requested_) {
+        offset = restart_offset_;
+        end = -1;
+        restart_requested_ = false;
+      }
+      transfer_offset_ = offset;
+      transfer_started_ = false;
+      transfer_active_ = true;
+      failed_ = false;
+      transfer_reached_limit_ = false;
+      cursor_ = offset;
+    }
+    std::string range;
+    if (end >= 0) {
+      range = std::to_string(offset) + "-" + std::to_string(end - 1);
+    } else if (offset > 0) {
+      range = std::to_string(offset) + "-";
+    }
+    curl_easy_setopt(curl_, CURLOPT_RANGE, range.empty() ? nullptr : range.c_str());
+    CURLcode res = curl_easy_perform(curl_);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    transfer_active_ = false;
+    if (interrupted_) {
+      break;
+    }
+    if (restart_requested_) {
+      continue;
+    }
+    if (res == CURLE_OK || transfer_reached_limit_) {
+      g_print("Downloaded %s from byte %lld to %lld\n", url_.c_str(), (long long)transfer_offset_,
+              (long long)cursor_);
+      if (content_length_ < 0) {
+        content_length_ = cursor_;
+      }
+    } else {
+      g_printerr("Failed to download audio: %s\n", curl_easy_strerror(res));
+      failed_ = true;
+    }
+    data_available_.notify_all();
+
+    // Segments still running fill in the rest
+    range_requested_.wait(lock, [this]() {
+      return running_segments_ == 0 || restart_requested_ || interrupted_;
+    });
+    if (interrupted_) {
+      break;
+    }
+    if (restart_requested_) {
+      continue;
+    }
+
+    if (on_complete_ && !failed_) {
+      if (fully_fetched()) {
+        lock.unlock();
+        on_complete_(*this);
+        lock.lock();
+      } else if (content_length_ >= 0 && ranges_supported_) {
+        // Fetch what seeks skipped over, one gap at a time, so the whole body
+        // reaches the completion callback
+        offset = fetched_end(0);
+        auto next = fetched_.upper_bound(offset);
+        end = next == fetched_.end() ? content_length_ : next->first;
+        continue;
+      }
+    }
+
+    // Idle until a read needs bytes that have not been fetched
+    range_requested_.wait(lock, [this]() { return restart_requested_ || interrupted_; });
+    if (interrupted_) {
+      break;
+    }
+  }
+
+  curl_easy_cleanup(curl_);
+  curl_ = nullptr;
+}
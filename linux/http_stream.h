@@ -0,0 +1,155 @@
+#ifndef FLUTTER_PLUGIN_HTTP_STREAM_H_
+#define FLUTTER_PLUGIN_HTTP_STREAM_H_
+
+#include <curl/curl.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "http_connection_pool.h"
+#include "streaming_decoder.h"
+
+// Response headers that identify a version of a resource, for revalidating
+// a cached copy.
+struct HttpValidators {
+  std::string etag;
+  std::string last_modified;
+
+  bool empty() const { return etag.empty() && last_modified.empty(); }
+
+  // Picks ETag and Last-Modified out of one raw header line.
+  void parse_header(const char* line, size_t length);
+};
+
+// Downloads a URL with libcurl on its own thread and serves the bytes to a
+// StreamingDecoder while the transfer is still running, so decoding and
+// playback start long before the download completes.
+//
+// Bytes are stored in fixed-size blocks allocated as they arrive, and a
+// sparse map records which byte ranges have been fetched. A read that lands
+// well outside the running transfer aborts it and restarts the download at
+// that offset with an HTTP Range request, so a seek into a large remote file
+// only waits for the bytes it needs. Servers that ignore Range answer with
+// the whole file, which is then simply read from the start. Reads of missing
+// bytes block until they arrive, the download fails or interrupt() is
+// called. With a completion callback, gaps left by seeks are fetched once the
+// reader is served, so the callback always sees the whole body.
+//
+// A large file from a server that advertises byte ranges is fetched in
+// segments: the first transfer keeps the front of the file and further
+// transfers, each on a thread and connection of its own, fetch the rest in
+// parallel, which fills a high-latency link that one TCP connection cannot.
+// The transfers run at once, so they take only DNS answers and TLS sessions
+// from the pool; each easy handle keeps a connection cache of its own.
+// A segment a seek jumps into hands the rest of its range to the restarted
+// transfer. If the segments are answered without ranges after all, the
+// first transfer simply carries on to the end of the file.
+class HttpStream : public DecoderInput {
+ public:
+  // Runs on the download thread once every byte of the body has arrived.
+  typedef std::function<void(HttpStream& stream)> CompletionCallback;
+
+  // Downloads through |pool|, which may be null.
+  static std::shared_ptr<HttpStream> start(const std::string& url,
+                                           std::shared_ptr<HttpConnectionPool> pool,
+                                           CompletionCallback on_complete = nullptr);
+
+  // Aborts the transfer if it is still running.
+  ~HttpStream() override;
+
+  HttpStream(const HttpStream&) = delete;
+  HttpStream& operator=(const HttpStream&) = delete;
+
+  // Content-Length once the response arrives, or -1 when the server sends
+  // none and the transfer has not finished.
+  int64_t length() override;
+  int64_t read(void* out, int64_t offset, int64_t count) override;
+  void interrupt() override;
+
+  // Validators of the last response.
+  HttpValidators validators();
+
+  // Writes the whole body to |file|. Only valid from the completion callback.
+  bool write_to(FILE* file);
+
+ private:
+  HttpStream(const std::string& url, std::shared_ptr<HttpConnectionPool> pool,
+             CompletionCallback on_complete);
+
+  static size_t header_callback(char* data, size_t size, size_t nmemb, void* user_data);
+  static size_t write_callback(char* data, size_t size, size_t nmemb, void* user_data);
+  static int progress_callback(void* user_data, curl_off_t, curl_off_t, curl_off_t, curl_off_t);
+
+  // A range fetched alongside the main transfer by a thread of its own.
+  struct Segment {
+    HttpStream* stream;
+    CURL* curl;
+    int64_t start;
+    int64_t end;     // Exclusive; lowered when a seek takes over the rest
+    int64_t cursor;  // Next byte it will write
+    bool started;
+    bool running;
+    bool failed;
+  };
+
+  static size_t segment_write_callback(char* data, size_t size, size_t nmemb, void* user_data);
+  static int segment_progress_callback(void* user_data, curl_off_t, curl_off_t, curl_off_t,
+                                       curl_off_t);
+
+  void run();
+  void run_segment(Segment* segment);
+
+  // Must be called with |mutex_| held.
+  bool fully_fetched() const;
+  int64_t fetched_end(int64_t offset) const;
+  void mark_fetched(int64_t start, int64_t end);
+  void store(const char* data, int64_t offset, int64_t length);
+  void request_range(int64_t offset);
+  void start_segments();
+  Segment* segment_at(int64_t offset);
+  int64_t transfer_limit() const;
+
+  const std::string url_;
+  const std::shared_ptr<HttpConnectionPool> pool_;
+  const CompletionCallback on_complete_;
+  CURL* curl_ = nullptr;  // Download thread only
+  std::thread thread_;
+  std::atomic<bool> interrupted_{false};
+  std::atomic<bool> restart_requested_{false};
+
+  std::mutex mutex_;
+  std::condition_variable data_available_;
+  std::condition_variable range_requested_;
+  std::vector<std::unique_ptr<uint8_t[]>> blocks_;
+  std::map<int64_t, int64_t> fetched_;  // Start -> end of each fetched range
+  int64_t content_length_ = -1;
+  bool ranges_supported_ = true;
+  bool accept_ranges_ = false;  // Advertised by the server
+  bool failed_ = false;  // The last transfer stopped at |cursor_| with an error
+  HttpValidators validators_;
+
+  // The running transfer: where it started, whether its response has
+  // arrived, and the offset of the next byte it will write. Idle once the
+  // transfer reaches the end of the file.
+  int64_t transfer_offset_ = 0;
+  bool transfer_started_ = false;
+  bool transfer_active_ = false;
+  int64_t cursor_ = 0;
+  int64_t restart_offset_ = 0;
+  bool transfer_reached_limit_ = false;  // Stopped where a segment begins
+
+  std::vector<std::unique_ptr<Segment>> segments_;
+  std::vector<std::thread> segment_threads_;
+  int running_segments_ = 0;
+};
+
+#endif  // FLUTTER_PLUGIN_HTTP_STREAM_H_
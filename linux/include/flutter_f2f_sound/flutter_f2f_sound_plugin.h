@@ -29,6 +29,46 @@ FLUTTER_PLUGIN_EXPORT GType flutter_f2f_sound_plugin_get_type();
 FLUTTER_PLUGIN_EXPORT void flutter_f2f_sound_plugin_register_with_registrar(
     FlPluginRegistrar* registrar);
 
+// Capture sessions that can publish PCM into a shared-memory ring instead of
+// the event channels. Pass "transport": "ring" to startRecording or
+// startSystemSoundCapture to select it. The ring carries s16 PCM only, so
+// those calls fail with INVALID_ARGUMENT when they also ask for float32,
+// packetDurationMs, maxQueuedPackets or overflowPolicy.
+enum {
+  FLUTTER_F2F_SOUND_RING_RECORDING = 0,
+  FLUTTER_F2F_SOUND_RING_SYSTEM_SOUND = 1,
+};
+
+// Snapshot of a capture ring for in-place readers such as dart:ffi.
+//
+// Indices are free-running byte counters; the byte for index i lives at
+// data[i & (capacity - 1)]. Bytes in [read_index, write_index) are valid
+// until they are released with flutter_f2f_sound_ring_consume. Rings are
+// created by the first session that uses them and are never freed, so |data|
+// stays valid for the life of the process. |data| is null for a ring that
+// has not been created yet. The ring keeps its first capacity.
+//
+// The reader is the only consumer. Bytes before session_start_index belong to
+// an earlier session; a reader whose read_index is behind it should consume
+// up to it before reading.
+typedef struct {
+  uint8_t* data;
+  uint64_t capacity;
+  uint64_t write_index;
+  uint64_t read_index;
+  uint64_t session_start_index;  // write_index when the current session began
+  uint64_t overrun_bytes;  // Bytes dropped because the reader fell behind
+  uint64_t overrun_count;  // Writes that dropped bytes
+  int32_t notify_fd;       // eventfd signalled after each write, or -1
+} FlutterF2fSoundRingState;
+
+FLUTTER_PLUGIN_EXPORT FlutterF2fSoundRingState flutter_f2f_sound_ring_state(
+    int32_t ring_id);
+
+// Releases |bytes| read bytes back to the producer.
+FLUTTER_PLUGIN_EXPORT void flutter_f2f_sound_ring_consume(int32_t ring_id,
+                                                          uint64_t bytes);
+
 G_END_DECLS
 
 #endif  // FLUTTER_PLUGIN_FLUTTER_F2F_SOUND_PLUGIN_H_
@@ -0,0 +1,147 @@
+#include "mapped_wav_source.h"
+
+#include <fcntl.h>
+#include <glib.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// Data kept requested from the disk ahead of the play position, about six
+// seconds of CD-quality stereo. open() also faults this much in up front.
+constexpr size_t kReadAheadBytes = 1024 * 1024;
+
+// Whether the samples at |data| can go to the output as they are: aligned
+// 16-bit PCM on a little-endian host.
+bool playable_in_place(const WavFormat& format, const uint8_t* data) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return false;
+#else
+  return format.is_pcm16() && (uintptr_t)data % alignof(int16_t) == 0;
+#endif
+}
+
+}  // namespace
+
+std::unique_ptr<MappedWavSource> MappedWavSource::open(const std::string& path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size < 12) {
+    close(fd);
+    return nullptr;
+  }
+  const size_t size = (size_t)st.st_size;
+  void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps the file open
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    return nullptr;
+  }
+
+  const auto* file = static_cast<const uint8_t*>(mapping);
+  RiffParser parser;
+  const RiffParser::Status status = parser.parse(
+      [file, size](uint64_t offset, void* out, size_t count) -> size_t {
+        const size_t length = offset < size ? std::min<size_t>(count, size - (size_t)offset) : 0;
+        memcpy(out, file + offset, length);
+        return length;
+      },
+      size);
+  const WavFormat& format = parser.format();
+  if (status != RiffParser::Status::kOk || parser.frames() == 0 ||
+      format.sample_rate > (uint32_t)INT32_MAX) {
+    munmap(mapping, size);
+    return nullptr;
+  }
+
+  madvise(mapping, size, MADV_SEQUENTIAL);
+  std::unique_ptr<MappedWavSource> source(new MappedWavSource(
+      mapping, size, file + parser.data_offset(), format, parser.frames()));
+  source->read_ahead();
+
+  // Fault in the start here, on the worker, rather than on the audio thread
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t prefault_end = std::min((size_t)parser.data_offset() + kReadAheadBytes, size);
+  volatile uint8_t sink = 0;
+  for (size_t offset = (size_t)parser.data_offset(); offset < prefault_end; offset += page) {
+    sink = sink + file[offset];
+  }
+
+  g_print("Mapped %s for playback (%u Hz, %u channels, %u bits%s, %llu frames)\n", path.c_str(),
+          format.sample_rate, format.channels, format.bits_per_sample,
+          format.sample_format == WavSampleFormat::kFloat ? " float" : "",
+          (unsigned long long)parser.frames());
+  return source;
+}
+
+MappedWavSource::MappedWavSource(void* mapping, size_t mapping_bytes, const uint8_t* data,
+                                 const WavFormat& format, uint64_t frames)
+    : mapping_(mapping),
+      mapping_bytes_(mapping_bytes),
+      data_(data),
+      format_(format),
+      frames_(frames),
+      in_place_(playable_in_place(format, data)) {}
+
+MappedWavSource::~MappedWavSource() {
+  munmap(mapping_, mapping_bytes_);
+}
+
+size_t MappedWavSource::read(uint8_t* out, size_t length) {
+  if (in_place_) {
+    const uint8_t* data = read_in_place(&length);
+    memcpy(out, data, length);
+    return length;
+  }
+  const uint64_t frames = std::min<uint64_t>(length / frame_bytes(), frames_ - position_frames_);
+  wav_samples_to_s16(format_, data_ + position_frames_ * format_.block_align, (size_t)frames,
+                     reinterpret_cast<int16_t*>(out));
+  position_frames_ += frames;
+  read_ahead();
+  return (size_t)frames * frame_bytes();
+}
+
+const uint8_t* MappedWavSource::read_in_place(size_t* length) {
+  if (!in_place_) {
+    return nullptr;
+  }
+  const uint64_t frames = std::min<uint64_t>(*length / frame_bytes(), frames_ - position_frames_);
+  const uint8_t* data = data_ + position_frames_ * frame_bytes();
+  position_frames_ += frames;
+  *length = (size_t)frames * frame_bytes();
+  read_ahead();
+  return data;
+}
+
+void MappedWavSource::seek(uint64_t frame) {
+  position_frames_ = std::min(frame, frames_);
+  // Forget the old window so the new position is requested right away
+  read_ahead_end_ = 0;
+  read_ahead();
+}
+
+void MappedWavSource::read_ahead() {
+  const size_t position = (size_t)position_frames_ * format_.block_align;
+  const size_t data_bytes = (size_t)frames_ * format_.block_align;
+  if (read_ahead_end_ >= data_bytes ||
+      (read_ahead_end_ > position && read_ahead_end_ - position > kReadAheadBytes / 2)) {
+    return;
+  }
+
+  // madvise() wants a page-aligned start; it only queues the reads
+  const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+  const size_t start = std::max(read_ahead_end_, position);
+  const size_t end = std::min(position + kReadAheadBytes, data_bytes);
+  const auto* base = static_cast<const uint8_t*>(mapping_);
+  const size_t file_start = (size_t)(data_ + start - base) / page * page;
+  const size_t file_end = (size_t)(data_ + end - base);
+  madvise(const_cast<uint8_t*>(base) + file_start, file_end - file_start, MADV_WILLNEED);
+  read_ahead_end_ = end;
+}
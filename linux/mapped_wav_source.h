@@ -0,0 +1,59 @@
+#ifndef FLUTTER_PLUGIN_MAPPED_WAV_SOURCE_H_
+#define FLUTTER_PLUGIN_MAPPED_WAV_SOURCE_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "audio_source.h"
+#include "riff_parser.h"
+
+// Plays the data chunk of an uncompressed WAV file straight out of a
+// read-only memory mapping. Nothing is decoded up front, so playback starts
+// as soon as the headers are parsed, and the samples live in the page cache
+// rather than in a private copy however long the file is. 16-bit PCM is
+// played in place; 8/24/32-bit PCM and float are converted a period at a
+// time. RF64/BW64 files beyond 4 GB are supported.
+//
+// The first moments of audio are faulted in by open(), which runs on a
+// worker; after that each read asks the kernel to read ahead of the play
+// position, so the audio thread does not wait on the disk.
+class MappedWavSource : public AudioSource {
+ public:
+  // Maps |path|. Returns nullptr unless RiffParser accepts it, so other
+  // files go through the decoder.
+  static std::unique_ptr<MappedWavSource> open(const std::string& path);
+
+  ~MappedWavSource() override;
+
+  MappedWavSource(const MappedWavSource&) = delete;
+  MappedWavSource& operator=(const MappedWavSource&) = delete;
+
+  int sample_rate() const override { return (int)format_.sample_rate; }
+  int channels() const override { return format_.channels; }
+  uint64_t frames() const override { return frames_; }
+  size_t read(uint8_t* out, size_t length) override;
+  const uint8_t* read_in_place(size_t* length) override;
+  void seek(uint64_t frame) override;
+  bool at_end() const override { return position_frames_ >= frames_; }
+  uint64_t position_frames() const override { return position_frames_; }
+
+ private:
+  MappedWavSource(void* mapping, size_t mapping_bytes, const uint8_t* data,
+                  const WavFormat& format, uint64_t frames);
+
+  // Starts reading ahead once the position nears the end of the window
+  // already requested.
+  void read_ahead();
+
+  void* const mapping_;
+  const size_t mapping_bytes_;
+  const uint8_t* const data_;  // Start of the data chunk
+  const WavFormat format_;
+  const uint64_t frames_;
+  const bool in_place_;  // Samples already in the output format
+  uint64_t position_frames_ = 0;
+  size_t read_ahead_end_ = 0;  // Data offset the kernel was last asked to read to
+};
+
+#endif  // FLUTTER_PLUGIN_MAPPED_WAV_SOURCE_H_
@@ -0,0 +1,34 @@
+#ifndef FLUTTER_PLUGIN_MEMORY_INPUT_H_
+#define FLUTTER_PLUGIN_MEMORY_INPUT_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "streaming_decoder.h"
+
+// Serves a byte buffer that is already complete, such as audio generated in
+// Dart, to StreamingDecoder::open_virtual(). Reads never block.
+class MemoryInput : public DecoderInput {
+ public:
+  explicit MemoryInput(std::vector<uint8_t> data) : data_(std::move(data)) {}
+
+  int64_t length() override { return (int64_t)data_.size(); }
+
+  int64_t read(void* out, int64_t offset, int64_t count) override {
+    if (offset >= (int64_t)data_.size()) {
+      return 0;
+    }
+    count = std::min<int64_t>(count, (int64_t)data_.size() - offset);
+    memcpy(out, data_.data() + offset, (size_t)count);
+    return count;
+  }
+
+  void interrupt() override {}
+
+ private:
+  const std::vector<uint8_t> data_;
+};
+
+#endif  // FLUTTER_PLUGIN_MEMORY_INPUT_H_
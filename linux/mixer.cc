@@ -0,0 +1,358 @@
+#include "mixer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+// Commands that can wait between two callbacks, and finished voices that
+// can wait for the platform thread.
+constexpr size_t kCommandQueueLength = 256;
+constexpr size_t kFinishedQueueLength = 1024;
+
+constexpr float kMinRate = 1.0f / 16;
+constexpr float kMaxRate = 16.0f;
+
+// Level where the soft clipper starts bending, about 80% of full scale. A
+// whole number, so quieter samples pass through exactly.
+constexpr float kKnee = 26214.0f;
+
+// Adds a stereo voice into the mix with gains ramping linearly from
+// |left|/|right| by |left_step|/|right_step| per frame. Plain loop over
+// restrict pointers so the compiler vectorizes it.
+void mix_add(float* __restrict mix, const float* __restrict voice, size_t frames, float left,
+             float right, float left_step, float right_step) {
+  // An int counter converts to float in vector registers; size_t does not
+  const int count = (int)frames;
+  for (int i = 0; i < count; i++) {
+    mix[2 * i] += voice[2 * i] * (left + left_step * (float)i);
+    mix[2 * i + 1] += voice[2 * i + 1] * (right + right_step * (float)i);
+  }
+}
+
+}  // namespace
+
+constexpr int Mixer::kChannels;
+constexpr size_t Mixer::kMaxVoices;
+constexpr size_t Mixer::kBlockFrames;
+
+void soft_clip_to_pcm16(const float* __restrict in, int16_t* __restrict out, size_t count) {
+  constexpr float kRange = 32767.0f - kKnee;
+  for (size_t i = 0; i < count; i++) {
+    // max(x, 0) written as (x + |x|) / 2, and min alike, so the loop has no
+    // selects for the compiler to turn back into branches
+    const float magnitude = std::fabs(in[i]);
+    const float excess = magnitude - kKnee;
+    const float below = kKnee - magnitude;
+    const float over = 0.5f * (excess + std::fabs(excess)) * (1.0f / kRange);
+    const float linear = kKnee - 0.5f * (below + std::fabs(below));
+    // Beyond the knee x / (1 + x) approaches full scale with unit slope
+    const float shaped = linear + kRange * over / (1.0f + over);
+    out[i] = (int16_t)(int)std::copysign(shaped, in[i]);
+  }
+}
+
+Mixer::Mixer(int sample_rate)
+    : sample_rate_(sample_rate),
+      commands_(kCommandQueueLength * sizeof(Command)),
+      finished_(kFinishedQueueLength * sizeof(uint32_t)) {
+  for (std::atomic<uint32_t>& id : voice_ids_) {
+    id.store(0, std::memory_order_relaxed);
+  }
+}
+
+// ==================== Platform Thread ====================
+
+bool Mixer::push(const Command& command) {
+  // Whole commands only: the audio thread reads them one at a time
+  if (commands_.capacity() - commands_.readable() < sizeof(command)) {
+    dropped_commands_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+  commands_.write(reinterpret_cast<const uint8_t*>(&command), sizeof(command));
+  pushed_commands_++;
+  return true;
+}
+
+// Lets go of the sounds of voices the audio thread has finished with.
+void Mixer::collect() {
+  uint32_t voice;
+  while (finished_.readable() >= sizeof(voice)) {
+    finished_.read(reinterpret_cast<uint8_t*>(&voice), sizeof(voice));
+    playing_.erase(voice);
+  }
+  if (lost_finishes_.load(std::memory_order_acquire) != reconciled_finishes_) {
+    reconcile();
+  }
+}
+
+// Finds the voices whose finish report was lost: started, since their play
+// command has been applied, but on no voice any more.
+void Mixer::reconcile() {
+  reconciled_finishes_ = lost_finishes_.load(std::memory_order_acquire);
+  const uint64_t applied = applied_commands_.load(std::memory_order_acquire);
+  for (auto it = playing_.begin(); it != playing_.end();) {
+    bool alive = it->second.command >= applied;
+    for (const std::atomic<uint32_t>& id : voice_ids_) {
+      alive = alive || id.load(std::memory_order_acquire) == it->first;
+    }
+    it = alive ? std::next(it) : playing_.erase(it);
+  }
+}
+
+uint32_t Mixer::play(std::shared_ptr<const DecodedPcm> pcm, const VoiceParams& params) {
+  collect();
+  if (!pcm || pcm->channels <= 0 || pcm->sample_rate <= 0) {
+    return 0;
+  }
+
+  const uint32_t voice = next_voice_;
+  const uint64_t sequence = pushed_commands_;
+  Command command = {CommandType::kPlay, voice, pcm.get(), params};
+  if (!push(command)) {
+    return 0;
+  }
+  next_voice_ = next_voice_ == UINT32_MAX ? 1 : next_voice_ + 1;
+  playing_[voice] = Playing{std::move(pcm), params, sequence};
+  return voice;
+}
+
+bool Mixer::set_params(uint32_t voice, const VoiceParams& params) {
+  collect();
+  auto it = playing_.find(voice);
+  if (it == playing_.end()) {
+    return false;
+  }
+  Command command = {CommandType::kSetParams, voice, nullptr, params};
+  if (!push(command)) {
+    return false;
+  }
+  it->second.params = params;
+  return true;
+}
+
+bool Mixer::stop(uint32_t voice) {
+  collect();
+  if (playing_.find(voice) == playing_.end()) {
+    return false;
+  }
+  Command command = {CommandType::kStop, voice, nullptr, VoiceParams()};
+  return push(command);
+}
+
+void Mixer::stop_all() {
+  Command command = {CommandType::kStopAll, 0, nullptr, VoiceParams()};
+  push(command);
+}
+
+bool Mixer::params(uint32_t voice, VoiceParams* params) {
+  collect();
+  auto it = playing_.find(voice);
+  if (it == playing_.end()) {
+    return false;
+  }
+  *params = it->second.params;
+  return true;
+}
+
+Mixer::Stats Mixer::stats() {
+  collect();
+  Stats stats;
+  stats.active_voices = active_voices_.load(std::memory_order_relaxed);
+  stats.peak_voices = peak_voices_.load(std::memory_order_relaxed);
+  stats.stolen_voices = stolen_voices_.load(std::memory_order_relaxed);
+  stats.dropped_commands = dropped_commands_.load(std::memory_order_relaxed);
+  stats.lost_finishes = lost_finishes_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// ==================== Audio Thread ====================
+
+void Mixer::apply(const Command& command) {
+  switch (command.type) {
+    case CommandType::kPlay:
+      start_voice(command);
+      break;
+    case CommandType::kSetParams:
+    case CommandType::kStop:
+      for (Voice& voice : voices_) {
+        if (voice.id == command.voice) {
+          if (command.type == CommandType::kStop) {
+            voice.stopping = true;
+          } else {
+            set_voice_params(voice, command.params);
+          }
+          break;
+        }
+      }
+      break;
+    case CommandType::kStopAll:
+      for (Voice& voice : voices_) {
+        voice.stopping = true;
+      }
+      break;
+  }
+}
+
+void Mixer::start_voice(const Command& command) {
+  // A free voice, or else the one that has played longest
+  Voice* target = &voices_[0];
+  for (Voice& voice : voices_) {
+    if (voice.id == 0) {
+      target = &voice;
+      break;
+    }
+    if (voice.started < target->started) {
+      target = &voice;
+    }
+  }
+  if (target->id != 0) {
+    finish_voice(*target);
+    stolen_voices_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  Voice& voice = *target;
+  voice.id = command.voice;
+  voice_ids_[target - voices_].store(voice.id, std::memory_order_release);
+  voice.started = ++started_count_;
+  voice.pcm = command.pcm;
+  voice.frames = command.pcm->samples.size() / command.pcm->channels;
+  voice.position = 0.0;
+  voice.stopping = false;
+  set_voice_params(voice, command.params);
+
+  // Sounds start at full level; only later changes ramp
+  voice.left_gain = voice.params.gain * std::min(1.0f, 1.0f - voice.params.pan);
+  voice.right_gain = voice.params.gain * std::min(1.0f, 1.0f + voice.params.pan);
+}
+
+void Mixer::set_voice_params(Voice& voice, const VoiceParams& params) {
+  voice.params = params;
+  voice.params.gain = std::max(params.gain, 0.0f);
+  voice.params.pan = std::max(-1.0f, std::min(1.0f, params.pan));
+  voice.params.rate = std::max(kMinRate, std::min(kMaxRate, params.rate));
+  voice.step = (double)voice.params.rate * voice.pcm->sample_rate / sample_rate_;
+}
+
+void Mixer::finish_voice(Voice& voice) {
+  // The queue is sized well beyond what can finish between two collects;
+  // should it fill anyway, the platform thread is told to reconcile
+  const bool reported = finished_.capacity() - finished_.readable() >= sizeof(voice.id);
+  if (reported) {
+    finished_.write(reinterpret_cast<const uint8_t*>(&voice.id), sizeof(voice.id));
+  }
+  voice.id = 0;
+  voice.pcm = nullptr;
+  voice_ids_[&voice - voices_].store(0, std::memory_order_release);
+  if (!reported) {
+    lost_finishes_.fetch_add(1, std::memory_order_release);
+  }
+}
+
+// Reads up to |frames| frames of |voice| as interleaved stereo float in s16
+// units, resampling by linear interpolation unless the voice plays at the
+// output rate. Returns how many frames were read before a one-shot ended.
+size_t Mixer::fetch(Voice& voice, float* out, size_t frames) {
+  const int16_t* samples = voice.pcm->samples.data();
+  const size_t channels = (size_t)voice.pcm->channels;
+  const size_t right = channels > 1 ? 1 : 0;  // Mono plays on both sides
+  const uint64_t total = voice.frames;
+  if (total == 0) {
+    return 0;
+  }
+
+  size_t done = 0;
+  if (voice.step == 1.0) {
+    uint64_t position = (uint64_t)voice.position;
+    while (done < frames) {
+      if (position >= total) {
+        if (!voice.params.loop) {
+          break;
+        }
+        position = 0;
+      }
+      const size_t count = (size_t)std::min<uint64_t>(frames - done, total - position);
+      const int16_t* in = samples + position * channels;
+      float* dst = out + done * kChannels;
+      for (size_t i = 0; i < count; i++) {
+        dst[2 * i] = in[i * channels];
+        dst[2 * i + 1] = in[i * channels + right];
+      }
+      done += count;
+      position += count;
+    }
+    voice.position = (double)position;
+    return done;
+  }
+
+  double position = voice.position;
+  for (; done < frames; done++) {
+    if (position >= total) {
+      if (!voice.params.loop) {
+        break;
+      }
+      position = std::fmod(position, (double)total);
+    }
+    const uint64_t index = (uint64_t)position;
+    const float fraction = (float)(position - index);
+    const uint64_t next = index + 1 < total ? index + 1 : (voice.params.loop ? 0 : index);
+    const int16_t* a = samples + index * channels;
+    const int16_t* b = samples + next * channels;
+    out[2 * done] = a[0] + (b[0] - a[0]) * fraction;
+    out[2 * done + 1] = a[right] + (b[right] - a[right]) * fraction;
+    position += voice.step;
+  }
+  voice.position = position;
+  return done;
+}
+
+void Mixer::mix_voice(Voice& voice, size_t frames) {
+  const size_t count = fetch(voice, scratch_, frames);
+
+  float left = 0.0f;
+  float right = 0.0f;
+  if (!voice.stopping) {
+    left = voice.params.gain * std::min(1.0f, 1.0f - voice.params.pan);
+    right = voice.params.gain * std::min(1.0f, 1.0f + voice.params.pan);
+  }
+  if (count > 0) {
+    mix_add(mix_, scratch_, count, voice.left_gain, voice.right_gain,
+            (left - voice.left_gain) / count, (right - voice.right_gain) / count);
+  }
+  voice.left_gain = left;
+  voice.right_gain = right;
+
+  if (voice.stopping || count < frames) {
+    finish_voice(voice);
+  }
+}
+
+void Mixer::render(int16_t* out, size_t frames) {
+  Command command;
+  while (commands_.readable() >= sizeof(command)) {
+    commands_.read(reinterpret_cast<uint8_t*>(&command), sizeof(command));
+    apply(command);
+    applied_commands_.fetch_add(1, std::memory_order_release);
+  }
+
+  size_t active = 0;
+  for (size_t offset = 0; offset < frames; offset += kBlockFrames) {
+    const size_t block = std::min(kBlockFrames, frames - offset);
+    std::fill(mix_, mix_ + block * kChannels, 0.0f);
+    active = 0;
+    for (Voice& voice : voices_) {
+      if (voice.id != 0) {
+        active++;
+        mix_voice(voice, block);
+      }
+    }
+    soft_clip_to_pcm16(mix_, out + offset * kChannels, block * kChannels);
+  }
+
+  active_voices_.store(active, std::memory_order_relaxed);
+  if (active > peak_voices_.load(std::memory_order_relaxed)) {
+    peak_voices_.store(active, std::memory_order_relaxed);
+  }
+}
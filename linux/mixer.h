@@ -0,0 +1,153 @@
+#ifndef FLUTTER_PLUGIN_MIXER_H_
+#define FLUTTER_PLUGIN_MIXER_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "pcm_cache.h"
+#include "spsc_ring_buffer.h"
+
+// Plays any number of overlapping sounds through one stereo output stream.
+//
+// A fixed pool of voices is mixed on the audio thread, each with its own
+// gain, pan, playback rate and looping. The platform thread drives the pool
+// through a lock-free command queue, so starting a sound never waits for the
+// audio thread, and the audio thread hands finished voices back through a
+// second queue. Sounds are DecodedPcm shared by reference: the mixer keeps
+// each one alive until the voices playing it are done, so the audio thread
+// never frees memory.
+//
+// Voices are summed in float and the sum goes through a soft clipper, so a
+// pile-up of loud sounds saturates smoothly instead of wrapping. Gain and
+// pan changes and stops ramp over one block to avoid clicks.
+//
+// play(), set_params(), stop(), stop_all(), params() and stats() form the
+// producer side and must be called from one thread; render() is the audio
+// thread's.
+class Mixer {
+ public:
+  static constexpr int kChannels = 2;
+  static constexpr size_t kMaxVoices = 32;
+
+  struct VoiceParams {
+    float gain = 1.0f;
+    float pan = 0.0f;   // -1 (left) to 1 (right)
+    float rate = 1.0f;  // Playback speed; also shifts the pitch
+    bool loop = false;
+  };
+
+  struct Stats {
+    size_t active_voices = 0;
+    size_t peak_voices = 0;
+    uint64_t stolen_voices = 0;     // Cut short for a new sound when all were busy
+    uint64_t dropped_commands = 0;  // The audio thread had fallen behind
+    uint64_t lost_finishes = 0;     // Finished voices the queue had no room to report
+  };
+
+  explicit Mixer(int sample_rate);
+
+  Mixer(const Mixer&) = delete;
+  Mixer& operator=(const Mixer&) = delete;
+
+  int sample_rate() const { return sample_rate_; }
+
+  // Starts |pcm| on a free voice, or in place of the oldest one when all are
+  // busy, and returns the voice id, or 0 when the command queue is full.
+  uint32_t play(std::shared_ptr<const DecodedPcm> pcm, const VoiceParams& params);
+
+  // Both return false when |voice| has already finished.
+  bool set_params(uint32_t voice, const VoiceParams& params);
+  bool stop(uint32_t voice);
+
+  void stop_all();
+
+  // Current parameters of a voice that is still playing.
+  bool params(uint32_t voice, VoiceParams* params);
+
+  Stats stats();
+
+  // Audio thread. Mixes the next |frames| interleaved stereo frames.
+  void render(int16_t* out, size_t frames);
+
+ private:
+  // Frames mixed per pass; also the length of parameter ramps.
+  static constexpr size_t kBlockFrames = 256;
+
+  enum class CommandType : uint8_t { kPlay, kSetParams, kStop, kStopAll };
+
+  struct Command {
+    CommandType type;
+    uint32_t voice;
+    const DecodedPcm* pcm;
+    VoiceParams params;
+  };
+
+  // Audio thread only.
+  struct Voice {
+    uint32_t id = 0;  // 0 when free
+    uint64_t started = 0;
+    const DecodedPcm* pcm = nullptr;
+    uint64_t frames = 0;
+    double position = 0.0;  // In source frames
+    double step = 1.0;      // Source frames per output frame
+    VoiceParams params;
+    float left_gain = 0.0f;  // Reached at the end of the last block
+    float right_gain = 0.0f;
+    bool stopping = false;
+  };
+
+  // Platform thread side of a voice that has not been reported finished.
+  struct Playing {
+    std::shared_ptr<const DecodedPcm> pcm;
+    VoiceParams params;
+    uint64_t command;  // Commands pushed before its kPlay
+  };
+
+  bool push(const Command& command);
+  void collect();
+  void reconcile();
+
+  void apply(const Command& command);
+  void start_voice(const Command& command);
+  void set_voice_params(Voice& voice, const VoiceParams& params);
+  void finish_voice(Voice& voice);
+  size_t fetch(Voice& voice, float* out, size_t frames);
+  void mix_voice(Voice& voice, size_t frames);
+
+  const int sample_rate_;
+  SpscRingBuffer commands_;
+  SpscRingBuffer finished_;  // Voice ids, audio thread to platform thread
+
+  // Platform thread only
+  uint32_t next_voice_ = 1;
+  uint64_t pushed_commands_ = 0;
+  uint64_t reconciled_finishes_ = 0;
+  std::unordered_map<uint32_t, Playing> playing_;
+
+  // Audio thread only
+  Voice voices_[kMaxVoices];
+  uint64_t started_count_ = 0;
+  float mix_[kBlockFrames * kChannels];
+  float scratch_[kBlockFrames * kChannels];
+
+  std::atomic<size_t> active_voices_{0};
+  std::atomic<size_t> peak_voices_{0};
+  std::atomic<uint64_t> stolen_voices_{0};
+  std::atomic<uint64_t> dropped_commands_{0};
+
+  // What the audio thread has done, for the platform thread to reconcile
+  // with when a finished voice could not be reported: the id on each voice
+  // (0 when free), the number of commands applied, and of lost reports.
+  std::atomic<uint32_t> voice_ids_[kMaxVoices];
+  std::atomic<uint64_t> applied_commands_{0};
+  std::atomic<uint64_t> lost_finishes_{0};
+};
+
+// Converts |count| mixed samples, in s16 units, to s16: everything below the
+// knee passes unchanged and louder samples bend smoothly towards full scale.
+void soft_clip_to_pcm16(const float* in, int16_t* out, size_t count);
+
+#endif  // FLUTTER_PLUGIN_MIXER_H_
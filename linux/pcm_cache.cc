@@ -0,0 +1,126 @@
+#include "pcm_cache.h"
+
+#include <glib.h>
+#include <sndfile.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+
+PcmBufferSource::PcmBufferSource(std::shared_ptr<const DecodedPcm> pcm)
+    : pcm_(std::move(pcm)), frames_(pcm_->samples.size() / (size_t)pcm_->channels) {}
+
+size_t PcmBufferSource::read(uint8_t* out, size_t length) {
+  const uint8_t* data = read_in_place(&length);
+  memcpy(out, data, length);
+  return length;
+}
+
+const uint8_t* PcmBufferSource::read_in_place(size_t* length) {
+  const uint64_t frames = std::min<uint64_t>(*length / frame_bytes(), frames_ - position_frames_);
+  const int16_t* data = pcm_->samples.data() + position_frames_ * (size_t)pcm_->channels;
+  position_frames_ += frames;
+  *length = (size_t)frames * frame_bytes();
+  return reinterpret_cast<const uint8_t*>(data);
+}
+
+void PcmBufferSource::seek(uint64_t frame) {
+  position_frames_ = std::min(frame, frames_);
+}
+
+PcmCache::PcmCache(size_t budget_bytes) {
+  stats_.budget_bytes = budget_bytes;
+}
+
+std::shared_ptr<const DecodedPcm> PcmCache::get(const std::string& path) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return nullptr;
+  }
+  const std::string key = path + '\n' + std::to_string((long long)st.st_size) + '\n' +
+                          std::to_string((long long)st.st_mtim.tv_sec) + '.' +
+                          std::to_string((long long)st.st_mtim.tv_nsec);
+
+  size_t max_bytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, it->second);
+      stats_.hits++;
+      return it->second->pcm;
+    }
+    stats_.misses++;
+    max_bytes = stats_.budget_bytes / 4;
+  }
+
+  // Decode without the lock so other plays are not held up
+  std::shared_ptr<const DecodedPcm> pcm = decode(path, max_bytes);
+  if (!pcm) {
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // Another play decoded it meanwhile
+    return it->second->pcm;
+  }
+  entries_.push_front(Entry{key, pcm});
+  index_[key] = entries_.begin();
+  stats_.entries++;
+  stats_.bytes += pcm->bytes();
+  evict_locked();
+  return pcm;
+}
+
+void PcmCache::set_budget(size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.budget_bytes = budget_bytes;
+  evict_locked();
+}
+
+PcmCache::Stats PcmCache::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+std::shared_ptr<const DecodedPcm> PcmCache::decode(const std::string& path, size_t max_bytes) {
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  SNDFILE* sndfile = sf_open(path.c_str(), SFM_READ, &info);
+  if (!sndfile) {
+    return nullptr;
+  }
+  const uint64_t bytes = (uint64_t)info.frames * (uint64_t)info.channels * sizeof(int16_t);
+  if (info.samplerate <= 0 || info.channels <= 0 || info.frames <= 0 || bytes > max_bytes) {
+    sf_close(sndfile);
+    return nullptr;
+  }
+
+  auto pcm = std::make_shared<DecodedPcm>();
+  pcm->sample_rate = info.samplerate;
+  pcm->channels = info.channels;
+  pcm->samples.resize((size_t)info.frames * (size_t)info.channels);
+  const sf_count_t frames = sf_readf_short(sndfile, pcm->samples.data(), info.frames);
+  sf_close(sndfile);
+  if (frames <= 0) {
+    return nullptr;
+  }
+  // Headers can overstate the length
+  pcm->samples.resize((size_t)frames * (size_t)info.channels);
+
+  g_print("Decoded %s into the PCM cache (%zu bytes)\n", path.c_str(), pcm->bytes());
+  return pcm;
+}
+
+void PcmCache::evict_locked() {
+  while (stats_.bytes > stats_.budget_bytes && !entries_.empty()) {
+    const Entry& entry = entries_.back();
+    stats_.bytes -= entry.pcm->bytes();
+    stats_.entries--;
+    stats_.evictions++;
+    index_.erase(entry.key);
+    entries_.pop_back();
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef FLUTTER_PLUGIN_PCM_CACHE_H_
+#define FLUTTER_PLUGIN_PCM_CACHE_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "audio_source.h"
+
+// A whole file decoded to interleaved s16 at its own sample rate, the format
+// the output plays. Immutable once built, so any number of playbacks can
+// read it at once.
+struct DecodedPcm {
+  int sample_rate = 0;
+  int channels = 0;
+  std::vector<int16_t> samples;
+
+  size_t bytes() const { return samples.size() * sizeof(int16_t); }
+};
+
+// Plays a DecodedPcm straight from memory.
+class PcmBufferSource : public AudioSource {
+ public:
+  explicit PcmBufferSource(std::shared_ptr<const DecodedPcm> pcm);
+
+  int sample_rate() const override { return pcm_->sample_rate; }
+  int channels() const override { return pcm_->channels; }
+  uint64_t frames() const override { return frames_; }
+  size_t read(uint8_t* out, size_t length) override;
+  const uint8_t* read_in_place(size_t* length) override;
+  void seek(uint64_t frame) override;
+  bool at_end() const override { return position_frames_ >= frames_; }
+  uint64_t position_frames() const override { return position_frames_; }
+
+ private:
+  const std::shared_ptr<const DecodedPcm> pcm_;
+  const uint64_t frames_;
+  uint64_t position_frames_ = 0;
+};
+
+// Decoded audio of recently played files, so playing the same short file
+// again costs a lookup instead of a decode.
+//
+// Entries are keyed by path, size and modification time, so a file that
+// changes on disk is decoded afresh. Once the cached audio exceeds the
+// memory budget the least recently used entries are dropped; playbacks
+// still reading one keep it alive until they finish. Safe to use from
+// several threads.
+class PcmCache {
+ public:
+  struct Stats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget_bytes = 0;
+  };
+
+  explicit PcmCache(size_t budget_bytes);
+
+  PcmCache(const PcmCache&) = delete;
+  PcmCache& operator=(const PcmCache&) = delete;
+
+  // Returns the decoded audio of |path|, decoding the whole file on a miss.
+  // Returns nullptr for files libsndfile cannot read and for files that
+  // decode to more than a quarter of the budget, which are better streamed.
+  std::shared_ptr<const DecodedPcm> get(const std::string& path);
+
+  // Changes the budget, evicting entries beyond it right away.
+  void set_budget(size_t budget_bytes);
+
+  Stats stats();
+
+ private:
+  struct Entry {
+    std::string key;
+    std::shared_ptr<const DecodedPcm> pcm;
+  };
+
+  static std::shared_ptr<const DecodedPcm> decode(const std::string& path, size_t max_bytes);
+
+  // Must be called with |mutex_| held.
+  void evict_locked();
+
+  std::mutex mutex_;
+  std::list<Entry> entries_;  // Most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+  Stats stats_;
+};
+
+#endif  // FLUTTER_PLUGIN_PCM_CACHE_H_
@@ -0,0 +1,177 @@
+#include "pcm_sink.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// How far underruns may deepen the buffer, and by how much each one does.
+constexpr int kMaxAdaptiveTargetMs = 200;
+constexpr int kTargetStepMs = 10;
+
+// After this long without an underrun the target comes down a step.
+constexpr int kRelaxAfterMs = 5000;
+
+// Length of the fades around silence and trims, short enough to keep the
+// speech and long enough to avoid a click.
+constexpr int kFadeMs = 5;
+
+// Room for bursts well beyond any target.
+constexpr int kCapacityMs = 2000;
+
+size_t ms_to_frames(int sample_rate, int ms) {
+  return (size_t)sample_rate * (size_t)std::max(ms, 0) / 1000;
+}
+
+}  // namespace
+
+PcmSink::PcmSink(int sample_rate, int channels, int target_ms, int max_latency_ms)
+    : sample_rate_(sample_rate),
+      channels_(channels),
+      min_target_frames_(std::max<size_t>(1, ms_to_frames(sample_rate, target_ms))),
+      max_target_frames_(
+          std::max(min_target_frames_, ms_to_frames(sample_rate, kMaxAdaptiveTargetMs))),
+      max_latency_frames_(max_latency_ms < 0 ? -1
+                                             : (int64_t)ms_to_frames(sample_rate, max_latency_ms)),
+      fade_frames_(std::max<size_t>(1, ms_to_frames(sample_rate, kFadeMs))),
+      ring_(std::max(ms_to_frames(sample_rate, kCapacityMs), 4 * max_target_frames_) *
+            (size_t)channels * sizeof(int16_t)),
+      target_frames_(min_target_frames_) {}
+
+size_t PcmSink::feed(const int16_t* samples, size_t frames) {
+  if (closed_.load(std::memory_order_relaxed)) {
+    return 0;
+  }
+  // Whole frames only, so the ring never holds part of one
+  const size_t free_frames = (ring_.capacity() - ring_.readable()) / frame_bytes();
+  const size_t accepted = std::min(frames, free_frames);
+  ring_.write(reinterpret_cast<const uint8_t*>(samples), accepted * frame_bytes());
+  fed_frames_.fetch_add(accepted, std::memory_order_relaxed);
+  if (accepted < frames) {
+    rejected_frames_.fetch_add(frames - accepted, std::memory_order_relaxed);
+  }
+  return accepted;
+}
+
+size_t PcmSink::feed_float(const float* samples, size_t frames) {
+  int16_t converted[4096];
+  const size_t chunk_frames = std::max<size_t>(1, sizeof(converted) / sizeof(int16_t) / channels_);
+  size_t done = 0;
+  while (done < frames) {
+    const size_t count = std::min(chunk_frames, frames - done);
+    const float* in = samples + done * channels_;
+    for (size_t i = 0; i < count * channels_; i++) {
+      const float value = std::max(-1.0f, std::min(1.0f, in[i]));
+      converted[i] = (int16_t)(value * 32767.0f);
+    }
+    const size_t accepted = feed(converted, count);
+    done += accepted;
+    if (accepted < count) {
+      // Count what did not fit, not just this chunk's share of it
+      rejected_frames_.fetch_add(frames - done - (count - accepted), std::memory_order_relaxed);
+      break;
+    }
+  }
+  return done;
+}
+
+void PcmSink::close() {
+  closed_.store(true, std::memory_order_release);
+}
+
+PcmSink::Stats PcmSink::stats() const {
+  Stats stats;
+  stats.fed_frames = fed_frames_.load(std::memory_order_relaxed);
+  stats.played_frames = played_frames_.load(std::memory_order_relaxed);
+  stats.underruns = underruns_.load(std::memory_order_relaxed);
+  stats.trimmed_frames = trimmed_frames_.load(std::memory_order_relaxed);
+  stats.rejected_frames = rejected_frames_.load(std::memory_order_relaxed);
+  stats.buffered_frames = ring_.readable() / frame_bytes();
+  stats.target_frames = target_frames_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+size_t PcmSink::read(uint8_t* out, size_t length) {
+  const size_t frame_bytes = this->frame_bytes();
+  const size_t wanted = length / frame_bytes;
+  const bool closed = closed_.load(std::memory_order_acquire);
+  const size_t target = target_frames_.load(std::memory_order_relaxed);
+  size_t buffered = ring_.readable() / frame_bytes;
+
+  if (!playing_) {
+    if (buffered < target && !(closed && buffered > 0)) {
+      // Silence until the buffer reaches the target depth
+      memset(out, 0, wanted * frame_bytes);
+      return wanted * frame_bytes;
+    }
+    playing_ = true;
+    fade_in_ = true;
+  }
+
+  // Drop the oldest frames once the buffer is far deeper than it needs to be
+  const int64_t limit = max_latency_frames_ < 0 ? (int64_t)(2 * target) : max_latency_frames_;
+  if (!closed && limit > 0 && buffered > (size_t)limit) {
+    const size_t keep = std::min(target, (size_t)limit);
+    trimmed_frames_.fetch_add(buffered - keep, std::memory_order_relaxed);
+    ring_.consume((buffered - keep) * frame_bytes);
+    buffered = keep;
+    fade_in_ = true;
+  }
+
+  const size_t frames = std::min(buffered, wanted);
+  ring_.read(out, frames * frame_bytes);
+  played_frames_.fetch_add(frames, std::memory_order_relaxed);
+  int16_t* samples = reinterpret_cast<int16_t*>(out);
+  if (fade_in_ && frames > 0) {
+    fade(samples, std::min(frames, fade_frames_), true);
+    fade_in_ = false;
+  }
+  if (closed) {
+    return frames * frame_bytes;
+  }
+
+  // Running dry: fade out what there is and refill before playing on. A
+  // period the buffer fills exactly is not an underrun.
+  const bool underrun = buffered < wanted;
+  if (underrun) {
+    const size_t fade_length = std::min(frames, fade_frames_);
+    fade(samples + (frames - fade_length) * channels_, fade_length, false);
+    memset(out + frames * frame_bytes, 0, (wanted - frames) * frame_bytes);
+    playing_ = false;
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+  }
+  adapt_target(wanted, underrun);
+  return wanted * frame_bytes;
+}
+
+bool PcmSink::at_end() const {
+  return closed_.load(std::memory_order_acquire) && ring_.readable() < frame_bytes();
+}
+
+void PcmSink::fade(int16_t* samples, size_t frames, bool in) {
+  for (size_t frame = 0; frame < frames; frame++) {
+    const float step = (float)(frame + 1) / (float)(frames + 1);
+    const float gain = in ? step : 1.0f - step;
+    for (int channel = 0; channel < channels_; channel++) {
+      int16_t& sample = samples[frame * channels_ + channel];
+      sample = (int16_t)(sample * gain);
+    }
+  }
+}
+
+void PcmSink::adapt_target(size_t period_frames, bool underrun) {
+  const size_t step = ms_to_frames(sample_rate_, kTargetStepMs);
+  size_t target = target_frames_.load(std::memory_order_relaxed);
+  if (underrun) {
+    target = std::min(max_target_frames_, target + step);
+    frames_since_underrun_ = 0;
+  } else {
+    frames_since_underrun_ += period_frames;
+    if (frames_since_underrun_ < ms_to_frames(sample_rate_, kRelaxAfterMs)) {
+      return;
+    }
+    target = std::max(min_target_frames_, target - std::min(target, step));
+    frames_since_underrun_ = 0;
+  }
+  target_frames_.store(target, std::memory_order_relaxed);
+}
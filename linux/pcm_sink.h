@@ -0,0 +1,93 @@
+#ifndef FLUTTER_PLUGIN_PCM_SINK_H_
+#define FLUTTER_PLUGIN_PCM_SINK_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "audio_source.h"
+#include "spsc_ring_buffer.h"
+
+// Plays PCM that arrives a piece at a time, such as a VoIP call or speech
+// being synthesized, through an adaptive jitter buffer.
+//
+// Output starts once the buffer holds the target depth. When it runs dry the
+// last frames are faded to silence and the buffer refills to the target
+// before playing on, rather than stuttering frame by frame; each underrun
+// deepens the target a step, and a long run without one brings it back
+// towards the depth asked for. When feeding outpaces playback, the oldest
+// frames beyond the latency bound (twice the target unless given) are
+// trimmed so latency cannot creep up.
+//
+// feed() and close() form the producer side and must be called from one
+// thread; the AudioSource methods are the consumer side. The two meet in a
+// lock-free ring.
+class PcmSink : public AudioSource {
+ public:
+  struct Stats {
+    uint64_t fed_frames = 0;
+    uint64_t played_frames = 0;
+    uint64_t underruns = 0;
+    uint64_t trimmed_frames = 0;   // Dropped to keep latency bounded
+    uint64_t rejected_frames = 0;  // Refused by feed() because the buffer was full
+    size_t buffered_frames = 0;
+    size_t target_frames = 0;
+  };
+
+  // |target_ms| is the smallest depth the buffer aims for. Buffered audio
+  // beyond |max_latency_ms| is trimmed: negative means twice the current
+  // target and zero never trims, for producers that run ahead of real time
+  // and hold back when feed() returns short.
+  PcmSink(int sample_rate, int channels, int target_ms, int max_latency_ms = -1);
+
+  PcmSink(const PcmSink&) = delete;
+  PcmSink& operator=(const PcmSink&) = delete;
+
+  // Producer side. Appends interleaved frames; returns how many fitted.
+  size_t feed(const int16_t* samples, size_t frames);
+  size_t feed_float(const float* samples, size_t frames);
+
+  // No more input: what is buffered plays out, then at_end() turns true.
+  void close();
+
+  // Safe from any thread.
+  Stats stats() const;
+
+  int sample_rate() const override { return sample_rate_; }
+  int channels() const override { return channels_; }
+  uint64_t frames() const override { return 0; }  // Unknown while live
+  size_t read(uint8_t* out, size_t length) override;
+  void seek(uint64_t frame) override {}
+  bool at_end() const override;
+  uint64_t position_frames() const override {
+    return played_frames_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  // Consumer side helpers.
+  void fade(int16_t* samples, size_t frames, bool in);
+  void adapt_target(size_t period_frames, bool underrun);
+
+  const int sample_rate_;
+  const int channels_;
+  const size_t min_target_frames_;
+  const size_t max_target_frames_;
+  const int64_t max_latency_frames_;  // -1: twice the target
+  const size_t fade_frames_;
+  SpscRingBuffer ring_;
+  std::atomic<bool> closed_{false};
+
+  // Consumer only
+  bool playing_ = false;
+  bool fade_in_ = false;  // The next frames follow silence or a trim
+  size_t frames_since_underrun_ = 0;
+
+  std::atomic<size_t> target_frames_;
+  std::atomic<uint64_t> fed_frames_{0};
+  std::atomic<uint64_t> played_frames_{0};
+  std::atomic<uint64_t> underruns_{0};
+  std::atomic<uint64_t> trimmed_frames_{0};
+  std::atomic<uint64_t> rejected_frames_{0};
+};
+
+#endif  // FLUTTER_PLUGIN_PCM_SINK_H_
@@ -0,0 +1,262 @@
+#include "sample_bank.h"
+
+#include <glib.h>
+#include <samplerate.h>
+#include <sndfile.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <vector>
+
+SampleBank::SampleBank(size_t budget_bytes) {
+  stats_.budget_bytes = budget_bytes;
+}
+
+uint32_t SampleBank::load(const std::string& path, int sample_rate) {
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return 0;
+  }
+  const std::string key = path + '\n' + std::to_string((long long)st.st_size) + '\n' +
+                          std::to_string((long long)st.st_mtim.tv_sec) + '.' +
+                          std::to_string((long long)st.st_mtim.tv_nsec) + '\n' +
+                          std::to_string(sample_rate);
+  size_t max_bytes;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = keys_.find(key);
+    if (it != keys_.end()) {
+      return it->second;
+    }
+    max_bytes = stats_.budget_bytes;
+  }
+
+  // Decode without the lock so triggers are not held up
+  std::shared_ptr<const DecodedPcm> pcm = decode(path, sample_rate, max_bytes);
+  if (!pcm) {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = keys_.find(key);
+  if (it != keys_.end()) {
+    // Another load decoded it meanwhile
+    return it->second;
+  }
+
+  const uint32_t id = next_id_;
+  next_id_ = next_id_ == UINT32_MAX ? 1 : next_id_ + 1;
+  entries_.push_front(Entry{id, key, pcm});
+  ids_[id] = entries_.begin();
+  keys_[key] = id;
+  stats_.loads++;
+  stats_.entries++;
+  stats_.bytes += pcm->bytes();
+  evict_locked();
+  // Rounding in the rate conversion can leave a sound just over the budget
+  return ids_.count(id) ? id : 0;
+}
+
+std::shared_ptr<const DecodedPcm> SampleBank::get(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ids_.find(id);
+  if (it == ids_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, it->second);
+  return it->second->pcm;
+}
+
+bool SampleBank::unload(uint32_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = ids_.find(id);
+  if (it == ids_.end()) {
+    return false;
+  }
+  erase_locked(it->second);
+  return true;
+}
+
+void SampleBank::set_budget(size_t budget_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stats_.budget_bytes = budget_bytes;
+  evict_locked();
+}
+
+SampleBank::Stats SampleBank::stats() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+namespace {
+
+// -3 dB, the ITU-R BS.775 weight of a centre or surround channel in stereo.
+constexpr float kDownmixWeight = 0.70710678f;
+
+// Weights of one source channel in the left and right outputs.
+struct StereoWeights {
+  float left;
+  float right;
+};
+
+// Fronts go to their own side, surrounds and other side channels to their
+// side at -3 dB, centres and unplaced channels to both at -3 dB. The
+// low-frequency channel is left out.
+StereoWeights downmix_weights(int position) {
+  switch (position) {
+    case SF_CHANNEL_MAP_LEFT:
+    case SF_CHANNEL_MAP_FRONT_LEFT:
+      return {1.0f, 0.0f};
+    case SF_CHANNEL_MAP_RIGHT:
+    case SF_CHANNEL_MAP_FRONT_RIGHT:
+      return {0.0f, 1.0f};
+    case SF_CHANNEL_MAP_FRONT_LEFT_OF_CENTER:
+    case SF_CHANNEL_MAP_REAR_LEFT:
+    case SF_CHANNEL_MAP_SIDE_LEFT:
+    case SF_CHANNEL_MAP_TOP_FRONT_LEFT:
+    case SF_CHANNEL_MAP_TOP_REAR_LEFT:
+      return {kDownmixWeight, 0.0f};
+    case SF_CHANNEL_MAP_FRONT_RIGHT_OF_CENTER:
+    case SF_CHANNEL_MAP_REAR_RIGHT:
+    case SF_CHANNEL_MAP_SIDE_RIGHT:
+    case SF_CHANNEL_MAP_TOP_FRONT_RIGHT:
+    case SF_CHANNEL_MAP_TOP_REAR_RIGHT:
+      return {0.0f, kDownmixWeight};
+    case SF_CHANNEL_MAP_LFE:
+      return {0.0f, 0.0f};
+    default:
+      return {kDownmixWeight, kDownmixWeight};
+  }
+}
+
+// Positions of the file's channels: its own map when it has one, otherwise
+// the WAVE default order (L R C LFE, back pair, side pair).
+std::vector<int> channel_positions(SNDFILE* sndfile, int channels) {
+  std::vector<int> positions((size_t)channels, SF_CHANNEL_MAP_INVALID);
+  if (sf_command(sndfile, SFC_GET_CHANNEL_MAP_INFO, positions.data(),
+                 (int)(positions.size() * sizeof(int))) == SF_TRUE) {
+    return positions;
+  }
+  static const int kWaveOrder[] = {
+      SF_CHANNEL_MAP_FRONT_LEFT, SF_CHANNEL_MAP_FRONT_RIGHT, SF_CHANNEL_MAP_FRONT_CENTER,
+      SF_CHANNEL_MAP_LFE,        SF_CHANNEL_MAP_REAR_LEFT,   SF_CHANNEL_MAP_REAR_RIGHT,
+      SF_CHANNEL_MAP_SIDE_LEFT,  SF_CHANNEL_MAP_SIDE_RIGHT,
+  };
+  for (size_t channel = 0; channel < positions.size() && channel < G_N_ELEMENTS(kWaveOrder);
+       channel++) {
+    positions[channel] = kWaveOrder[channel];
+  }
+  return positions;
+}
+
+// Folds |frames| frames of interleaved multichannel audio into stereo in
+// place. Each side is divided by the sum of its weights, so full-scale input
+// on every channel cannot clip.
+void downmix_to_stereo(float* samples, sf_count_t frames, const std::vector<int>& positions) {
+  const size_t channels = positions.size();
+  std::vector<StereoWeights> weights(channels);
+  float left_sum = 0.0f;
+  float right_sum = 0.0f;
+  for (size_t channel = 0; channel < channels; channel++) {
+    weights[channel] = downmix_weights(positions[channel]);
+    left_sum += weights[channel].left;
+    right_sum += weights[channel].right;
+  }
+  for (size_t channel = 0; channel < channels; channel++) {
+    weights[channel].left = left_sum > 0.0f ? weights[channel].left / left_sum : 0.0f;
+    weights[channel].right = right_sum > 0.0f ? weights[channel].right / right_sum : 0.0f;
+  }
+
+  // Frame i's output lands at or before its input, so in place is safe
+  for (sf_count_t frame = 0; frame < frames; frame++) {
+    const float* in = samples + frame * channels;
+    float left = 0.0f;
+    float right = 0.0f;
+    for (size_t channel = 0; channel < channels; channel++) {
+      left += in[channel] * weights[channel].left;
+      right += in[channel] * weights[channel].right;
+    }
+    samples[frame * 2] = left;
+    samples[frame * 2 + 1] = right;
+  }
+}
+
+}  // namespace
+
+// Decodes to float, downmixes more than two channels to stereo (all the
+// mixer plays) and converts to |sample_rate| with libsamplerate.
+std::shared_ptr<const DecodedPcm> SampleBank::decode(const std::string& path, int sample_rate,
+                                                     size_t max_bytes) {
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  SNDFILE* sndfile = sf_open(path.c_str(), SFM_READ, &info);
+  if (!sndfile) {
+    return nullptr;
+  }
+  const int channels = std::min(info.channels, 2);
+  const double ratio = info.samplerate > 0 ? (double)sample_rate / info.samplerate : 0.0;
+  const double bytes = (double)info.frames * ratio * channels * sizeof(int16_t);
+  if (info.samplerate <= 0 || info.channels <= 0 || info.frames <= 0 || bytes > max_bytes) {
+    sf_close(sndfile);
+    return nullptr;
+  }
+
+  std::vector<float> decoded((size_t)info.frames * (size_t)info.channels);
+  const sf_count_t frames = sf_readf_float(sndfile, decoded.data(), info.frames);
+  const std::vector<int> positions =
+      channels != info.channels ? channel_positions(sndfile, info.channels) : std::vector<int>();
+  sf_close(sndfile);
+  if (frames <= 0) {
+    return nullptr;
+  }
+
+  if (channels != info.channels) {
+    downmix_to_stereo(decoded.data(), frames, positions);
+  }
+  decoded.resize((size_t)frames * (size_t)channels);
+
+  if (info.samplerate != sample_rate) {
+    std::vector<float> converted(((size_t)(frames * ratio) + 1) * (size_t)channels);
+    SRC_DATA src_data;
+    memset(&src_data, 0, sizeof(src_data));
+    src_data.data_in = decoded.data();
+    src_data.input_frames = (long)frames;
+    src_data.data_out = converted.data();
+    src_data.output_frames = (long)(converted.size() / (size_t)channels);
+    src_data.src_ratio = ratio;
+    src_data.end_of_input = 1;
+    const int error = src_simple(&src_data, SRC_SINC_MEDIUM_QUALITY, channels);
+    if (error) {
+      g_printerr("Sample rate conversion error: %s\n", src_strerror(error));
+      return nullptr;
+    }
+    converted.resize((size_t)src_data.output_frames_gen * (size_t)channels);
+    decoded.swap(converted);
+  }
+
+  auto pcm = std::make_shared<DecodedPcm>();
+  pcm->sample_rate = sample_rate;
+  pcm->channels = channels;
+  pcm->samples.resize(decoded.size());
+  src_float_to_short_array(decoded.data(), pcm->samples.data(), (int)decoded.size());
+
+  g_print("Loaded %s into the sample bank (%zu bytes)\n", path.c_str(), pcm->bytes());
+  return pcm;
+}
+
+void SampleBank::erase_locked(std::list<Entry>::iterator entry) {
+  stats_.bytes -= entry->pcm->bytes();
+  stats_.entries--;
+  ids_.erase(entry->id);
+  keys_.erase(entry->key);
+  entries_.erase(entry);
+}
+
+void SampleBank::evict_locked() {
+  while (stats_.bytes > stats_.budget_bytes && !entries_.empty()) {
+    erase_locked(std::prev(entries_.end()));
+    stats_.evictions++;
+  }
+}
@@ -0,0 +1,78 @@
+#ifndef FLUTTER_PLUGIN_SAMPLE_BANK_H_
+#define FLUTTER_PLUGIN_SAMPLE_BANK_H_
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "pcm_cache.h"
+
+// Short sounds loaded ahead of time for triggering through the Mixer, such
+// as UI clicks and game effects.
+//
+// Each file is decoded once and converted to the mixer's output rate, so a
+// trigger is a lookup and a command push, and the voice plays the samples
+// as they are without resampling. The buffers are immutable and shared by
+// reference, so any number of voices can play one at once. Once the bank
+// exceeds its memory budget the least recently triggered sounds are
+// dropped; voices still playing one keep it alive until they finish, and
+// triggering an evicted id fails until it is loaded again. Safe to use from
+// several threads.
+class SampleBank {
+ public:
+  struct Stats {
+    uint64_t loads = 0;  // Files decoded
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    size_t bytes = 0;
+    size_t budget_bytes = 0;
+  };
+
+  explicit SampleBank(size_t budget_bytes);
+
+  SampleBank(const SampleBank&) = delete;
+  SampleBank& operator=(const SampleBank&) = delete;
+
+  // Decodes |path| at |sample_rate| and returns its id, or the id it already
+  // has. Sounds are keyed by path, size and modification time, so a file
+  // that changes on disk is decoded afresh under a new id. Returns 0 for
+  // files libsndfile cannot read and for sounds larger than the budget.
+  // Slow; call from a worker.
+  uint32_t load(const std::string& path, int sample_rate);
+
+  // The sound loaded as |id|, or nullptr once it is unloaded or evicted.
+  std::shared_ptr<const DecodedPcm> get(uint32_t id);
+
+  bool unload(uint32_t id);
+
+  // Changes the budget, evicting sounds beyond it right away.
+  void set_budget(size_t budget_bytes);
+
+  Stats stats();
+
+ private:
+  struct Entry {
+    uint32_t id;
+    std::string key;
+    std::shared_ptr<const DecodedPcm> pcm;
+  };
+
+  static std::shared_ptr<const DecodedPcm> decode(const std::string& path, int sample_rate,
+                                                  size_t max_bytes);
+
+  // Must be called with |mutex_| held.
+  void erase_locked(std::list<Entry>::iterator entry);
+  void evict_locked();
+
+  std::mutex mutex_;
+  std::list<Entry> entries_;  // Most recently triggered first
+  std::unordered_map<uint32_t, std::list<Entry>::iterator> ids_;
+  std::unordered_map<std::string, uint32_t> keys_;
+  uint32_t next_id_ = 1;
+  Stats stats_;
+};
+
+#endif  // FLUTTER_PLUGIN_SAMPLE_BANK_H_
@@ -0,0 +1,111 @@
+#ifndef FLUTTER_PLUGIN_SPSC_RING_BUFFER_H_
+#define FLUTTER_PLUGIN_SPSC_RING_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Lock-free single-producer/single-consumer byte ring.
+//
+// Read and write indices are free-running 64-bit byte counters; the byte for
+// index i lives at data()[i & (capacity() - 1)]. The producer publishes the
+// write index with release semantics after copying, and the consumer
+// publishes the read index after it has finished with the bytes, so the
+// consumer may read the storage in place without copying it out.
+//
+// The producer never overwrites unread data: when the ring is full the bytes
+// that do not fit are dropped and counted as an overrun.
+class SpscRingBuffer {
+ public:
+  // |capacity| is rounded up to a power of two.
+  explicit SpscRingBuffer(size_t capacity)
+      : capacity_(round_up_pow2(capacity)),
+        data_(new uint8_t[capacity_]()) {}
+
+  SpscRingBuffer(const SpscRingBuffer&) = delete;
+  SpscRingBuffer& operator=(const SpscRingBuffer&) = delete;
+
+  uint8_t* data() { return data_.get(); }
+  size_t capacity() const { return capacity_; }
+
+  // Producer side. Returns the number of bytes accepted.
+  size_t write(const uint8_t* src, size_t length) {
+    const uint64_t write_pos = write_.value.load(std::memory_order_relaxed);
+    const uint64_t read_pos = read_.value.load(std::memory_order_acquire);
+    const size_t free_bytes = capacity_ - (size_t)(write_pos - read_pos);
+
+    size_t accepted = length < free_bytes ? length : free_bytes;
+    if (accepted < length) {
+      overrun_bytes_.fetch_add(length - accepted, std::memory_order_relaxed);
+      overrun_count_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (accepted == 0) {
+      return 0;
+    }
+
+    const size_t offset = (size_t)(write_pos & (capacity_ - 1));
+    const size_t first = accepted < capacity_ - offset ? accepted : capacity_ - offset;
+    std::memcpy(data_.get() + offset, src, first);
+    std::memcpy(data_.get(), src + first, accepted - first);
+
+    write_.value.store(write_pos + accepted, std::memory_order_release);
+    return accepted;
+  }
+
+  // Consumer side. Bytes in [read_index(), write_index()) may be read in
+  // place until they are released with consume().
+  size_t readable() const {
+    return (size_t)(write_.value.load(std::memory_order_acquire) -
+                    read_.value.load(std::memory_order_relaxed));
+  }
+
+  void consume(size_t bytes) {
+    const uint64_t read_pos = read_.value.load(std::memory_order_relaxed);
+    const size_t available = readable();
+    read_.value.store(read_pos + (bytes < available ? bytes : available), std::memory_order_release);
+  }
+
+  // Copies up to |max_length| bytes out of the ring and consumes them.
+  size_t read(uint8_t* dst, size_t max_length) {
+    const size_t available = readable();
+    const size_t length = max_length < available ? max_length : available;
+    const size_t offset = (size_t)(read_.value.load(std::memory_order_relaxed) & (capacity_ - 1));
+    const size_t first = length < capacity_ - offset ? length : capacity_ - offset;
+    std::memcpy(dst, data_.get() + offset, first);
+    std::memcpy(dst + first, data_.get(), length - first);
+    consume(length);
+    return length;
+  }
+
+  uint64_t write_index() const { return write_.value.load(std::memory_order_acquire); }
+  uint64_t read_index() const { return read_.value.load(std::memory_order_acquire); }
+  uint64_t overrun_bytes() const { return overrun_bytes_.load(std::memory_order_relaxed); }
+  uint64_t overrun_count() const { return overrun_count_.load(std::memory_order_relaxed); }
+
+ private:
+  static size_t round_up_pow2(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+      result <<= 1;
+    }
+    return result;
+  }
+
+  const size_t capacity_;
+  std::unique_ptr<uint8_t[]> data_;
+
+  // The indices are written by different threads; padding keeps them on
+  // separate cache lines so the producer and consumer do not contend.
+  struct PaddedIndex {
+    std::atomic<uint64_t> value{0};
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+  };
+  PaddedIndex write_;
+  PaddedIndex read_;
+
+  std::atomic<uint64_t> overrun_bytes_{0};
+  std::atomic<uint64_t> overrun_count_{0};
+};
+
+#endif  // FLUTTER_PLUGIN_SPSC_RING_BUFFER_H_
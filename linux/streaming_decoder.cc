@@ -0,0 +1,237 @@
+#include "streaming_decoder.h"
+
+#include <glib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Frames decoded per libsndfile call.
+constexpr sf_count_t kChunkFrames = 4096;
+
+// How long the decoder sleeps when the ring is full or the file has ended.
+// Seeks and shutdown wake it early.
+constexpr auto kRefillInterval = std::chrono::milliseconds(10);
+
+}  // namespace
+
+// Cursor over a DecoderInput for libsndfile's virtual I/O callbacks.
+struct StreamingDecoder::VirtualFile {
+  std::shared_ptr<DecoderInput> input;
+  sf_count_t position = 0;
+
+  static sf_count_t get_filelen(void* user_data) {
+    return static_cast<VirtualFile*>(user_data)->input->length();
+  }
+
+  static sf_count_t seek(sf_count_t offset, int whence, void* user_data) {
+    auto* file = static_cast<VirtualFile*>(user_data);
+    switch (whence) {
+      case SEEK_SET:
+        file->position = offset;
+        break;
+      case SEEK_CUR:
+        file->position += offset;
+        break;
+      case SEEK_END: {
+        const int64_t length = file->input->length();
+        if (length < 0) {
+          return -1;  // Unknown until the end arrives
+        }
+        file->position = length + offset;
+        break;
+      }
+    }
+    return file->position;
+  }
+
+  static sf_count_t read(void* out, sf_count_t count, void* user_data) {
+    auto* file = static_cast<VirtualFile*>(user_data);
+    sf_count_t length = file->input->read(out, file->position, count);
+    file->position += length;
+    return length;
+  }
+
+  static sf_count_t write(const void*, sf_count_t, void*) { return 0; }
+
+  static sf_count_t tell(void* user_data) {
+    return static_cast<VirtualFile*>(user_data)->position;
+  }
+};
+
+std::unique_ptr<StreamingDecoder> StreamingDecoder::open_file(const std::string& path,
+                                                              int buffer_ms) {
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+
+  SNDFILE* sndfile = sf_open(path.c_str(), SFM_READ, &info);
+  if (!sndfile) {
+    g_printerr("Failed to open audio file: %s\n", path.c_str());
+    return nullptr;
+  }
+  return create(sndfile, info, buffer_ms, path.c_str(), nullptr);
+}
+
+std::unique_ptr<StreamingDecoder> StreamingDecoder::open_virtual(
+    std::shared_ptr<DecoderInput> input, int buffer_ms, const SF_INFO* raw_format) {
+  static SF_VIRTUAL_IO io = {VirtualFile::get_filelen, VirtualFile::seek, VirtualFile::read,
+                             VirtualFile::write, VirtualFile::tell};
+
+  std::unique_ptr<VirtualFile> virtual_file(new VirtualFile());
+  virtual_file->input = std::move(input);
+
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  if (raw_format) {
+    info = *raw_format;
+  }
+
+  SNDFILE* sndfile = sf_open_virtual(&io, SFM_READ, &info, virtual_file.get());
+  if (!sndfile) {
+    g_printerr("Failed to open audio stream: %s\n", sf_strerror(nullptr));
+    return nullptr;
+  }
+  return create(sndfile, info, buffer_ms, "stream", std::move(virtual_file));
+}
+
+std::unique_ptr<StreamingDecoder> StreamingDecoder::create(
+    SNDFILE* sndfile, const SF_INFO& info, int buffer_ms, const char* description,
+    std::unique_ptr<VirtualFile> virtual_file) {
+  if (info.samplerate <= 0 || info.channels <= 0) {
+    g_printerr("Unsupported audio format: %s\n", description);
+    sf_close(sndfile);
+    return nullptr;
+  }
+
+  const size_t frame_bytes = (size_t)info.channels * sizeof(int16_t);
+  const size_t buffer_frames = (size_t)info.samplerate * buffer_ms / 1000;
+  const size_t ring_bytes = std::max<size_t>(buffer_frames, 2 * kChunkFrames) * frame_bytes;
+
+  g_print("Streaming audio: %d Hz, %d channels, %zu frames\n", info.samplerate, info.channels,
+          (size_t)info.frames);
+  return std::unique_ptr<StreamingDecoder>(
+      new StreamingDecoder(sndfile, info, ring_bytes, std::move(virtual_file)));
+}
+
+StreamingDecoder::StreamingDecoder(SNDFILE* sndfile, const SF_INFO& info, size_t ring_bytes,
+                                   std::unique_ptr<VirtualFile> virtual_file)
+    : sndfile_(sndfile), info_(info), virtual_file_(std::move(virtual_file)), ring_(ring_bytes) {
+  thread_ = std::thread(&StreamingDecoder::run, this);
+}
+
+StreamingDecoder::~StreamingDecoder() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+  }
+  wake_.notify_all();
+  if (virtual_file_) {
+    // Unblock a decode waiting for input
+    virtual_file_->input->interrupt();
+  }
+  thread_.join();
+  sf_close(sndfile_);
+}
+
+void StreamingDecoder::run() {
+  const size_t bytes_per_frame = frame_bytes();
+  std::vector<int16_t> chunk((size_t)kChunkFrames * info_.channels);
+  const uint8_t* chunk_bytes = reinterpret_cast<const uint8_t*>(chunk.data());
+  size_t offset = 0;   // First byte of |chunk| not yet in the ring
+  size_t pending = 0;  // Bytes of |chunk| not yet in the ring
+  uint32_t generation = 0;
+
+  while (!quit_) {
+    const uint32_t requested = seek_generation_.load(std::memory_order_acquire);
+    if (requested != generation) {
+      generation = requested;
+      sf_seek(sndfile_, (sf_count_t)seek_frame_.load(std::memory_order_relaxed), SEEK_SET);
+      offset = 0;
+      pending = 0;
+      end_of_file_.store(false, std::memory_order_relaxed);
+      fresh_write_index_.store(ring_.write_index(), std::memory_order_relaxed);
+      decoded_generation_.store(generation, std::memory_order_release);
+    }
+
+    if (pending == 0 && !end_of_file_.load(std::memory_order_relaxed)) {
+      sf_count_t frames = sf_readf_short(sndfile_, chunk.data(), kChunkFrames);
+      if (frames > 0) {
+        offset = 0;
+        pending = (size_t)frames * bytes_per_frame;
+      } else {
+        end_of_file_.store(true, std::memory_order_release);
+      }
+    }
+
+    if (pending > 0) {
+      const size_t free_bytes =
+          ring_.capacity() - (size_t)(ring_.write_index() - ring_.read_index());
+      const size_t length = pending < free_bytes ? pending : free_bytes;
+      if (length > 0) {
+        ring_.write(chunk_bytes + offset, length);
+        offset += length;
+        pending -= length;
+        continue;
+      }
+    }
+
+    // Ring full or file finished: wait for the consumer, a seek or shutdown
+    std::unique_lock<std::mutex> lock(mutex_);
+    wake_.wait_for(lock, kRefillInterval, [this, generation]() {
+      return quit_.load() || seek_generation_.load(std::memory_order_acquire) != generation;
+    });
+  }
+}
+
+bool StreamingDecoder::skip_stale() {
+  if (decoded_generation_.load(std::memory_order_acquire) !=
+      seek_generation_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  const uint64_t fresh = fresh_write_index_.load(std::memory_order_relaxed);
+  const uint64_t read_index = ring_.read_index();
+  if (read_index < fresh) {
+    ring_.consume((size_t)(fresh - read_index));
+  }
+  return true;
+}
+
+size_t StreamingDecoder::read(uint8_t* out, size_t length) {
+  if (!skip_stale()) {
+    return 0;
+  }
+  size_t available = ring_.readable();
+  if (length > available) {
+    length = available;
+  }
+  length -= length % frame_bytes();
+  ring_.read(out, length);
+  position_frames_ += length / frame_bytes();
+  return length;
+}
+
+void StreamingDecoder::seek(uint64_t frame) {
+  if (frame > frames()) {
+    frame = frames();
+  }
+  seek_frame_.store(frame, std::memory_order_relaxed);
+  seek_generation_.fetch_add(1, std::memory_order_release);
+  position_frames_ = frame;
+  // Not taking the mutex here keeps the audio thread from blocking; a missed
+  // wakeup only delays the seek by one refill interval.
+  wake_.notify_one();
+}
+
+bool StreamingDecoder::at_end() const {
+  if (decoded_generation_.load(std::memory_order_acquire) !=
+          seek_generation_.load(std::memory_order_relaxed) ||
+      !end_of_file_.load(std::memory_order_acquire)) {
+    return false;
+  }
+  const uint64_t fresh = fresh_write_index_.load(std::memory_order_relaxed);
+  const uint64_t read_index = ring_.read_index();
+  return ring_.write_index() <= (read_index > fresh ? read_index : fresh);
+}
@@ -0,0 +1,123 @@
+#ifndef FLUTTER_PLUGIN_STREAMING_DECODER_H_
+#define FLUTTER_PLUGIN_STREAMING_DECODER_H_
+
+#include <sndfile.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_source.h"
+#include "spsc_ring_buffer.h"
+
+// Random-access bytes behind StreamingDecoder::open_virtual(). Reads may
+// block until the data arrives; interrupt() makes blocked and later reads
+// return early so the decoder can shut down.
+class DecoderInput {
+ public:
+  virtual ~DecoderInput() = default;
+
+  // Total size in bytes, or -1 while it is unknown.
+  virtual int64_t length() = 0;
+
+  // Copies up to |count| bytes starting at |offset| and returns how many were
+  // copied; fewer than |count| only at the end of the input or once
+  // interrupted.
+  virtual int64_t read(void* out, int64_t offset, int64_t count) = 0;
+
+  virtual void interrupt() = 0;
+};
+
+// Decodes a libsndfile stream to interleaved s16 on its own thread, a chunk
+// at a time, into a bounded ring that the audio thread drains. Memory is
+// bounded by the ring, and playback can start as soon as the first chunk is
+// decoded, however long the file is.
+//
+// read(), seek(), at_end() and position_frames() form the consumer side and
+// must be called from one thread at a time (the audio thread, or another
+// thread holding the backend lock).
+class StreamingDecoder : public AudioSource {
+ public:
+  // Opens |path| and starts decoding. Returns nullptr if libsndfile cannot
+  // read the file.
+  static std::unique_ptr<StreamingDecoder> open_file(const std::string& path,
+                                                     int buffer_ms);
+
+  // Opens |input| through libsndfile's virtual I/O. Parsing the header reads
+  // from |input|, so this blocks until enough of it is available. Headerless
+  // input needs |raw_format|: an SF_FORMAT_RAW format with its sample rate
+  // and channels.
+  static std::unique_ptr<StreamingDecoder> open_virtual(std::shared_ptr<DecoderInput> input,
+                                                        int buffer_ms,
+                                                        const SF_INFO* raw_format = nullptr);
+
+  ~StreamingDecoder() override;
+
+  StreamingDecoder(const StreamingDecoder&) = delete;
+  StreamingDecoder& operator=(const StreamingDecoder&) = delete;
+
+  int sample_rate() const override { return info_.samplerate; }
+  int channels() const override { return info_.channels; }
+
+  // Total length in frames as reported by the file header.
+  uint64_t frames() const override { return (uint64_t)info_.frames; }
+
+  size_t read(uint8_t* out, size_t length) override;
+
+  // Restarts decoding at |frame|. Until the decoder catches up read() returns
+  // nothing, so the stale audio in the ring is never played.
+  void seek(uint64_t frame) override;
+
+  bool at_end() const override;
+
+  uint64_t position_frames() const override { return position_frames_; }
+
+  // Decoded frames waiting in the ring, and whether decoding has reached the
+  // end of the input. Used to pre-buffer before playback starts.
+  size_t buffered_frames() const { return ring_.readable() / frame_bytes(); }
+  bool fully_decoded() const { return end_of_file_.load(std::memory_order_acquire); }
+
+ private:
+  struct VirtualFile;
+
+  StreamingDecoder(SNDFILE* sndfile, const SF_INFO& info, size_t ring_bytes,
+                   std::unique_ptr<VirtualFile> virtual_file);
+
+  static std::unique_ptr<StreamingDecoder> create(SNDFILE* sndfile, const SF_INFO& info,
+                                                  int buffer_ms, const char* description,
+                                                  std::unique_ptr<VirtualFile> virtual_file);
+
+  void run();
+
+  // Drops ring contents written before the last acknowledged seek. Returns
+  // false while a seek is still pending.
+  bool skip_stale();
+
+  SNDFILE* sndfile_;
+  const SF_INFO info_;
+  std::unique_ptr<VirtualFile> virtual_file_;  // Set by open_virtual()
+  SpscRingBuffer ring_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::atomic<bool> quit_{false};
+
+  // Seek hand-off. The consumer publishes seek_frame_ and then bumps
+  // seek_generation_; the decoder seeks, records where fresh data starts in
+  // the ring and then acknowledges the generation.
+  std::atomic<uint64_t> seek_frame_{0};
+  std::atomic<uint32_t> seek_generation_{0};
+  std::atomic<uint32_t> decoded_generation_{0};
+  std::atomic<uint64_t> fresh_write_index_{0};
+  std::atomic<bool> end_of_file_{false};
+
+  uint64_t position_frames_ = 0;  // Consumer only
+};
+
+#endif  // FLUTTER_PLUGIN_STREAMING_DECODER_H_
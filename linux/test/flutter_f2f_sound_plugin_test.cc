@@ -1,9 +1,38 @@
 #include <flutter_linux/flutter_linux.h>
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "audio_backend.h"
+#include "audio_cache.h"
 #include "include/flutter_f2f_sound/flutter_f2f_sound_plugin.h"
 #include "flutter_f2f_sound_plugin_private.h"
+#include "http_stream.h"
+#include "mapped_wav_source.h"
+#include "memory_input.h"
+#include "mixer.h"
+#include "pcm_cache.h"
+#include "pcm_sink.h"
+#include "riff_parser.h"
+#include "sample_bank.h"
+#include "spsc_ring_buffer.h"
+#include "streaming_decoder.h"
+#include "worker_pool.h"
 
 // This demonstrates a simple unit test of the C portion of this plugin's
 // implementation.
@@ -16,6 +45,325 @@
 namespace flutter_f2f_sound {
 namespace test {
 
+namespace {
+
+// Counts |value| and every FlValue reachable from it. Each one is a separate
+// heap allocation made by the embedder.
+size_t count_fl_values(FlValue* value) {
+  size_t count = 1;
+  if (fl_value_get_type(value) == FL_VALUE_TYPE_LIST) {
+    for (size_t i = 0; i < fl_value_get_length(value); i++) {
+      count += count_fl_values(fl_value_get_list_value(value, i));
+    }
+  } else if (fl_value_get_type(value) == FL_VALUE_TYPE_MAP) {
+    for (size_t i = 0; i < fl_value_get_length(value); i++) {
+      count += count_fl_values(fl_value_get_map_key(value, i));
+      count += count_fl_values(fl_value_get_map_value(value, i));
+    }
+  }
+  return count;
+}
+
+// Builds a data event the way the plugin did before typed lists were used:
+// a map holding one int FlValue per PCM byte.
+FlValue* legacy_audio_data_value_new(const uint8_t* data, size_t length) {
+  FlValue* list = fl_value_new_list();
+  for (size_t i = 0; i < length; i++) {
+    fl_value_append_take(list, fl_value_new_int(data[i]));
+  }
+  FlValue* event = fl_value_new_map();
+  fl_value_set_string_take(event, "event", fl_value_new_string("data"));
+  fl_value_set_string_take(event, "data", list);
+  return event;
+}
+
+void collect_packet(const uint8_t* data, size_t length, gpointer user_data) {
+  auto* packets = static_cast<std::vector<std::vector<uint8_t>>*>(user_data);
+  packets->emplace_back(data, data + length);
+}
+
+// Writes a 8 kHz stereo WAV whose left sample in frame i is i & 0x7fff and
+// whose right sample is its negation.
+bool write_test_wav(const std::string& path, sf_count_t frames) {
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  info.samplerate = 8000;
+  info.channels = 2;
+  info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  SNDFILE* sndfile = sf_open(path.c_str(), SFM_WRITE, &info);
+  if (!sndfile) {
+    return false;
+  }
+  std::vector<int16_t> samples(frames * 2);
+  for (sf_count_t i = 0; i < frames; i++) {
+    samples[i * 2] = static_cast<int16_t>(i & 0x7fff);
+    samples[i * 2 + 1] = static_cast<int16_t>(-(i & 0x7fff));
+  }
+  bool written = sf_writef_short(sndfile, samples.data(), frames) == frames;
+  sf_close(sndfile);
+  return written;
+}
+
+// Reads |count| frames of a write_test_wav() file from |decoder|, waiting out
+// underruns, and checks they start at frame |first|.
+bool read_test_frames(StreamingDecoder* decoder, sf_count_t first, sf_count_t count) {
+  int16_t chunk[2 * 333];
+  bool in_order = true;
+  for (sf_count_t frame = first; frame < first + count;) {
+    size_t length = decoder->read(reinterpret_cast<uint8_t*>(chunk), sizeof(chunk));
+    if (length == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < length / 4 && frame < first + count; i++, frame++) {
+      in_order &= chunk[i * 2] == static_cast<int16_t>(frame & 0x7fff) &&
+                  chunk[i * 2 + 1] == static_cast<int16_t>(-(frame & 0x7fff));
+    }
+  }
+  return in_order;
+}
+
+// Little-endian writers for building RIFF files in memory.
+void append_le(std::vector<uint8_t>* out, uint64_t value, size_t bytes) {
+  for (size_t i = 0; i < bytes; i++) {
+    out->push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void append_chunk_header(std::vector<uint8_t>* out, const char* id, uint32_t size) {
+  out->insert(out->end(), id, id + 4);
+  append_le(out, size, 4);
+}
+
+// Appends a WAVE_FORMAT_EXTENSIBLE fmt chunk for |sub_format| (1 = PCM,
+// 3 = float).
+void append_extensible_format(std::vector<uint8_t>* out, uint16_t sub_format, uint16_t channels,
+                              uint32_t sample_rate, uint16_t bits) {
+  static const uint8_t kGuidTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                        0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+  const uint16_t block_align = static_cast<uint16_t>(channels * bits / 8);
+  append_chunk_header(out, "fmt ", 40);
+  append_le(out, 0xFFFE, 2);
+  append_le(out, channels, 2);
+  append_le(out, sample_rate, 4);
+  append_le(out, sample_rate * block_align, 4);
+  append_le(out, block_align, 2);
+  append_le(out, bits, 2);
+  append_le(out, 22, 2);    // cbSize
+  append_le(out, bits, 2);  // wValidBitsPerSample
+  append_le(out, 3, 4);     // Front left and right
+  append_le(out, sub_format, 2);
+  out->insert(out->end(), kGuidTail, kGuidTail + sizeof(kGuidTail));
+}
+
+// Reads a byte vector for RiffParser, counting the bytes it asks for.
+RiffParser::ReadFunction memory_reader(const std::vector<uint8_t>& data, size_t* bytes_read) {
+  return [&data, bytes_read](uint64_t offset, void* out, size_t count) -> size_t {
+    const size_t length =
+        offset < data.size() ? std::min<size_t>(count, data.size() - (size_t)offset) : 0;
+    memcpy(out, data.data() + offset, length);
+    *bytes_read += length;
+    return length;
+  };
+}
+
+// A body whose bytes differ from block to block, so a byte stored at the
+// wrong offset shows.
+std::vector<uint8_t> http_test_body(size_t length) {
+  std::vector<uint8_t> body(length);
+  for (size_t i = 0; i < length; i++) {
+    body[i] = (uint8_t)(i * 7 + i / 251);
+  }
+  return body;
+}
+
+// Serves one body over HTTP/1.1 on a loopback port, at about 16 MB/s per
+// connection so a test can act while a transfer is still running. Answers a
+// Range request with 206 unless told to ignore ranges, and records where
+// each request asked to start (-1 without a Range header).
+class LoopbackHttpServer {
+ public:
+  // With |cut_first_response_at| set, the first response drops the
+  // connection after that many body bytes.
+  LoopbackHttpServer(std::vector<uint8_t> body, bool honour_ranges, bool advertise_ranges,
+                     int64_t cut_first_response_at = -1)
+      : body_(std::move(body)),
+        honour_ranges_(honour_ranges),
+        advertise_ranges_(advertise_ranges),
+        cut_first_response_at_(cut_first_response_at) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    listen(listen_fd_, 16);
+    getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+    accept_thread_ = std::thread(&LoopbackHttpServer::accept_loop, this);
+  }
+
+  ~LoopbackHttpServer() {
+    stopping_ = true;
+    shutdown(listen_fd_, SHUT_RDWR);
+    accept_thread_.join();
+    close(listen_fd_);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      for (int fd : connections_) {
+        shutdown(fd, SHUT_RDWR);
+      }
+    }
+    for (std::thread& thread : connection_threads_) {
+      thread.join();
+    }
+  }
+
+  std::string url() const { return "http://127.0.0.1:" + std::to_string(port_) + "/audio"; }
+
+  std::vector<int64_t> range_starts() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return range_starts_;
+  }
+
+ private:
+  void accept_loop() {
+    while (!stopping_) {
+      const int fd = accept(listen_fd_, nullptr, nullptr);
+      if (fd < 0) {
+        return;
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      connections_.push_back(fd);
+      connection_threads_.emplace_back(&LoopbackHttpServer::serve, this, fd);
+    }
+  }
+
+  // Answers requests on one keep-alive connection until the client closes
+  // it or stops reading.
+  void serve(int fd) {
+    std::string request;
+    char buffer[4096];
+    while (!stopping_) {
+      const size_t header_end = request.find("\r\n\r\n");
+      if (header_end == std::string::npos) {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+        if (received <= 0) {
+          break;
+        }
+        request.append(buffer, (size_t)received);
+        continue;
+      }
+      const std::string headers = request.substr(0, header_end);
+      request.erase(0, header_end + 4);
+      if (!respond(fd, headers)) {
+        break;
+      }
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.erase(std::find(connections_.begin(), connections_.end(), fd));
+    close(fd);
+  }
+
+  bool respond(int fd, const std::string& headers) {
+    int64_t start = -1;
+    int64_t end = (int64_t)body_.size() - 1;
+    const size_t range = headers.find("Range: bytes=");
+    if (range != std::string::npos) {
+      const char* spec = headers.c_str() + range + strlen("Range: bytes=");
+      char* dash = nullptr;
+      start = strtoll(spec, &dash, 10);
+      if (dash[1] >= '0' && dash[1] <= '9') {
+        end = strtoll(dash + 1, nullptr, 10);
+      }
+    }
+    bool cut;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      range_starts_.push_back(start);
+      cut = cut_first_response_at_ >= 0 && range_starts_.size() == 1;
+    }
+
+    const bool ranged = start >= 0 && honour_ranges_;
+    const int64_t first = ranged ? start : 0;
+    const int64_t last = ranged ? end : (int64_t)body_.size() - 1;
+    std::string response = ranged ? "HTTP/1.1 206 Partial Content\r\n" : "HTTP/1.1 200 OK\r\n";
+    if (ranged) {
+      response += "Content-Range: bytes " + std::to_string(first) + "-" + std::to_string(last) +
+                  "/" + std::to_string(body_.size()) + "\r\n";
+    }
+    if (advertise_ranges_) {
+      response += "Accept-Ranges: bytes\r\n";
+    }
+    response += "Content-Length: " + std::to_string(last - first + 1) + "\r\n\r\n";
+    if (send(fd, response.data(), response.size(), MSG_NOSIGNAL) < 0) {
+      return false;
+    }
+
+    constexpr int64_t kChunkBytes = 32 * 1024;
+    const int64_t sent_last = cut ? std::min(last, first + cut_first_response_at_ - 1) : last;
+    for (int64_t offset = first; offset <= sent_last && !stopping_; offset += kChunkBytes) {
+      const size_t length = (size_t)std::min(kChunkBytes, sent_last - offset + 1);
+      if (send(fd, body_.data() + offset, length, MSG_NOSIGNAL) != (ssize_t)length) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    return !stopping_ && !cut;
+  }
+
+  const std::vector<uint8_t> body_;
+  const bool honour_ranges_;
+  const bool advertise_ranges_;
+  const int64_t cut_first_response_at_;
+  int listen_fd_ = -1;
+  int port_ = 0;
+  std::atomic<bool> stopping_{false};
+  std::thread accept_thread_;
+
+  std::mutex mutex_;
+  std::vector<int> connections_;
+  std::vector<std::thread> connection_threads_;
+  std::vector<int64_t> range_starts_;
+};
+
+// Collects the body an HttpStream hands its completion callback.
+class CompletedBody {
+ public:
+  HttpStream::CompletionCallback callback() {
+    return [this](HttpStream& stream) {
+      FILE* file = tmpfile();
+      std::vector<uint8_t> body;
+      if (file && stream.write_to(file)) {
+        body.resize((size_t)ftell(file));
+        rewind(file);
+        body.resize(fread(body.data(), 1, body.size(), file));
+      }
+      if (file) {
+        fclose(file);
+      }
+      std::lock_guard<std::mutex> lock(mutex_);
+      body_ = std::move(body);
+      complete_ = true;
+      completed_.notify_all();
+    };
+  }
+
+  // Waits up to 30 seconds for the callback and returns what it wrote.
+  std::vector<uint8_t> wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    completed_.wait_for(lock, std::chrono::seconds(30), [this]() { return complete_; });
+    return body_;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable completed_;
+  bool complete_ = false;
+  std::vector<uint8_t> body_;
+};
+
+}  // namespace
+
 TEST(FlutterF2fSoundPlugin, GetPlatformVersion) {
   g_autoptr(FlMethodResponse) response = get_platform_version();
   ASSERT_NE(response, nullptr);
@@ -27,5 +375,993 @@ TEST(FlutterF2fSoundPlugin, GetPlatformVersion) {
   EXPECT_THAT(fl_value_get_string(result), testing::StartsWith("Linux "));
 }
 
+// Encodes one second of 44.1 kHz stereo s16 capture, delivered in 10 ms
+// fragments, with the legacy per-byte encoding and with typed lists, and
+// reports the FlValue allocations each one costs per second of audio.
+TEST(FlutterF2fSoundPlugin, AudioDataEventAllocationsPerSecond) {
+  constexpr size_t kBytesPerSecond = 44100 * 2 * sizeof(int16_t);
+  constexpr size_t kFragmentsPerSecond = 100;
+  const std::vector<uint8_t> fragment(kBytesPerSecond / kFragmentsPerSecond, 0x5a);
+
+  size_t legacy_values = 0;
+  auto legacy_start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kFragmentsPerSecond; i++) {
+    g_autoptr(FlValue) event =
+        legacy_audio_data_value_new(fragment.data(), fragment.size());
+    legacy_values += count_fl_values(event);
+  }
+  std::chrono::duration<double, std::milli> legacy_ms =
+      std::chrono::steady_clock::now() - legacy_start;
+
+  size_t typed_values = 0;
+  auto typed_start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < kFragmentsPerSecond; i++) {
+    g_autoptr(FlValue) event = audio_data_value_new(fragment.data(), fragment.size());
+    ASSERT_EQ(fl_value_get_type(event), FL_VALUE_TYPE_UINT8_LIST);
+    ASSERT_EQ(fl_value_get_length(event), fragment.size());
+    typed_values += count_fl_values(event);
+  }
+  std::chrono::duration<double, std::milli> typed_ms =
+      std::chrono::steady_clock::now() - typed_start;
+
+  printf("[ BENCHMARK] per second of audio: legacy %zu FlValues (%.2f ms), "
+         "typed %zu FlValues (%.2f ms)\n",
+         legacy_values, legacy_ms.count(), typed_values, typed_ms.count());
+
+  EXPECT_GT(legacy_values, kBytesPerSecond);
+  EXPECT_EQ(typed_values, kFragmentsPerSecond);
+}
+
+TEST(FlutterF2fSoundPlugin, Pcm16ToFloat32) {
+  const int16_t input[] = {0, 16384, -16384, 32767, -32768};
+  float output[5] = {};
+  pcm16_to_float32(input, output, 5);
+
+  EXPECT_FLOAT_EQ(output[0], 0.0f);
+  EXPECT_FLOAT_EQ(output[1], 0.5f);
+  EXPECT_FLOAT_EQ(output[2], -0.5f);
+  EXPECT_FLOAT_EQ(output[3], 32767.0f / 32768.0f);
+  EXPECT_FLOAT_EQ(output[4], -1.0f);
+}
+
+TEST(FlutterF2fSoundPlugin, RenderPcm16AppliesGain) {
+  const int16_t input[] = {0, 1000, -1000, 32767, -32768};
+  int16_t output[5] = {};
+
+  render_pcm16(input, output, 5, 1.0f);
+  EXPECT_EQ(memcmp(input, output, sizeof(input)), 0);
+
+  render_pcm16(input, output, 5, 0.5f);
+  EXPECT_EQ(output[0], 0);
+  EXPECT_EQ(output[1], 500);
+  EXPECT_EQ(output[2], -500);
+  EXPECT_EQ(output[4], -16384);
+
+  // Gains above unity saturate instead of wrapping.
+  render_pcm16(input, output, 5, 2.0f);
+  EXPECT_EQ(output[1], 2000);
+  EXPECT_EQ(output[3], 32767);
+  EXPECT_EQ(output[4], -32768);
+
+  // In place, as when the source reads straight into the device buffer
+  memcpy(output, input, sizeof(input));
+  scale_pcm16(output, 5, 0.5f);
+  EXPECT_EQ(output[1], 500);
+  EXPECT_EQ(output[4], -16384);
+  scale_pcm16(output, 5, 1.0f);
+  EXPECT_EQ(output[1], 500);
+}
+
+TEST(FlutterF2fSoundPlugin, PacketCoalescerEmitsExactPackets) {
+  // 20 ms of 44.1 kHz stereo s16 is 882 frames.
+  const size_t packet_bytes = packet_bytes_for_duration(20, 44100, 4);
+  EXPECT_EQ(packet_bytes, 882u * 4);
+
+  PacketCoalescer coalescer;
+  packet_coalescer_reset(&coalescer, packet_bytes);
+
+  // Feed a counting byte stream in irregular fragment sizes.
+  std::vector<uint8_t> stream(packet_bytes * 5 + 100);
+  for (size_t i = 0; i < stream.size(); i++) {
+    stream[i] = static_cast<uint8_t>(i);
+  }
+  std::vector<std::vector<uint8_t>> packets;
+  const size_t fragments[] = {1000, 37, 4096, 12, 5000, 4};
+  size_t offset = 0;
+  for (size_t i = 0; offset < stream.size(); i++) {
+    size_t length = std::min(fragments[i % 6], stream.size() - offset);
+    packet_coalescer_push(&coalescer, stream.data() + offset, length, collect_packet, &packets);
+    offset += length;
+  }
+
+  ASSERT_EQ(packets.size(), 5u);
+  for (size_t i = 0; i < packets.size(); i++) {
+    ASSERT_EQ(packets[i].size(), packet_bytes);
+    EXPECT_TRUE(std::equal(packets[i].begin(), packets[i].end(),
+                           stream.begin() + i * packet_bytes));
+  }
+  EXPECT_EQ(coalescer.pending.size(), 100u);
+}
+
+TEST(FlutterF2fSoundPlugin, SpscRingBufferWrapsAndCountsOverruns) {
+  SpscRingBuffer ring(6);
+  ASSERT_EQ(ring.capacity(), 8u);
+
+  const uint8_t first[] = {1, 2, 3, 4, 5, 6};
+  EXPECT_EQ(ring.write(first, 6), 6u);
+  uint8_t out[8] = {};
+  EXPECT_EQ(ring.read(out, 4), 4u);
+
+  // Wraps past the end of the storage; only four of six bytes fit.
+  const uint8_t second[] = {7, 8, 9, 10, 11, 12};
+  EXPECT_EQ(ring.write(second, 6), 6u);
+  EXPECT_EQ(ring.write(second, 6), 0u);
+  EXPECT_EQ(ring.overrun_bytes(), 6u);
+  EXPECT_EQ(ring.overrun_count(), 1u);
+
+  EXPECT_EQ(ring.read(out, 8), 8u);
+  const uint8_t expected[] = {5, 6, 7, 8, 9, 10, 11, 12};
+  EXPECT_EQ(memcmp(out, expected, 8), 0);
+  EXPECT_EQ(ring.write_index(), 12u);
+  EXPECT_EQ(ring.read_index(), 12u);
+}
+
+TEST(FlutterF2fSoundPlugin, SpscRingBufferAcrossThreads) {
+  SpscRingBuffer ring(256);
+  const size_t kTotal = 1 << 18;
+
+  std::thread producer([&ring, kTotal]() {
+    uint8_t chunk[7];
+    size_t sent = 0;
+    while (sent < kTotal) {
+      size_t length = std::min(sizeof(chunk), kTotal - sent);
+      for (size_t i = 0; i < length; i++) {
+        chunk[i] = static_cast<uint8_t>(sent + i);
+      }
+      size_t written = ring.write(chunk, length);
+      if (written == 0) {
+        std::this_thread::yield();
+      }
+      sent += written;
+    }
+  });
+
+  size_t received = 0;
+  bool in_order = true;
+  uint8_t chunk[13];
+  while (received < kTotal) {
+    size_t length = ring.read(chunk, sizeof(chunk));
+    if (length == 0) {
+      std::this_thread::yield();
+    }
+    for (size_t i = 0; i < length; i++) {
+      in_order &= chunk[i] == static_cast<uint8_t>(received + i);
+    }
+    received += length;
+  }
+  producer.join();
+
+  EXPECT_TRUE(in_order);
+}
+
+// At 1 kHz a frame is a millisecond: 40 frames of target, 5 of fade and
+// steps of 10.
+TEST(FlutterF2fSoundPlugin, PcmSinkBuffersConcealsUnderrunsAndTrims) {
+  PcmSink sink(1000, 1, 40);
+  const std::vector<int16_t> input(200, 1000);
+  int16_t out[10];
+
+  // Silence until the target depth is buffered
+  EXPECT_EQ(sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out)), sizeof(out));
+  EXPECT_EQ(out[9], 0);
+  EXPECT_EQ(sink.feed(input.data(), 30), 30u);
+  sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out));
+  EXPECT_EQ(out[9], 0);
+
+  // Then it fades in
+  sink.feed(input.data(), 20);
+  sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out));
+  EXPECT_GT(out[0], 0);
+  EXPECT_LT(out[0], out[4]);
+  EXPECT_EQ(out[9], 1000);
+
+  // Draining the buffer exactly is not an underrun
+  for (int i = 0; i < 4; i++) {
+    sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out));
+  }
+  EXPECT_EQ(out[9], 1000);
+  EXPECT_EQ(sink.stats().underruns, 0u);
+
+  // Running dry fades the last frames out and deepens the target
+  sink.feed(input.data(), 5);
+  sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out));
+  EXPECT_LT(out[0], 1000);
+  EXPECT_LT(out[4], out[0]);
+  EXPECT_EQ(out[5], 0);
+  PcmSink::Stats stats = sink.stats();
+  EXPECT_EQ(stats.underruns, 1u);
+  EXPECT_EQ(stats.target_frames, 50u);
+  EXPECT_EQ(stats.played_frames, 55u);
+
+  // A burst beyond twice the target is trimmed back to it
+  EXPECT_EQ(sink.feed(input.data(), 150), 150u);
+  sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out));
+  stats = sink.stats();
+  EXPECT_EQ(stats.trimmed_frames, 100u);
+  EXPECT_EQ(stats.buffered_frames, 40u);
+
+  // Once closed the rest plays out and nothing more is taken
+  sink.close();
+  EXPECT_EQ(sink.feed(input.data(), 10), 0u);
+  size_t played = 0;
+  while (!sink.at_end()) {
+    played += sink.read(reinterpret_cast<uint8_t*>(out), sizeof(out)) / sizeof(int16_t);
+  }
+  EXPECT_EQ(played, 40u);
+  EXPECT_EQ(sink.stats().underruns, 1u);
+
+  // Float input is clamped into s16
+  PcmSink float_sink(1000, 2, 40);
+  const float samples[] = {0.5f, -2.0f};
+  EXPECT_EQ(float_sink.feed_float(samples, 1), 1u);
+  EXPECT_EQ(float_sink.stats().fed_frames, 1u);
+
+  // What does not fit is refused, not trimmed
+  const std::vector<float> burst(2 * 3000, 0.25f);
+  const size_t accepted = float_sink.feed_float(burst.data(), 3000);
+  EXPECT_LT(accepted, 3000u);
+  stats = float_sink.stats();
+  EXPECT_EQ(stats.rejected_frames, 3000u - accepted);
+  EXPECT_EQ(stats.trimmed_frames, 0u);
+}
+
+// Constant-level mono sounds at the mixer's rate make the mix easy to check.
+TEST(FlutterF2fSoundPlugin, MixerSumsPansAndSoftClipsVoices) {
+  auto sound = std::make_shared<DecodedPcm>();
+  sound->sample_rate = 48000;
+  sound->channels = 1;
+  sound->samples.assign(1000, 8000);
+  Mixer mixer(48000);
+  std::vector<int16_t> out(512 * Mixer::kChannels);
+
+  // Two voices add up; one panned hard left is silent on the right
+  Mixer::VoiceParams params;
+  const uint32_t first = mixer.play(sound, params);
+  params.pan = -1.0f;
+  const uint32_t second = mixer.play(sound, params);
+  EXPECT_NE(first, second);
+  mixer.render(out.data(), 512);
+  EXPECT_EQ(out[0], 16000);
+  EXPECT_EQ(out[1], 8000);
+  EXPECT_EQ(mixer.stats().active_voices, 2u);
+
+  // A one-shot ends with its sound and hands it back
+  mixer.render(out.data(), 512);
+  EXPECT_EQ(out[2 * 487], 16000);
+  EXPECT_EQ(out[2 * 488], 0);
+  Mixer::VoiceParams current;
+  EXPECT_FALSE(mixer.params(first, &current));
+  EXPECT_EQ(sound.use_count(), 1);
+
+  // Five at once overload the sum, which saturates below full scale
+  params.pan = 0.0f;
+  params.loop = true;
+  std::vector<uint32_t> voices;
+  for (int i = 0; i < 5; i++) {
+    voices.push_back(mixer.play(sound, params));
+  }
+  mixer.render(out.data(), 512);
+  EXPECT_GT(out[0], 26000);
+  EXPECT_LT(out[0], 32767);
+  const float quiet[] = {1000.0f, -1000.0f};
+  soft_clip_to_pcm16(quiet, out.data(), 2);
+  EXPECT_EQ(out[0], 1000);
+  EXPECT_EQ(out[1], -1000);
+
+  // Looping voices keep playing; a stop ramps down and ends them
+  mixer.render(out.data(), 512);
+  EXPECT_TRUE(mixer.params(voices[0], &current));
+  EXPECT_TRUE(current.loop);
+  mixer.stop_all();
+  mixer.render(out.data(), 256);
+  EXPECT_GT(out[0], out[2 * 255]);
+  mixer.render(out.data(), 256);
+  EXPECT_EQ(out[0], 0);
+  EXPECT_FALSE(mixer.params(voices[0], &current));
+
+  // Doubling the rate plays the sound in half the time
+  params.loop = false;
+  params.rate = 2.0f;
+  const uint32_t fast = mixer.play(sound, params);
+  mixer.render(out.data(), 512);
+  EXPECT_NE(out[2 * 499], 0);
+  EXPECT_EQ(out[2 * 500], 0);
+  EXPECT_FALSE(mixer.params(fast, &current));
+  EXPECT_EQ(mixer.stats().peak_voices, 5u);
+}
+
+// The null backend with the fast clock renders playback into a WAV file and
+// delivers capture periods without a sound server.
+TEST(FlutterF2fSoundPlugin, NullBackendWritesWavAndCaptures) {
+  std::string path = std::string(g_get_tmp_dir()) + "/f2f_sound_null_backend_test.wav";
+  std::unique_ptr<AudioBackend> backend = audio_backend_new_null(path.c_str(), false);
+  ASSERT_TRUE(backend->open());
+
+  std::atomic<size_t> captured{0};
+  AudioStreamConfig config;
+  config.sample_rate = 48000;
+  config.channels = 2;
+  config.latency_ms = 20;
+  config.fragment_ms = 10;
+
+  backend->lock();
+  ASSERT_TRUE(backend->start_playback(
+      config, [](uint8_t* buffer, size_t length, void*) { memset(buffer, 0x11, length); },
+      nullptr));
+  ASSERT_TRUE(backend->start_capture(
+      CaptureSource::kMicrophone, config,
+      [](const uint8_t*, size_t length, void* user_data) {
+        *static_cast<std::atomic<size_t>*>(user_data) += length;
+      },
+      &captured));
+  backend->unlock();
+
+  while (backend->playback_frames() < 48000) {
+    std::this_thread::yield();
+  }
+  backend->close();
+
+  EXPECT_DOUBLE_EQ(backend->playback_latency_ms(), 20.0);
+  EXPECT_GT(captured.load(), 0u);
+
+  FILE* file = fopen(path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  uint8_t header[44];
+  ASSERT_EQ(fread(header, 1, sizeof(header), file), sizeof(header));
+  fseek(file, 0, SEEK_END);
+  long file_size = ftell(file);
+  fclose(file);
+  remove(path.c_str());
+
+  uint32_t data_size = header[40] | header[41] << 8 | header[42] << 16 | (uint32_t)header[43] << 24;
+  EXPECT_EQ(memcmp(header, "RIFF", 4), 0);
+  EXPECT_EQ(memcmp(header + 8, "WAVE", 4), 0);
+  EXPECT_EQ(data_size, backend->playback_frames() * 4);
+  EXPECT_EQ(file_size, (long)(data_size + 44));
+}
+
+// Decodes a file longer than the decoder's ring and checks every frame comes
+// out in order, before and after a seek.
+TEST(FlutterF2fSoundPlugin, StreamingDecoderReadsInOrderAndSeeks) {
+  const sf_count_t kFrames = 50000;
+  std::string path = std::string(g_get_tmp_dir()) + "/f2f_sound_streaming_decoder_test.wav";
+  ASSERT_TRUE(write_test_wav(path, kFrames));
+
+  std::unique_ptr<StreamingDecoder> decoder = StreamingDecoder::open_file(path, 100);
+  ASSERT_NE(decoder, nullptr);
+  EXPECT_EQ(decoder->sample_rate(), 8000);
+  EXPECT_EQ(decoder->channels(), 2);
+  EXPECT_EQ(decoder->frames(), (uint64_t)kFrames);
+
+  EXPECT_TRUE(read_test_frames(decoder.get(), 0, 20000));
+  decoder->seek(12345);
+  EXPECT_EQ(decoder->position_frames(), 12345u);
+  EXPECT_TRUE(read_test_frames(decoder.get(), 12345, kFrames - 12345));
+  EXPECT_EQ(decoder->position_frames(), (uint64_t)kFrames);
+  EXPECT_TRUE(decoder->at_end());
+
+  decoder.reset();
+  remove(path.c_str());
+}
+
+// The same file decodes identically through libsndfile's virtual I/O.
+TEST(FlutterF2fSoundPlugin, StreamingDecoderReadsVirtualInput) {
+  const sf_count_t kFrames = 30000;
+  std::string path = std::string(g_get_tmp_dir()) + "/f2f_sound_virtual_input_test.wav";
+  ASSERT_TRUE(write_test_wav(path, kFrames));
+
+  std::vector<uint8_t> bytes;
+  FILE* file = fopen(path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  uint8_t chunk[4096];
+  for (size_t length; (length = fread(chunk, 1, sizeof(chunk), file)) > 0;) {
+    bytes.insert(bytes.end(), chunk, chunk + length);
+  }
+  fclose(file);
+  remove(path.c_str());
+
+  std::unique_ptr<StreamingDecoder> decoder =
+      StreamingDecoder::open_virtual(std::make_shared<MemoryInput>(std::move(bytes)), 100);
+  ASSERT_NE(decoder, nullptr);
+  EXPECT_EQ(decoder->frames(), (uint64_t)kFrames);
+  EXPECT_TRUE(read_test_frames(decoder.get(), 0, kFrames));
+  EXPECT_TRUE(decoder->at_end());
+}
+
+// Headerless PCM from memory decodes with the format its MIME type names,
+// in either byte order.
+TEST(FlutterF2fSoundPlugin, StreamingDecoderReadsRawPcmFromMimeHint) {
+  const size_t kFrames = 20000;
+  for (const char* mime : {"audio/pcm; rate=8000; channels=2", "Audio/L16;rate=8000;channels=2"}) {
+    SF_INFO info;
+    ASSERT_TRUE(raw_format_from_mime(mime, &info));
+    EXPECT_EQ(info.samplerate, 8000);
+    EXPECT_EQ(info.channels, 2);
+
+    const bool big_endian = (info.format & SF_ENDIAN_BIG) != 0;
+    std::vector<uint8_t> bytes;
+    for (size_t frame = 0; frame < kFrames; frame++) {
+      for (int16_t sample : {static_cast<int16_t>(frame & 0x7fff),
+                             static_cast<int16_t>(-(frame & 0x7fff))}) {
+        const uint16_t value = static_cast<uint16_t>(sample);
+        bytes.push_back(static_cast<uint8_t>(big_endian ? value >> 8 : value));
+        bytes.push_back(static_cast<uint8_t>(big_endian ? value : value >> 8));
+      }
+    }
+
+    std::unique_ptr<StreamingDecoder> decoder = StreamingDecoder::open_virtual(
+        std::make_shared<MemoryInput>(std::move(bytes)), 100, &info);
+    ASSERT_NE(decoder, nullptr);
+    EXPECT_EQ(decoder->frames(), (uint64_t)kFrames);
+    EXPECT_TRUE(read_test_frames(decoder.get(), 0, kFrames));
+  }
+
+  SF_INFO info;
+  EXPECT_FALSE(raw_format_from_mime("audio/wav", &info));
+  EXPECT_FALSE(raw_format_from_mime("audio/L16", &info));
+  EXPECT_FALSE(raw_format_from_mime("", &info));
+}
+
+TEST(FlutterF2fSoundPlugin, PcmCacheSharesDecodedAudio) {
+  const std::string first = std::string(g_get_tmp_dir()) + "/f2f_pcm_cache_first.wav";
+  const std::string second = std::string(g_get_tmp_dir()) + "/f2f_pcm_cache_second.wav";
+  ASSERT_TRUE(write_test_wav(first, 1000));
+  ASSERT_TRUE(write_test_wav(second, 1000));
+
+  // Room for both 4000-byte files, but not for a 40000-byte one
+  PcmCache cache(16000);
+  std::shared_ptr<const DecodedPcm> pcm = cache.get(first);
+  ASSERT_NE(pcm, nullptr);
+  EXPECT_EQ(pcm->sample_rate, 8000);
+  EXPECT_EQ(pcm->samples.size(), 2000u);
+  EXPECT_EQ(cache.get(first), pcm);
+  ASSERT_NE(cache.get(second), nullptr);
+
+  PcmCache::Stats stats = cache.stats();
+  EXPECT_EQ(stats.hits, 1u);
+  EXPECT_EQ(stats.misses, 2u);
+  EXPECT_EQ(stats.entries, 2u);
+  EXPECT_EQ(stats.bytes, 8000u);
+
+  // Shrinking the budget drops the least recently used file, while a source
+  // still holding it plays on
+  PcmBufferSource source(pcm);
+  cache.set_budget(4000);
+  stats = cache.stats();
+  EXPECT_EQ(stats.evictions, 1u);
+  EXPECT_EQ(stats.entries, 1u);
+
+  source.seek(998);
+  int16_t frames[8];
+  EXPECT_EQ(source.read(reinterpret_cast<uint8_t*>(frames), sizeof(frames)), 2 * source.frame_bytes());
+  EXPECT_EQ(frames[0], 998);
+  EXPECT_EQ(frames[3], -999);
+  EXPECT_TRUE(source.at_end());
+
+  const std::string long_file = std::string(g_get_tmp_dir()) + "/f2f_pcm_cache_long.wav";
+  ASSERT_TRUE(write_test_wav(long_file, 10000));
+  EXPECT_EQ(cache.get(long_file), nullptr);
+
+  remove(first.c_str());
+  remove(second.c_str());
+  remove(long_file.c_str());
+}
+
+TEST(FlutterF2fSoundPlugin, SampleBankLoadsAtMixerRateAndTriggers) {
+  const std::string path = std::string(g_get_tmp_dir()) + "/f2f_sample_bank.wav";
+  ASSERT_TRUE(write_test_wav(path, 1000));
+
+  // Loaded once per rate; at the file's own rate the samples are unchanged
+  SampleBank bank(16000);
+  const uint32_t id = bank.load(path, 8000);
+  ASSERT_NE(id, 0u);
+  EXPECT_EQ(bank.load(path, 8000), id);
+  std::shared_ptr<const DecodedPcm> pcm = bank.get(id);
+  ASSERT_NE(pcm, nullptr);
+  EXPECT_EQ(pcm->samples.size(), 2000u);
+  EXPECT_EQ(pcm->samples[2 * 500], 500);
+
+  // At twice the rate it takes twice the frames and memory
+  const uint32_t doubled = bank.load(path, 16000);
+  ASSERT_NE(doubled, 0u);
+  EXPECT_NEAR((double)bank.get(doubled)->samples.size(), 4000.0, 4.0);
+
+  // A trigger plays the shared buffer as it is, on its own voice
+  Mixer mixer(8000);
+  const uint32_t voice = mixer.play(bank.get(id), Mixer::VoiceParams());
+  ASSERT_NE(voice, 0u);
+  int16_t out[2 * 16];
+  mixer.render(out, 16);
+  EXPECT_EQ(out[2 * 10], 10);
+  EXPECT_EQ(out[2 * 10 + 1], -10);
+
+  // Over budget the least recently triggered sound goes; playing voices
+  // keep theirs
+  bank.set_budget(8100);
+  EXPECT_EQ(bank.get(id), pcm);
+  EXPECT_EQ(bank.get(doubled), nullptr);
+  SampleBank::Stats stats = bank.stats();
+  EXPECT_EQ(stats.loads, 2u);
+  EXPECT_EQ(stats.evictions, 1u);
+  EXPECT_EQ(stats.entries, 1u);
+  EXPECT_EQ(stats.bytes, 4000u);
+  mixer.render(out, 16);
+  EXPECT_EQ(out[0], 16);
+
+  EXPECT_EQ(bank.load(path, 48000), 0u);
+
+  // A file rewritten on disk is decoded again rather than served stale
+  ASSERT_TRUE(write_test_wav(path, 500));
+  const uint32_t rewritten = bank.load(path, 8000);
+  ASSERT_NE(rewritten, 0u);
+  EXPECT_NE(rewritten, id);
+  EXPECT_EQ(bank.get(rewritten)->samples.size(), 1000u);
+  EXPECT_TRUE(bank.unload(rewritten));
+
+  EXPECT_TRUE(bank.unload(id));
+  EXPECT_EQ(bank.get(id), nullptr);
+  EXPECT_EQ(bank.stats().bytes, 0u);
+
+  remove(path.c_str());
+}
+
+// A 5.1 WAV in the default channel order: L R C LFE Ls Rs.
+TEST(FlutterF2fSoundPlugin, SampleBankDownmixesSurroundToStereo) {
+  const std::string path = std::string(g_get_tmp_dir()) + "/f2f_sample_bank_51.wav";
+  SF_INFO info;
+  memset(&info, 0, sizeof(info));
+  info.samplerate = 8000;
+  info.channels = 6;
+  info.format = SF_FORMAT_WAV | SF_FORMAT_PCM_16;
+  SNDFILE* sndfile = sf_open(path.c_str(), SFM_WRITE, &info);
+  ASSERT_NE(sndfile, nullptr);
+  const int16_t frame[] = {1000, 0, 2000, 30000, 0, 1000};
+  std::vector<int16_t> samples;
+  for (int i = 0; i < 100; i++) {
+    samples.insert(samples.end(), std::begin(frame), std::end(frame));
+  }
+  EXPECT_EQ(sf_writef_short(sndfile, samples.data(), 100), 100);
+  sf_close(sndfile);
+
+  // The centre and surrounds fold in at -3 dB, the LFE is left out, and
+  // each side is scaled by its weights: (1000 + 0.707 * 2000) / 2.414 on
+  // the left, (0.707 * 2000 + 0.707 * 1000) / 2.414 on the right
+  SampleBank bank(16000);
+  const uint32_t id = bank.load(path, 8000);
+  ASSERT_NE(id, 0u);
+  std::shared_ptr<const DecodedPcm> pcm = bank.get(id);
+  EXPECT_EQ(pcm->channels, 2);
+  EXPECT_EQ(pcm->samples.size(), 200u);
+  EXPECT_NEAR(pcm->samples[2 * 50], 1000, 2);
+  EXPECT_NEAR(pcm->samples[2 * 50 + 1], 879, 2);
+
+  remove(path.c_str());
+}
+
+TEST(FlutterF2fSoundPlugin, MappedWavSourceReadsDataChunkInPlace) {
+  const std::string path = std::string(g_get_tmp_dir()) + "/f2f_mapped.wav";
+  ASSERT_TRUE(write_test_wav(path, 1000));
+
+  std::unique_ptr<MappedWavSource> source = MappedWavSource::open(path);
+  ASSERT_NE(source, nullptr);
+  EXPECT_EQ(source->sample_rate(), 8000);
+  EXPECT_EQ(source->channels(), 2);
+  EXPECT_EQ(source->frames(), 1000u);
+
+  size_t length = 3 * source->frame_bytes() + 1;
+  const int16_t* frames = reinterpret_cast<const int16_t*>(source->read_in_place(&length));
+  ASSERT_NE(frames, nullptr);
+  EXPECT_EQ(length, 3 * source->frame_bytes());
+  EXPECT_EQ(frames[4], 2);
+  EXPECT_EQ(frames[5], -2);
+  EXPECT_EQ(source->position_frames(), 3u);
+
+  source->seek(999);
+  int16_t last[4];
+  EXPECT_EQ(source->read(reinterpret_cast<uint8_t*>(last), sizeof(last)), source->frame_bytes());
+  EXPECT_EQ(last[0], 999);
+  EXPECT_TRUE(source->at_end());
+
+  // Anything but 16-bit PCM WAV is left to the decoder
+  const std::string text = std::string(g_get_tmp_dir()) + "/f2f_mapped.txt";
+  FILE* file = fopen(text.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  fputs("RIFF....WAVEnot really", file);
+  fclose(file);
+  EXPECT_EQ(MappedWavSource::open(text), nullptr);
+
+  remove(path.c_str());
+  remove(text.c_str());
+}
+
+TEST(FlutterF2fSoundPlugin, RiffParserIndexesExtensibleWaveIncrementally) {
+  // 24-bit stereo with a chunk before and after the samples
+  std::vector<uint8_t> file;
+  append_chunk_header(&file, "RIFF", 0);
+  file.insert(file.end(), {'W', 'A', 'V', 'E'});
+  append_extensible_format(&file, 1, 2, 48000, 24);
+  append_chunk_header(&file, "bext", 3);
+  file.insert(file.end(), {1, 2, 3, 0});  // Padded to an even size
+  append_chunk_header(&file, "data", 4 * 6);
+  const size_t data_offset = file.size();
+  for (int32_t i = 0; i < 4; i++) {
+    append_le(&file, static_cast<uint32_t>(i * 0x10000 - 0x18000), 3);  // Left
+    append_le(&file, static_cast<uint32_t>(i * 0x100), 3);              // Right
+  }
+  append_chunk_header(&file, "LIST", 4);
+  file.insert(file.end(), {'I', 'N', 'F', 'O'});
+
+  size_t bytes_read = 0;
+  RiffParser parser;
+  const RiffParser::ReadFunction read = memory_reader(file, &bytes_read);
+  EXPECT_EQ(parser.parse(read, 8), RiffParser::Status::kNeedMoreData);
+  EXPECT_EQ(parser.parse(read, 40), RiffParser::Status::kNeedMoreData);  // Inside fmt
+  EXPECT_EQ(parser.parse(read, data_offset + 12), RiffParser::Status::kOk);
+  EXPECT_EQ(parser.frames(), 2u);
+  EXPECT_EQ(parser.find("LIST"), nullptr);
+  EXPECT_EQ(parser.parse(read, file.size()), RiffParser::Status::kOk);
+  EXPECT_EQ(parser.frames(), 4u);
+  EXPECT_EQ(parser.data_offset(), data_offset);
+  ASSERT_NE(parser.find("LIST"), nullptr);
+  EXPECT_EQ(parser.chunks().size(), 4u);
+  EXPECT_EQ(parser.find("bext")->size, 3u);
+
+  const WavFormat& format = parser.format();
+  EXPECT_EQ(format.format_tag, 0xFFFE);
+  EXPECT_EQ(format.sample_format, WavSampleFormat::kPcm);
+  EXPECT_EQ(format.channels, 2);
+  EXPECT_EQ(format.sample_rate, 48000u);
+  EXPECT_EQ(format.bits_per_sample, 24);
+  EXPECT_EQ(format.channel_mask, 3u);
+
+  // The top 16 bits of each sample
+  int16_t samples[8];
+  wav_samples_to_s16(format, file.data() + data_offset, 4, samples);
+  EXPECT_EQ(samples[0], -0x180);
+  EXPECT_EQ(samples[1], 0);
+  EXPECT_EQ(samples[6], 0x180);
+  EXPECT_EQ(samples[7], 3);
+
+  // Compressed data is reported, not misread
+  std::vector<uint8_t> adpcm(file.begin(), file.begin() + 12);
+  append_chunk_header(&adpcm, "fmt ", 16);
+  append_le(&adpcm, 2, 2);
+  adpcm.resize(adpcm.size() + 14);
+  RiffParser adpcm_parser;
+  EXPECT_EQ(adpcm_parser.parse(memory_reader(adpcm, &bytes_read), adpcm.size()),
+            RiffParser::Status::kUnsupported);
+}
+
+TEST(FlutterF2fSoundPlugin, RiffParserReadsRf64HeadersOnly) {
+  // An hour of 8-channel 32-bit float at 96 kHz, over 10 GB, of which only
+  // the headers exist here
+  const uint64_t frames = 96000ull * 3600;
+  const uint64_t data_bytes = frames * 8 * 4;
+  std::vector<uint8_t> header;
+  append_chunk_header(&header, "RF64", 0xFFFFFFFF);
+  header.insert(header.end(), {'W', 'A', 'V', 'E'});
+  append_chunk_header(&header, "ds64", 28);
+  append_le(&header, data_bytes + 100, 8);  // RIFF size
+  append_le(&header, data_bytes, 8);
+  append_le(&header, frames, 8);
+  append_le(&header, 0, 4);  // No table
+  append_extensible_format(&header, 3, 8, 96000, 32);
+  append_chunk_header(&header, "data", 0xFFFFFFFF);
+
+  size_t bytes_read = 0;
+  RiffParser parser;
+  EXPECT_EQ(parser.parse(memory_reader(header, &bytes_read), header.size() + data_bytes),
+            RiffParser::Status::kOk);
+  EXPECT_TRUE(parser.is_rf64());
+  EXPECT_EQ(parser.format().sample_format, WavSampleFormat::kFloat);
+  EXPECT_EQ(parser.data_offset(), header.size());
+  EXPECT_EQ(parser.frames(), frames);
+  EXPECT_EQ(bytes_read, header.size());
+
+  // A recording still being written only counts the frames already there
+  RiffParser growing;
+  EXPECT_EQ(growing.parse(memory_reader(header, &bytes_read), header.size() + 64),
+            RiffParser::Status::kOk);
+  EXPECT_EQ(growing.frames(), 2u);
+
+  // Floats are clamped
+  const float floats[4] = {0.5f, -1.0f, 1.5f, -2.0f};
+  int16_t samples[4];
+  WavFormat stereo_float = parser.format();
+  stereo_float.channels = 2;
+  wav_samples_to_s16(stereo_float, reinterpret_cast<const uint8_t*>(floats), 2, samples);
+  EXPECT_EQ(samples[0], 16384);
+  EXPECT_EQ(samples[1], -32768);
+  EXPECT_EQ(samples[2], 32767);
+  EXPECT_EQ(samples[3], -32768);
+}
+
+// Not a pass/fail benchmark: reports how fast field recordings convert to
+// the 16-bit output format.
+TEST(FlutterF2fSoundPlugin, WavSamplesToS16Throughput) {
+  constexpr size_t kFrames = 48000 * 60;  // A minute of stereo
+  std::vector<uint8_t> samples(kFrames * 2 * 4);
+  for (size_t i = 0; i < samples.size(); i++) {
+    samples[i] = static_cast<uint8_t>(i * 131);
+  }
+  std::vector<int16_t> out(kFrames * 2);
+
+  WavFormat format;
+  format.channels = 2;
+  format.sample_rate = 48000;
+  const struct {
+    const char* name;
+    WavSampleFormat sample_format;
+    uint16_t bits;
+  } cases[] = {{"pcm16", WavSampleFormat::kPcm, 16},
+               {"pcm24", WavSampleFormat::kPcm, 24},
+               {"pcm32", WavSampleFormat::kPcm, 32},
+               {"float32", WavSampleFormat::kFloat, 32}};
+  for (const auto& test_case : cases) {
+    format.sample_format = test_case.sample_format;
+    format.bits_per_sample = test_case.bits;
+    format.block_align = static_cast<uint16_t>(2 * test_case.bits / 8);
+    const auto start = std::chrono::steady_clock::now();
+    wav_samples_to_s16(format, samples.data(), kFrames, out.data());
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - start;
+    printf("[ BENCHMARK] %s to s16: a minute of 48 kHz stereo in %.2f ms\n", test_case.name,
+           elapsed.count());
+    // The last sample keeps the top two bytes of its container
+    const uint8_t* last = samples.data() + (kFrames * 2 - 1) * (test_case.bits / 8);
+    if (test_case.sample_format == WavSampleFormat::kPcm) {
+      EXPECT_EQ(out.back(), static_cast<int16_t>(last[test_case.bits / 8 - 2] |
+                                                 last[test_case.bits / 8 - 1] << 8));
+    }
+  }
+}
+
+// Work runs off the calling thread, in order on a single-thread pool;
+// replies come back through the main context.
+TEST(FlutterF2fSoundPlugin, WorkerPoolRepliesOnMainContext) {
+  WorkerPool pool(1);
+  const std::thread::id main_thread = std::this_thread::get_id();
+  std::vector<int> order;
+  bool work_off_main = true;
+  int replies = 0;
+
+  for (int i = 0; i < 3; i++) {
+    pool.post([&work_off_main, main_thread](const WorkerJob&) {
+                work_off_main &= std::this_thread::get_id() != main_thread;
+              },
+              [&order, &replies, i](const WorkerJob&) {
+                order.push_back(i);
+                replies++;
+              });
+  }
+
+  while (replies < 3) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+  EXPECT_TRUE(work_off_main);
+  EXPECT_THAT(order, testing::ElementsAre(0, 1, 2));
+}
+
+// A job cancelled before it starts is skipped, but its reply still runs so
+// the method call can be answered.
+TEST(FlutterF2fSoundPlugin, WorkerPoolSkipsCancelledJobs) {
+  WorkerPool pool(1);
+  std::atomic<bool> release{false};
+  bool skipped_work_ran = false;
+  bool reply_saw_cancel = false;
+  int replies = 0;
+
+  pool.post(
+      [&release](const WorkerJob&) {
+        while (!release) {
+          std::this_thread::yield();
+        }
+      },
+      [&replies](const WorkerJob&) { replies++; });
+  std::shared_ptr<WorkerJob> job = pool.post(
+      [&skipped_work_ran](const WorkerJob&) { skipped_work_ran = true; },
+      [&replies, &reply_saw_cancel](const WorkerJob& job) {
+        reply_saw_cancel = job.cancelled();
+        replies++;
+      });
+  job->cancel();
+  release = true;
+
+  while (replies < 2) {
+    g_main_context_iteration(nullptr, TRUE);
+  }
+  EXPECT_FALSE(skipped_work_ran);
+  EXPECT_TRUE(reply_saw_cancel);
+}
+
+TEST(FlutterF2fSoundPlugin, AudioCacheEvictsLeastRecentlyUsed) {
+  std::string directory = std::string(g_get_tmp_dir()) + "/f2f_cache_test_XXXXXX";
+  ASSERT_NE(mkdtemp(&directory[0]), nullptr);
+  // Room for one 10-byte body
+  AudioCache cache(directory, 15);
+  auto write_bytes = [](const char* bytes) {
+    return [bytes](FILE* file) { return fwrite(bytes, 1, 10, file) == 10; };
+  };
+
+  HttpValidators first;
+  first.etag = "\"first\"";
+  ASSERT_TRUE(cache.store("http://example.com/a.wav", first, write_bytes("aaaaaaaaaa")));
+  HttpValidators second;
+  second.last_modified = "Wed, 21 Oct 2015 07:28:00 GMT";
+  ASSERT_TRUE(cache.store("http://example.com/b.wav", second, write_bytes("bbbbbbbbbb")));
+  EXPECT_FALSE(cache.store("http://example.com/c.wav", second,
+                           [](FILE*) { return false; }));
+
+  AudioCache::Entry entry;
+  EXPECT_FALSE(cache.lookup("http://example.com/a.wav", &entry));
+  EXPECT_FALSE(cache.lookup("http://example.com/c.wav", &entry));
+  ASSERT_TRUE(cache.lookup("http://example.com/b.wav", &entry));
+  EXPECT_EQ(entry.validators.etag, "");
+  EXPECT_EQ(entry.validators.last_modified, second.last_modified);
+
+  char body[16] = {0};
+  FILE* file = fopen(entry.path.c_str(), "rb");
+  ASSERT_NE(file, nullptr);
+  EXPECT_EQ(fread(body, 1, sizeof(body), file), 10u);
+  fclose(file);
+  EXPECT_STREQ(body, "bbbbbbbbbb");
+
+  remove(entry.path.c_str());
+  remove((entry.path.substr(0, entry.path.size() - strlen(".audio")) + ".meta").c_str());
+  remove(directory.c_str());
+}
+
+// A read far beyond what the transfer will reach soon restarts it there with
+// a Range request; the bytes skipped are fetched afterwards for the
+// completion callback.
+TEST(FlutterF2fSoundPlugin, HttpStreamRestartsAtSeekBeyondReadAhead) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  const std::vector<uint8_t> body = http_test_body(4 * 1024 * 1024);
+  LoopbackHttpServer server(body, true, true);
+  CompletedBody completed;
+  std::shared_ptr<HttpStream> stream = HttpStream::start(server.url(), nullptr,
+                                                         completed.callback());
+
+  uint8_t buffer[4096];
+  ASSERT_EQ(stream->read(buffer, 0, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data(), sizeof(buffer)), 0);
+  EXPECT_EQ(stream->length(), (int64_t)body.size());
+
+  const int64_t seek = 3 * 1024 * 1024;
+  ASSERT_EQ(stream->read(buffer, seek, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + seek, sizeof(buffer)), 0);
+  std::vector<int64_t> starts = server.range_starts();
+  ASSERT_GE(starts.size(), 2u);
+  EXPECT_EQ(starts[0], -1);
+  EXPECT_EQ(starts[1], seek);
+
+  EXPECT_EQ(completed.wait(), body);
+  starts = server.range_starts();
+  ASSERT_EQ(starts.size(), 3u);
+  EXPECT_GT(starts[2], 0);
+  EXPECT_LT(starts[2], seek);
+
+  // Reads near the end clamp to the body
+  EXPECT_EQ(stream->read(buffer, (int64_t)body.size() - 100, sizeof(buffer)), 100);
+}
+
+// A transfer that fails ends reads at the byte it stopped on, but a read
+// elsewhere starts a new transfer, which clears the failure so the gap is
+// fetched for the completion callback.
+TEST(FlutterF2fSoundPlugin, HttpStreamRecoversFromFailedTransfer) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  const std::vector<uint8_t> body = http_test_body(2 * 1024 * 1024);
+  const int64_t cut = 64 * 1024;
+  LoopbackHttpServer server(body, true, true, cut);
+  CompletedBody completed;
+  std::shared_ptr<HttpStream> stream = HttpStream::start(server.url(), nullptr,
+                                                         completed.callback());
+
+  uint8_t buffer[4096];
+  ASSERT_EQ(stream->read(buffer, 0, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(stream->read(buffer, cut, sizeof(buffer)), 0);
+
+  const int64_t seek = 1024 * 1024;
+  ASSERT_EQ(stream->read(buffer, seek, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + seek, sizeof(buffer)), 0);
+  EXPECT_EQ(completed.wait(), body);
+  ASSERT_EQ(stream->read(buffer, cut, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + cut, sizeof(buffer)), 0);
+}
+
+// A server that answers a Range request with the whole file is read from the
+// start, and no further ranges are asked of it.
+TEST(FlutterF2fSoundPlugin, HttpStreamReadsFromStartWhenServerIgnoresRange) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  const std::vector<uint8_t> body = http_test_body(2 * 1024 * 1024);
+  LoopbackHttpServer server(body, false, false);
+  CompletedBody completed;
+  std::shared_ptr<HttpStream> stream = HttpStream::start(server.url(), nullptr,
+                                                         completed.callback());
+
+  uint8_t buffer[4096];
+  ASSERT_EQ(stream->read(buffer, 0, sizeof(buffer)), (int64_t)sizeof(buffer));
+  const int64_t seek = 1536 * 1024;
+  ASSERT_EQ(stream->read(buffer, seek, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + seek, sizeof(buffer)), 0);
+
+  // Behind the transfer and far ahead of it: both wait for the one stream
+  ASSERT_EQ(stream->read(buffer, 1000, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + 1000, sizeof(buffer)), 0);
+  ASSERT_EQ(stream->read(buffer, (int64_t)body.size() - 4096, sizeof(buffer)),
+            (int64_t)sizeof(buffer));
+
+  EXPECT_EQ(completed.wait(), body);
+  EXPECT_EQ(server.range_starts(), std::vector<int64_t>({-1, seek}));
+}
+
+// A large file is fetched in four segments. A read just ahead of a running
+// segment waits for it; one far into it takes over the rest of its range.
+TEST(FlutterF2fSoundPlugin, HttpStreamHandsRunningSegmentToSeek) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  const int64_t segment = 3 * 1024 * 1024;
+  const std::vector<uint8_t> body = http_test_body(4 * segment);
+  LoopbackHttpServer server(body, true, true);
+  CompletedBody completed;
+  std::shared_ptr<HttpStream> stream = HttpStream::start(server.url(), nullptr,
+                                                         completed.callback());
+
+  uint8_t buffer[4096];
+  ASSERT_EQ(stream->read(buffer, 0, sizeof(buffer)), (int64_t)sizeof(buffer));
+
+  const int64_t near = 2 * segment + 64 * 1024;
+  ASSERT_EQ(stream->read(buffer, near, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + near, sizeof(buffer)), 0);
+
+  const int64_t far = 2 * segment + segment / 2;
+  ASSERT_EQ(stream->read(buffer, far, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + far, sizeof(buffer)), 0);
+
+  EXPECT_EQ(completed.wait(), body);
+  // The first transfer, the segments and the restart at |far|, plus the
+  // front gap when the seek cut the first transfer short. Segments connect
+  // in any order.
+  std::vector<int64_t> starts = server.range_starts();
+  std::sort(starts.begin(), starts.end());
+  if (starts.size() == 6) {
+    EXPECT_GT(starts[1], 0);
+    EXPECT_LT(starts[1], segment);
+    starts.erase(starts.begin() + 1);
+  }
+  EXPECT_EQ(starts, std::vector<int64_t>({-1, segment, 2 * segment, far, 3 * segment}));
+}
+
+// Segments answered without ranges, although the server advertised them,
+// leave the whole file to the first transfer.
+TEST(FlutterF2fSoundPlugin, HttpStreamFallsBackWhenSegmentsIgnoreRange) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+  const std::vector<uint8_t> body = http_test_body(12 * 1024 * 1024);
+  LoopbackHttpServer server(body, false, true);
+  CompletedBody completed;
+  std::shared_ptr<HttpStream> stream = HttpStream::start(server.url(), nullptr,
+                                                         completed.callback());
+
+  EXPECT_EQ(completed.wait(), body);
+  const int64_t segment = 3 * 1024 * 1024;
+  std::vector<int64_t> starts = server.range_starts();
+  std::sort(starts.begin(), starts.end());
+  EXPECT_EQ(starts, std::vector<int64_t>({-1, segment, 2 * segment, 3 * segment}));
+
+  uint8_t buffer[4096];
+  const int64_t offset = 10 * 1024 * 1024;
+  ASSERT_EQ(stream->read(buffer, offset, sizeof(buffer)), (int64_t)sizeof(buffer));
+  EXPECT_EQ(memcmp(buffer, body.data() + offset, sizeof(buffer)), 0);
+}
+
 }  // namespace test
 }  // namespace flutter_f2f_sound
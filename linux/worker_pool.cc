@@ -0,0 +1,74 @@
+#include "worker_pool.h"
+
+#include <glib.h>
+
+#include <utility>
+
+namespace {
+
+struct Reply {
+  std::shared_ptr<WorkerJob> job;
+  WorkerPool::Callback callback;
+};
+
+gboolean run_reply(gpointer user_data) {
+  auto* reply = static_cast<Reply*>(user_data);
+  reply->callback(*reply->job);
+  delete reply;
+  return G_SOURCE_REMOVE;
+}
+
+}  // namespace
+
+WorkerPool::WorkerPool(size_t max_threads) : max_threads_(max_threads > 0 ? max_threads : 1) {}
+
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    quit_ = true;
+    for (Task& task : tasks_) {
+      task.job->cancel();
+    }
+    tasks_.clear();
+  }
+  wake_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+std::shared_ptr<WorkerJob> WorkerPool::post(Callback work, Callback reply) {
+  auto job = std::make_shared<WorkerJob>();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  tasks_.push_back(Task{job, std::move(work), std::move(reply)});
+  if (idle_threads_ < tasks_.size() && threads_.size() < max_threads_) {
+    threads_.emplace_back(&WorkerPool::run, this);
+  }
+  wake_.notify_one();
+  return job;
+}
+
+void WorkerPool::run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    idle_threads_++;
+    wake_.wait(lock, [this]() { return quit_ || !tasks_.empty(); });
+    idle_threads_--;
+    if (quit_) {
+      return;
+    }
+    Task task = std::move(tasks_.front());
+    tasks_.pop_front();
+
+    lock.unlock();
+    if (!task.job->cancelled()) {
+      task.work(*task.job);
+    }
+    // Release what the work captured here, before the reply runs, so the
+    // reply is the last owner on the main thread
+    task.work = nullptr;
+    g_main_context_invoke(nullptr, run_reply, new Reply{task.job, std::move(task.reply)});
+    lock.lock();
+  }
+}
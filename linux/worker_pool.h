@@ -0,0 +1,91 @@
+#ifndef FLUTTER_PLUGIN_WORKER_POOL_H_
+#define FLUTTER_PLUGIN_WORKER_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Handle to a job posted to a WorkerPool.
+class WorkerJob {
+ public:
+  // Asks the job to stop. Work that has not started is skipped; running work
+  // sees cancelled() and should return early. The reply still runs.
+  void cancel() {
+    std::function<void()> handler;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cancelled_.store(true, std::memory_order_relaxed);
+      handler = std::move(cancel_handler_);
+    }
+    if (handler) {
+      handler();
+    }
+  }
+
+  bool cancelled() const { return cancelled_.load(std::memory_order_relaxed); }
+
+  // Lets running work interrupt blocking I/O: |handler| runs on the thread
+  // that calls cancel(), or right away if the job is already cancelled.
+  // Passing nullptr removes it.
+  void on_cancel(std::function<void()> handler) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!cancelled_.load(std::memory_order_relaxed)) {
+        cancel_handler_ = std::move(handler);
+        return;
+      }
+    }
+    if (handler) {
+      handler();
+    }
+  }
+
+ private:
+  std::atomic<bool> cancelled_{false};
+  std::mutex mutex_;
+  std::function<void()> cancel_handler_;
+};
+
+// Runs blocking work such as disk and network I/O off the platform thread.
+//
+// Jobs run on at most |max_threads| worker threads, started as the queue
+// needs them, and are picked up in posting order. Each job's reply then
+// runs on the default main context, where it can touch plugin state and
+// respond to the method call. Jobs still queued when the pool is destroyed
+// are dropped without their replies.
+class WorkerPool {
+ public:
+  typedef std::function<void(WorkerJob& job)> Callback;
+
+  explicit WorkerPool(size_t max_threads);
+  ~WorkerPool();
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  std::shared_ptr<WorkerJob> post(Callback work, Callback reply);
+
+ private:
+  struct Task {
+    std::shared_ptr<WorkerJob> job;
+    Callback work;
+    Callback reply;
+  };
+
+  void run();
+
+  const size_t max_threads_;
+  std::vector<std::thread> threads_;
+  size_t idle_threads_ = 0;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::deque<Task> tasks_;
+  bool quit_ = false;
+};
+
+#endif  // FLUTTER_PLUGIN_WORKER_POOL_H_
@@ -0,0 +1,266 @@
+#include "riff_parser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Size field of RF64 chunks whose real size is in ds64.
+constexpr uint32_t kSizeInDs64 = 0xFFFFFFFF;
+
+constexpr uint16_t kFormatPcm = 0x0001;
+constexpr uint16_t kFormatFloat = 0x0003;
+constexpr uint16_t kFormatExtensible = 0xFFFE;
+
+// Larger fmt or ds64 chunks are not real ones.
+constexpr uint64_t kMaxFormatBytes = 4096;
+constexpr uint64_t kMaxDs64Bytes = 28 + 12 * 1024;
+
+// KSDATAFORMAT_SUBTYPE_PCM and _IEEE_FLOAT after their leading format tag.
+constexpr uint8_t kSubformatTail[14] = {0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80,
+                                        0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71};
+
+uint16_t read_le16(const uint8_t* p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+uint32_t read_le32(const uint8_t* p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+uint64_t read_le64(const uint8_t* p) {
+  return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+template <typename Float>
+int16_t float_to_s16(Float value) {
+  const Float scaled = value * (Float)32768;
+  if (scaled >= (Float)32767) {
+    return 32767;
+  }
+  if (scaled <= (Float)-32768) {
+    return -32768;
+  }
+  return (int16_t)scaled;
+}
+
+}  // namespace
+
+RiffParser::Status RiffParser::parse(const ReadFunction& read, uint64_t available) {
+  if (error_ != Status::kOk) {
+    return error_;
+  }
+  available_ = available;
+
+  if (!header_parsed_) {
+    uint8_t header[12];
+    if (available < sizeof(header) || read(0, header, sizeof(header)) != sizeof(header)) {
+      return Status::kNeedMoreData;
+    }
+    if (memcmp(header + 8, "WAVE", 4) != 0) {
+      return error_ = Status::kNotWave;
+    }
+    if (memcmp(header, "RF64", 4) == 0 || memcmp(header, "BW64", 4) == 0) {
+      rf64_ = true;
+    } else if (memcmp(header, "RIFF", 4) != 0) {
+      return error_ = Status::kNotWave;
+    }
+    header_parsed_ = true;
+    next_offset_ = sizeof(header);
+  }
+
+  while (next_offset_ <= available && available - next_offset_ >= 8) {
+    uint8_t header[8];
+    if (read(next_offset_, header, sizeof(header)) != sizeof(header)) {
+      break;
+    }
+    RiffChunk chunk;
+    chunk.id.assign(reinterpret_cast<const char*>(header), 4);
+    chunk.offset = next_offset_ + sizeof(header);
+    chunk.size = read_le32(header + 4);
+
+    if (rf64_) {
+      if (chunks_.empty() && chunk.id != "ds64") {
+        return error_ = Status::kMalformed;
+      }
+      if (chunk.size == kSizeInDs64) {
+        if (chunk.id == "data") {
+          chunk.size = ds64_data_size_;
+        } else {
+          for (const RiffChunk& entry : ds64_table_) {
+            if (entry.id == chunk.id) {
+              chunk.size = entry.size;
+              break;
+            }
+          }
+        }
+      }
+    }
+    if (chunk.size > std::numeric_limits<uint64_t>::max() - chunk.offset - 1) {
+      return error_ = Status::kMalformed;
+    }
+
+    if (chunk.id == "ds64" || chunk.id == "fmt ") {
+      // Parsed whole, so wait until all of it is there
+      if (chunk.size > available - chunk.offset) {
+        break;
+      }
+      const Status status = chunk.id == "ds64" ? parse_ds64(read, chunk.offset, chunk.size)
+                                               : parse_format(read, chunk.offset, chunk.size);
+      if (status != Status::kOk) {
+        return error_ = status;
+      }
+    } else if (chunk.id == "data" && data_index_ < 0) {
+      if (!have_format_) {
+        return error_ = Status::kMalformed;
+      }
+      data_index_ = (int)chunks_.size();
+    }
+
+    chunks_.push_back(chunk);
+    next_offset_ = chunk.offset + chunk.size + (chunk.size & 1);
+  }
+  return result();
+}
+
+const RiffChunk* RiffParser::find(const char* id) const {
+  for (const RiffChunk& chunk : chunks_) {
+    if (chunk.id == id) {
+      return &chunk;
+    }
+  }
+  return nullptr;
+}
+
+uint64_t RiffParser::data_offset() const {
+  return data_index_ < 0 ? 0 : chunks_[(size_t)data_index_].offset;
+}
+
+uint64_t RiffParser::frames() const {
+  if (data_index_ < 0 || format_.block_align == 0) {
+    return 0;
+  }
+  const RiffChunk& data = chunks_[(size_t)data_index_];
+  const uint64_t present = available_ > data.offset ? available_ - data.offset : 0;
+  return std::min(data.size, present) / format_.block_align;
+}
+
+RiffParser::Status RiffParser::parse_ds64(const ReadFunction& read, uint64_t offset,
+                                          uint64_t size) {
+  if (!rf64_ || !chunks_.empty()) {
+    return Status::kOk;  // Only meaningful as the first chunk of RF64
+  }
+  if (size < 28) {
+    return Status::kMalformed;
+  }
+  std::vector<uint8_t> body((size_t)std::min(size, kMaxDs64Bytes));
+  if (read(offset, body.data(), body.size()) != body.size()) {
+    return Status::kMalformed;
+  }
+  ds64_data_size_ = read_le64(&body[8]);
+  const uint32_t table_length = read_le32(&body[24]);
+  for (size_t entry = 28; entry + 12 <= body.size() && ds64_table_.size() < table_length;
+       entry += 12) {
+    RiffChunk chunk;
+    chunk.id.assign(reinterpret_cast<const char*>(&body[entry]), 4);
+    chunk.size = read_le64(&body[entry + 4]);
+    ds64_table_.push_back(chunk);
+  }
+  return Status::kOk;
+}
+
+RiffParser::Status RiffParser::parse_format(const ReadFunction& read, uint64_t offset,
+                                            uint64_t size) {
+  if (size < 16 || size > kMaxFormatBytes) {
+    return Status::kMalformed;
+  }
+  format_.chunk.resize((size_t)size);
+  if (read(offset, format_.chunk.data(), format_.chunk.size()) != format_.chunk.size()) {
+    return Status::kMalformed;
+  }
+  const uint8_t* fmt = format_.chunk.data();
+  format_.format_tag = read_le16(fmt);
+  format_.channels = read_le16(fmt + 2);
+  format_.sample_rate = read_le32(fmt + 4);
+  format_.block_align = read_le16(fmt + 12);
+  format_.bits_per_sample = read_le16(fmt + 14);
+  format_.valid_bits_per_sample = format_.bits_per_sample;
+  format_.channel_mask = 0;
+
+  uint16_t tag = format_.format_tag;
+  if (tag == kFormatExtensible) {
+    if (size < 40 || memcmp(fmt + 26, kSubformatTail, sizeof(kSubformatTail)) != 0) {
+      return Status::kUnsupported;
+    }
+    if (read_le16(fmt + 18) != 0) {
+      format_.valid_bits_per_sample = read_le16(fmt + 18);
+    }
+    format_.channel_mask = read_le32(fmt + 20);
+    tag = read_le16(fmt + 24);
+  }
+
+  const uint16_t bits = format_.bits_per_sample;
+  if (tag == kFormatPcm && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) {
+    format_.sample_format = WavSampleFormat::kPcm;
+  } else if (tag == kFormatFloat && (bits == 32 || bits == 64)) {
+    format_.sample_format = WavSampleFormat::kFloat;
+  } else {
+    return Status::kUnsupported;
+  }
+  if (format_.channels == 0 || format_.sample_rate == 0 ||
+      format_.valid_bits_per_sample > bits ||
+      format_.block_align != format_.channels * (bits / 8)) {
+    return Status::kMalformed;
+  }
+  have_format_ = true;
+  return Status::kOk;
+}
+
+RiffParser::Status RiffParser::result() const {
+  return have_format_ && data_index_ >= 0 ? Status::kOk : Status::kNeedMoreData;
+}
+
+void wav_samples_to_s16(const WavFormat& format, const uint8_t* in, size_t frames, int16_t* out) {
+  const size_t samples = frames * format.channels;
+  if (format.sample_format == WavSampleFormat::kFloat) {
+    if (format.bits_per_sample == 32) {
+      for (size_t i = 0; i < samples; i++, in += 4) {
+        float value;
+        memcpy(&value, in, sizeof(value));
+        out[i] = float_to_s16(value);
+      }
+    } else {
+      for (size_t i = 0; i < samples; i++, in += 8) {
+        double value;
+        memcpy(&value, in, sizeof(value));
+        out[i] = float_to_s16(value);
+      }
+    }
+    return;
+  }
+
+  switch (format.bits_per_sample) {
+    case 8:
+      for (size_t i = 0; i < samples; i++) {
+        out[i] = (int16_t)((in[i] - 128) * 256);
+      }
+      break;
+    case 16:
+      for (size_t i = 0; i < samples; i++, in += 2) {
+        out[i] = (int16_t)read_le16(in);
+      }
+      break;
+    case 24:
+      for (size_t i = 0; i < samples; i++, in += 3) {
+        out[i] = (int16_t)read_le16(in + 1);
+      }
+      break;
+    case 32:
+      for (size_t i = 0; i < samples; i++, in += 4) {
+        out[i] = (int16_t)read_le16(in + 2);
+      }
+      break;
+  }
+}
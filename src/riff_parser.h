@@ -0,0 +1,109 @@
+#ifndef FLUTTER_PLUGIN_RIFF_PARSER_H_
+#define FLUTTER_PLUGIN_RIFF_PARSER_H_
+
+// Platform-neutral RIFF/WAVE parsing shared by the Linux and Windows
+// plugins. Nothing here depends on the OS or on the plugin.
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// How the samples of a data chunk are encoded.
+enum class WavSampleFormat {
+  kPcm,    // Little-endian integers; unsigned at 8 bits, signed otherwise
+  kFloat,  // Little-endian IEEE float, 32 or 64 bits
+};
+
+// The fmt chunk of a WAVE file, with WAVE_FORMAT_EXTENSIBLE resolved to its
+// sub-format.
+struct WavFormat {
+  uint16_t format_tag = 0;  // As stored, 0xFFFE for WAVE_FORMAT_EXTENSIBLE
+  WavSampleFormat sample_format = WavSampleFormat::kPcm;
+  uint16_t channels = 0;
+  uint32_t sample_rate = 0;
+  uint16_t block_align = 0;
+  uint16_t bits_per_sample = 0;        // Container size of one sample
+  uint16_t valid_bits_per_sample = 0;  // Significant bits, at most the above
+  uint32_t channel_mask = 0;           // Speaker positions; 0 when not given
+
+  // The raw chunk body, for callers that hand it to an OS API as-is.
+  std::vector<uint8_t> chunk;
+
+  bool is_pcm16() const { return sample_format == WavSampleFormat::kPcm && bits_per_sample == 16; }
+};
+
+// One chunk of the file. Sizes come from the ds64 chunk in RF64 files.
+struct RiffChunk {
+  std::string id;
+  uint64_t offset = 0;  // Of the chunk body
+  uint64_t size = 0;    // Of the body as declared, before padding
+};
+
+// Parses the headers of a RIFF/WAVE, RF64 or BW64 file into a chunk index
+// and its sample format, reading only chunk headers and the small chunks it
+// needs (fmt and ds64) through a caller-supplied read function, so a
+// multi-gigabyte recording costs a handful of small reads.
+//
+// Parsing is incremental: when a header lies beyond the bytes available,
+// parse() returns kNeedMoreData and can be called again with a larger size,
+// for a file that is still being downloaded or recorded. It resumes at the
+// first chunk it has not indexed yet.
+class RiffParser {
+ public:
+  enum class Status {
+    kOk,            // fmt and data found; chunks after data are indexed as they arrive
+    kNeedMoreData,  // The headers continue past |available|; truncated if the file is complete
+    kNotWave,       // Not a RIFF, RF64 or BW64 WAVE file
+    kUnsupported,   // A WAVE file whose samples are not PCM or float (e.g. ADPCM)
+    kMalformed,     // Inconsistent headers
+  };
+
+  // Copies up to |count| bytes at |offset| into |out| and returns how many
+  // were copied.
+  typedef std::function<size_t(uint64_t offset, void* out, size_t count)> ReadFunction;
+
+  // Parses as far as the first |available| bytes of the file allow.
+  Status parse(const ReadFunction& read, uint64_t available);
+
+  const WavFormat& format() const { return format_; }
+  const std::vector<RiffChunk>& chunks() const { return chunks_; }
+
+  // The first chunk named |id|, or nullptr.
+  const RiffChunk* find(const char* id) const;
+
+  bool is_rf64() const { return rf64_; }
+
+  // Where the samples start, and how many whole frames of them lie within
+  // the bytes available at the last parse(). A data chunk that claims more
+  // than that is cut short.
+  uint64_t data_offset() const;
+  uint64_t frames() const;
+
+ private:
+  Status parse_ds64(const ReadFunction& read, uint64_t offset, uint64_t size);
+  Status parse_format(const ReadFunction& read, uint64_t offset, uint64_t size);
+  Status result() const;
+
+  bool header_parsed_ = false;
+  bool rf64_ = false;
+  bool have_format_ = false;
+  uint64_t available_ = 0;
+  uint64_t next_offset_ = 0;  // Header of the next chunk to index
+  int data_index_ = -1;
+  Status error_ = Status::kOk;
+  WavFormat format_;
+  std::vector<RiffChunk> chunks_;
+
+  // From the ds64 chunk of an RF64 file
+  uint64_t ds64_data_size_ = 0;
+  std::vector<RiffChunk> ds64_table_;
+};
+
+// Converts |frames| frames of |format| samples at |in| to interleaved
+// signed 16-bit samples, keeping the top 16 bits of wider integers and
+// clamping floats. |in| needs no particular alignment.
+void wav_samples_to_s16(const WavFormat& format, const uint8_t* in, size_t frames, int16_t* out);
+
+#endif  // FLUTTER_PLUGIN_RIFF_PARSER_H_
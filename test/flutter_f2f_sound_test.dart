@@ -1,3 +1,4 @@
+import 'package:flutter/foundation.dart';
 import 'package:flutter_test/flutter_test.dart';
 import 'package:flutter_f2f_sound/flutter_f2f_sound.dart';
 import 'package:flutter_f2f_sound/flutter_f2f_sound_platform_interface.dart';
@@ -15,8 +16,98 @@ class MockFlutterF2fSoundPlatform
     required String path,
     double volume = 1.0,
     bool loop = false,
+    int? latencyMs,
+    int? prebufferMs,
   }) => Future.value();
 
+  @override
+  Future<void> playBytes(
+    Uint8List bytes, {
+    String? mimeHint,
+    double volume = 1.0,
+    int? latencyMs,
+  }) => Future.value();
+
+  @override
+  Future<int> openPcmSink({
+    required int sampleRate,
+    int channels = 1,
+    PcmSampleFormat format = PcmSampleFormat.int16,
+    int targetLatencyMs = 40,
+    int? maxLatencyMs,
+    double volume = 1.0,
+    int? latencyMs,
+  }) => Future.value(1);
+
+  @override
+  Future<int> feedPcmSink(int handle, TypedData samples) =>
+      Future.value(samples.lengthInBytes);
+
+  @override
+  Future<void> closePcmSink(int handle) => Future.value();
+
+  @override
+  Future<Map<String, int>> getPcmSinkStats(int handle) =>
+      Future.value(const {});
+
+  @override
+  Future<void> startMixer({int sampleRate = 48000, int? latencyMs}) =>
+      Future.value();
+
+  @override
+  Future<void> stopMixer() => Future.value();
+
+  @override
+  Future<int> playSound(
+    String path, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) => Future.value(1);
+
+  @override
+  Future<bool> setVoice(
+    int voice, {
+    double? gain,
+    double? pan,
+    double? rate,
+    bool? loop,
+  }) => Future.value(true);
+
+  @override
+  Future<bool> stopVoice(int voice) => Future.value(true);
+
+  @override
+  Future<void> stopAllVoices() => Future.value();
+
+  @override
+  Future<bool> isVoicePlaying(int voice) => Future.value(false);
+
+  @override
+  Future<Map<String, int>> getMixerStats() => Future.value(const {});
+
+  @override
+  Future<int> loadSample(String path) => Future.value(1);
+
+  @override
+  Future<int> triggerSample(
+    int id, {
+    double gain = 1.0,
+    double pan = 0.0,
+    double rate = 1.0,
+    bool loop = false,
+  }) => Future.value(1);
+
+  @override
+  Future<bool> unloadSample(int id) => Future.value(true);
+
+  @override
+  Future<void> setSampleBankBudget(int bytes) => Future.value();
+
+  @override
+  Future<Map<String, int>> getSampleBankStats() => Future.value(const {});
+
   @override
   Future<void> pause() => Future.value();
 
@@ -26,6 +117,9 @@ class MockFlutterF2fSoundPlatform
   @override
   Future<void> resume() => Future.value();
 
+  @override
+  Future<void> seek(double position) => Future.value();
+
   @override
   Future<void> setVolume(double volume) => Future.value();
 
@@ -39,7 +133,14 @@ class MockFlutterF2fSoundPlatform
   Future<double> getDuration(String path) => Future.value(0.0);
 
   @override
-  Stream<List<int>> startRecording() async* {
+  Stream<List<int>> startRecording({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
     yield* Stream.empty();
   }
 
@@ -52,7 +153,60 @@ class MockFlutterF2fSoundPlatform
   }
 
   @override
-  Stream<List<int>> startSystemSoundCapture() async* {
+  Stream<List<int>> startSystemSoundCapture({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
+    yield* Stream.empty();
+  }
+
+  @override
+  Stream<PlaybackStateEvent> playbackStateEvents() => const Stream.empty();
+
+  @override
+  Future<double> getPlaybackLatency() => Future.value(0.0);
+
+  @override
+  Future<Map<String, int>> getDroppedFrames() => Future.value(const {});
+
+  @override
+  Future<void> setPcmCacheBudget(int bytes) => Future.value();
+
+  @override
+  Future<Map<String, int>> getPcmCacheStats() => Future.value(const {});
+
+  @override
+  Future<bool> preconnect(String url) => Future.value(true);
+
+  @override
+  Future<void> startRecordingToRing({int? ringCapacityBytes}) =>
+      Future.value();
+
+  @override
+  Future<void> startSystemSoundCaptureToRing({int? ringCapacityBytes}) =>
+      Future.value();
+
+  @override
+  Stream<Float32List> startRecordingFloat32({
+    int? sampleRate,
+    int? channels,
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
+    yield* Stream.empty();
+  }
+
+  @override
+  Stream<Float32List> startSystemSoundCaptureFloat32({
+    int? fragmentMs,
+    int? packetDurationMs,
+    int? maxQueuedPackets,
+    CaptureOverflowPolicy? overflowPolicy,
+  }) async* {
     yield* Stream.empty();
   }
 }
@@ -26,6 +26,7 @@
 
 // For std::min and std::max
 #include <algorithm>
+#include <chrono>
 
 #include <flutter/method_channel.h>
 #include <flutter/plugin_registrar_windows.h>
@@ -40,6 +41,12 @@
 #include <fstream>
 #include <string>
 
+#include <cerrno>
+#include <io.h>
+#include <share.h>
+
+#include "riff_parser.h"
+
 // Link against required libraries
 #pragma comment(lib, "ole32.lib")
 #pragma comment(lib, "oleaut32.lib")
@@ -51,6 +58,20 @@
 
 namespace flutter_f2f_sound {
 
+// Disk space for downloaded audio kept between plays.
+constexpr uint64_t kAudioCacheBytes = 256ull * 1024 * 1024;
+
+// Downloads at least this large are split into kDownloadSegments parallel
+// range requests when the server accepts ranges.
+constexpr DWORD kSegmentedDownloadBytes = 8 * 1024 * 1024;
+constexpr DWORD kDownloadSegments = 4;
+constexpr DWORD kDownloadBufferBytes = 256 * 1024;
+
+// Longest a capture thread waits for the platform thread under the "block"
+// overflow policy before it drops the packet. Longer stalls would overrun
+// the WASAPI capture buffer anyway.
+constexpr std::chrono::milliseconds kMaxBlockWait(200);
+
 // static
 void FlutterF2fSoundPlugin::RegisterWithRegistrar(
     flutter::PluginRegistrarWindows *registrar) {
@@ -193,6 +214,11 @@ FlutterF2fSoundPlugin::~FlutterF2fSoundPlugin() {
     device_enumerator_ = nullptr;
   }
 
+  if (http_session_) {
+    WinHttpCloseHandle(http_session_);
+    http_session_ = nullptr;
+  }
+
   // Shutdown Media Foundation
   MFShutdown();
 }
@@ -232,6 +258,8 @@ void FlutterF2fSoundPlugin::HandleMethodCall(
       if (channels_it != args->end()) {
         config.channels = std::get<int>(channels_it->second);
       }
+
+      ParseCaptureOptions(*args, config);
     }
 
     HRESULT hr = InitializeWASAPI(config);
@@ -255,6 +283,11 @@ void FlutterF2fSoundPlugin::HandleMethodCall(
     config.sample_rate = 44100;
     config.channels = 2;  // Stereo for system sound
 
+    const auto* args = std::get_if<flutter::EncodableMap>(method_call.arguments());
+    if (args) {
+      ParseCaptureOptions(*args, config);
+    }
+
     HRESULT hr = InitializeSystemSoundWASAPI(config);
     if (SUCCEEDED(hr)) {
       StartSystemSoundThread();
@@ -262,6 +295,15 @@ void FlutterF2fSoundPlugin::HandleMethodCall(
     } else {
       result->Error("SYSTEM_SOUND_CAPTURE_ERROR", "Failed to initialize WASAPI for system sound capture");
     }
+  } else if (method_call.method_name().compare("getDroppedFrames") == 0) {
+    flutter::EncodableMap dropped;
+    dropped[flutter::EncodableValue("recording")] =
+        flutter::EncodableValue(static_cast<int64_t>(recording_queue_.dropped_frames.load()));
+    dropped[flutter::EncodableValue("systemSound")] =
+        flutter::EncodableValue(static_cast<int64_t>(system_sound_queue_.dropped_frames.load()));
+    // The playback stream sends every chunk it reads, so it never drops
+    dropped[flutter::EncodableValue("playback")] = flutter::EncodableValue(static_cast<int64_t>(0));
+    result->Success(flutter::EncodableValue(dropped));
   } else if (method_call.method_name().compare("play") == 0) {
     StopPlayback();
 
@@ -272,6 +314,13 @@ void FlutterF2fSoundPlugin::HandleMethodCall(
       auto volume = std::get<double>(args->at(flutter::EncodableValue("volume")));
       auto loop = std::get<bool>(args->at(flutter::EncodableValue("loop")));
 
+      int latency_ms = 0;
+      auto latency_it = args->find(flutter::EncodableValue("latencyMs"));
+      if (latency_it != args->end()) {
+        const auto* latency = std::get_if<int>(&latency_it->second);
+        latency_ms = latency && *latency > 0 ? *latency : 0;
+      }
+
       current_volume_ = volume;
       is_looping_ = loop;
 
@@ -286,7 +335,7 @@ void FlutterF2fSoundPlugin::HandleMethodCall(
       current_playback_path_ = path;
 
       // Initialize playback first (this is fast)
-      HRESULT hr = InitializePlaybackWASAPI();
+      HRESULT hr = InitializePlaybackWASAPI(latency_ms);
       if (SUCCEEDED(hr)) {
         sprintf_s(debug_msg, sizeof(debug_msg), "WASAPI initialized successfully, starting playback thread\n");
         OutputDebugStringA(debug_msg);
@@ -306,6 +355,8 @@ void FlutterF2fSoundPlugin::HandleMethodCall(
     }
 
     result->Error("INVALID_ARGS", "Invalid arguments for play");
+  } else if (method_call.method_name().compare("getPlaybackLatency") == 0) {
+    result->Success(flutter::EncodableValue(playback_latency_ms_.load()));
   } else if (method_call.method_name().compare("pause") == 0) {
     if (is_playing_ && !is_paused_) {
       is_paused_ = true;
@@ -408,6 +459,7 @@ void FlutterF2fSoundPlugin::OnCancelSystemSound(const flutter::EncodableValue *a
   // Stop system sound capture
   if (is_capturing_system_sound_) {
     is_capturing_system_sound_ = false;
+    CloseEventQueue(system_sound_queue_);
     if (system_sound_thread_.joinable()) {
       system_sound_thread_.join();
     }
@@ -433,18 +485,12 @@ void FlutterF2fSoundPlugin::OnCancelPlaybackStream(const flutter::EncodableValue
   }
 }
 
-void FlutterF2fSoundPlugin::ProcessPlaybackStreamData(const std::vector<uint8_t>& audio_data) {
+void FlutterF2fSoundPlugin::ProcessPlaybackStreamData(std::vector<uint8_t>&& audio_data) {
   std::lock_guard<std::mutex> lock(playback_stream_mutex_);
   
   if (playback_stream_event_sink_ && !audio_data.empty()) {
-    // Create EncodableList from audio data
-    flutter::EncodableList encodable_audio_data;
-    for (uint8_t byte : audio_data) {
-      encodable_audio_data.push_back(static_cast<int>(byte));
-    }
-    
-    // Send data to Flutter (now on platform thread)
-    playback_stream_event_sink_->Success(flutter::EncodableValue(encodable_audio_data));
+    // Send data to Flutter as a single Uint8List
+    playback_stream_event_sink_->Success(flutter::EncodableValue(std::move(audio_data)));
   } else {
     if (!playback_stream_event_sink_) {
       OutputDebugStringA("ProcessPlaybackStreamData: No event sink!");
@@ -511,6 +557,223 @@ bool FlutterF2fSoundPlugin::IsFormatSupported(const WAVEFORMATEX* format, IMMDev
   return (hr == S_OK || hr == AUDCLNT_E_UNSUPPORTED_FORMAT);  // Accept if format is close enough
 }
 
+bool FlutterF2fSoundPlugin::IsFloatFormat(const WAVEFORMATEX* format) {
+  if (format->wFormatTag == WAVE_FORMAT_IEEE_FLOAT) {
+    return true;
+  }
+  if (format->wFormatTag == WAVE_FORMAT_EXTENSIBLE) {
+    const auto* format_extensible = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(format);
+    return IsEqualGUID(format_extensible->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) != FALSE;
+  }
+  return false;
+}
+
+flutter::EncodableValue FlutterF2fSoundPlugin::CreateCapturePacket(const BYTE* data, UINT32 frames,
+                                                                   const WAVEFORMATEX* format,
+                                                                   bool float32_output) {
+  const size_t byte_count = static_cast<size_t>(frames) * format->nBlockAlign;
+  if (!float32_output) {
+    return flutter::EncodableValue(std::vector<uint8_t>(data, data + byte_count));
+  }
+
+  const size_t sample_count = static_cast<size_t>(frames) * format->nChannels;
+  std::vector<float> samples(sample_count);
+  float* out = samples.data();
+
+  if (IsFloatFormat(format) && format->wBitsPerSample == 32) {
+    // The shared-mode mix format (always used for loopback) is already float32
+    memcpy(out, data, sample_count * sizeof(float));
+  } else if (format->wBitsPerSample == 16) {
+    const int16_t* in = reinterpret_cast<const int16_t*>(data);
+    for (size_t i = 0; i < sample_count; i++) {
+      out[i] = in[i] * (1.0f / 32768.0f);
+    }
+  } else if (format->wBitsPerSample == 32) {
+    const int32_t* in = reinterpret_cast<const int32_t*>(data);
+    for (size_t i = 0; i < sample_count; i++) {
+      out[i] = static_cast<float>(in[i] * (1.0 / 2147483648.0));
+    }
+  } else if (format->wBitsPerSample == 24) {
+    // Packed little-endian 24-bit samples
+    for (size_t i = 0; i < sample_count; i++) {
+      const BYTE* p = data + i * 3;
+      int32_t value = static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (p[2] << 24)) >> 8;
+      out[i] = value * (1.0f / 8388608.0f);
+    }
+  } else {
+    // Unsupported capture format: deliver silence rather than garbage
+    std::fill(samples.begin(), samples.end(), 0.0f);
+  }
+
+  return flutter::EncodableValue(std::move(samples));
+}
+
+void FlutterF2fSoundPlugin::ResetCoalescer(PacketCoalescer& coalescer, const AudioConfig& config,
+                                           const WAVEFORMATEX* format) {
+  coalescer.packet_frames = 0;
+  if (config.packet_duration_ms > 0) {
+    coalescer.packet_frames = static_cast<UINT32>(
+        static_cast<UINT64>(format->nSamplesPerSec) * config.packet_duration_ms / 1000);
+  }
+  coalescer.pending.clear();
+  coalescer.pending.reserve(static_cast<size_t>(coalescer.packet_frames) * format->nBlockAlign);
+}
+
+void FlutterF2fSoundPlugin::PostCapturePackets(UINT message, PacketCoalescer& coalescer,
+                                               EventQueue& queue, const BYTE* data, UINT32 frames,
+                                               const WAVEFORMATEX* format, bool float32_output) {
+  if (coalescer.packet_frames == 0) {
+    EnqueueCapturePacket(message, queue, CreateCapturePacket(data, frames, format, float32_output),
+                         frames);
+    return;
+  }
+
+  const size_t packet_bytes = static_cast<size_t>(coalescer.packet_frames) * format->nBlockAlign;
+  size_t length = static_cast<size_t>(frames) * format->nBlockAlign;
+
+  // Complete the packet left over from the previous WASAPI buffer first
+  if (!coalescer.pending.empty()) {
+    size_t take = (std::min)(packet_bytes - coalescer.pending.size(), length);
+    coalescer.pending.insert(coalescer.pending.end(), data, data + take);
+    data += take;
+    length -= take;
+    if (coalescer.pending.size() < packet_bytes) {
+      return;
+    }
+    EnqueueCapturePacket(message, queue,
+                         CreateCapturePacket(coalescer.pending.data(), coalescer.packet_frames,
+                                             format, float32_output),
+                         coalescer.packet_frames);
+    coalescer.pending.clear();
+  }
+
+  // Whole packets are built straight from the WASAPI buffer
+  while (length >= packet_bytes) {
+    EnqueueCapturePacket(message, queue,
+                         CreateCapturePacket(data, coalescer.packet_frames, format, float32_output),
+                         coalescer.packet_frames);
+    data += packet_bytes;
+    length -= packet_bytes;
+  }
+
+  coalescer.pending.assign(data, data + length);
+}
+
+void FlutterF2fSoundPlugin::ParseCaptureOptions(const flutter::EncodableMap& args,
+                                                AudioConfig& config) {
+  auto format_it = args.find(flutter::EncodableValue("format"));
+  if (format_it != args.end()) {
+    const auto* format = std::get_if<std::string>(&format_it->second);
+    config.float32_output = format && *format == "float32";
+  }
+
+  auto packet_duration_it = args.find(flutter::EncodableValue("packetDurationMs"));
+  if (packet_duration_it != args.end()) {
+    const auto* packet_duration = std::get_if<int>(&packet_duration_it->second);
+    config.packet_duration_ms = packet_duration ? *packet_duration : 0;
+  }
+
+  auto fragment_it = args.find(flutter::EncodableValue("fragmentMs"));
+  if (fragment_it != args.end()) {
+    const auto* fragment = std::get_if<int>(&fragment_it->second);
+    if (fragment && *fragment > 0) {
+      config.fragment_ms = *fragment;
+    }
+  }
+
+  auto max_queued_it = args.find(flutter::EncodableValue("maxQueuedPackets"));
+  if (max_queued_it != args.end()) {
+    const auto* max_queued = std::get_if<int>(&max_queued_it->second);
+    if (max_queued && *max_queued > 0) {
+      config.max_queued_packets = static_cast<size_t>(*max_queued);
+    }
+  }
+
+  auto policy_it = args.find(flutter::EncodableValue("overflowPolicy"));
+  if (policy_it != args.end()) {
+    const auto* policy = std::get_if<std::string>(&policy_it->second);
+    if (policy && *policy == "dropNewest") {
+      config.overflow_policy = OverflowPolicy::kDropNewest;
+    } else if (policy && *policy == "block") {
+      config.overflow_policy = OverflowPolicy::kBlock;
+    } else {
+      config.overflow_policy = OverflowPolicy::kDropOldest;
+    }
+  }
+}
+
+void FlutterF2fSoundPlugin::ResetEventQueue(EventQueue& queue, const AudioConfig& config) {
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  queue.max_packets = config.max_queued_packets;
+  queue.policy = config.overflow_policy;
+  queue.packets.clear();
+  queue.wake_posted = false;
+  queue.closed = false;
+  queue.dropped_frames = 0;
+}
+
+void FlutterF2fSoundPlugin::CloseEventQueue(EventQueue& queue) {
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.closed = true;
+    queue.packets.clear();
+  }
+  queue.space_available.notify_all();
+}
+
+void FlutterF2fSoundPlugin::EnqueueCapturePacket(UINT message, EventQueue& queue,
+                                                 flutter::EncodableValue&& packet,
+                                                 UINT32 frames) {
+  bool post_wake = false;
+  {
+    std::unique_lock<std::mutex> lock(queue.mutex);
+
+    if (!queue.closed && queue.packets.size() >= queue.max_packets) {
+      if (queue.policy == OverflowPolicy::kBlock) {
+        // Bounded, so a platform thread that stops draining cannot hang
+        // the capture thread
+        if (!queue.space_available.wait_for(lock, kMaxBlockWait, [&queue]() {
+              return queue.closed || queue.packets.size() < queue.max_packets;
+            })) {
+          queue.dropped_frames += frames;
+          return;
+        }
+      } else if (queue.policy == OverflowPolicy::kDropOldest) {
+        queue.dropped_frames += queue.packets.front().frames;
+        queue.packets.pop_front();
+      } else {
+        queue.dropped_frames += frames;
+        return;
+      }
+    }
+
+    if (queue.closed) {
+      return;
+    }
+
+    queue.packets.push_back({std::move(packet), frames});
+    if (!queue.wake_posted) {
+      queue.wake_posted = true;
+      post_wake = true;
+    }
+  }
+
+  if (post_wake) {
+    PostMessage(message_window_, message, 0, 0);
+  }
+}
+
+std::deque<EventQueue::Packet> FlutterF2fSoundPlugin::TakeQueuedPackets(EventQueue& queue) {
+  std::deque<EventQueue::Packet> packets;
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    packets.swap(queue.packets);
+    queue.wake_posted = false;
+  }
+  queue.space_available.notify_all();
+  return packets;
+}
+
 HRESULT FlutterF2fSoundPlugin::InitializeWASAPI(const AudioConfig& config) {
   HRESULT hr = S_OK;
 
@@ -581,7 +844,7 @@ HRESULT FlutterF2fSoundPlugin::InitializeWASAPI(const AudioConfig& config) {
   hr = audio_client_->Initialize(
       AUDCLNT_SHAREMODE_SHARED,
       stream_flags,
-      hns_requested_duration_, 0,
+      static_cast<REFERENCE_TIME>(config.fragment_ms) * 10000, 0,
       wave_format_, NULL);
 
   if (FAILED(hr)) {
@@ -621,6 +884,8 @@ HRESULT FlutterF2fSoundPlugin::InitializeWASAPI(const AudioConfig& config) {
 
 void FlutterF2fSoundPlugin::StartRecordingThread() {
   is_recording_ = true;
+  ResetCoalescer(recording_coalescer_, recording_config_, wave_format_);
+  ResetEventQueue(recording_queue_, recording_config_);
 
   recording_thread_ = std::thread([this]() {
     // Set thread priority
@@ -665,16 +930,12 @@ void FlutterF2fSoundPlugin::StartRecordingThread() {
         }
 
         if (data && num_frames_available > 0) {
-          // Calculate buffer size in bytes
-          UINT32 buffer_size = num_frames_available * wave_format_->nBlockAlign;
-
           // Check for silence
           if (!(flags & AUDCLNT_BUFFERFLAGS_SILENT)) {
             // Copy audio data and send to platform thread via message
-            std::vector<uint8_t>* audio_data = new std::vector<uint8_t>(data, data + buffer_size);
-
-            // Post message to platform thread
-            PostMessage(message_window_, WM_RECORDING_DATA, 0, reinterpret_cast<LPARAM>(audio_data));
+            PostCapturePackets(WM_RECORDING_DATA, recording_coalescer_, recording_queue_, data,
+                               num_frames_available, wave_format_,
+                               recording_config_.float32_output);
           }
         }
 
@@ -700,6 +961,7 @@ void FlutterF2fSoundPlugin::StartRecordingThread() {
 void FlutterF2fSoundPlugin::StopRecording() {
   if (is_recording_) {
     is_recording_ = false;
+    CloseEventQueue(recording_queue_);
     if (recording_thread_.joinable()) {
       recording_thread_.join();
     }
@@ -749,6 +1011,9 @@ HRESULT FlutterF2fSoundPlugin::InitializeSystemSoundWASAPI(const AudioConfig& co
   // Cleanup any existing system sound WASAPI resources
   CleanupSystemSoundWASAPI();
 
+  // Store configuration
+  system_sound_config_ = config;
+
   // Get default audio endpoint for loopback recording (render device)
   ERole role = eConsole;
   hr = device_enumerator_->GetDefaultAudioEndpoint(eRender, role, &system_sound_device_);
@@ -805,7 +1070,7 @@ HRESULT FlutterF2fSoundPlugin::InitializeSystemSoundWASAPI(const AudioConfig& co
   hr = system_sound_audio_client_->Initialize(
       AUDCLNT_SHAREMODE_SHARED,
       AUDCLNT_STREAMFLAGS_LOOPBACK | AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
-      hns_requested_duration_,  // 1 second
+      static_cast<REFERENCE_TIME>(config.fragment_ms) * 10000,
       0,
       system_sound_wave_format_, NULL);
 
@@ -863,6 +1128,8 @@ HRESULT FlutterF2fSoundPlugin::InitializeSystemSoundWASAPI(const AudioConfig& co
 
 void FlutterF2fSoundPlugin::StartSystemSoundThread() {
   is_capturing_system_sound_ = true;
+  ResetCoalescer(system_sound_coalescer_, system_sound_config_, system_sound_wave_format_);
+  ResetEventQueue(system_sound_queue_, system_sound_config_);
 
   system_sound_thread_ = std::thread([this]() {
     char debug_msg[512];
@@ -938,10 +1205,9 @@ void FlutterF2fSoundPlugin::StartSystemSoundThread() {
           // Only send non-silent data
           if (!is_silence) {
             // Copy audio data and send to platform thread via message
-            std::vector<uint8_t>* audio_data = new std::vector<uint8_t>(data, data + buffer_size);
-
-            // Post message to platform thread
-            PostMessage(message_window_, WM_SYSTEM_SOUND_DATA, 0, reinterpret_cast<LPARAM>(audio_data));
+            PostCapturePackets(WM_SYSTEM_SOUND_DATA, system_sound_coalescer_, system_sound_queue_,
+                               data, num_frames_available, system_sound_wave_format_,
+                               system_sound_config_.float32_output);
 
             if (packet_count % 100 == 0) {
               sprintf_s(debug_msg, sizeof(debug_msg), "System sound: sent non-silent packet %d, size: %d bytes\n",
@@ -986,6 +1252,7 @@ void FlutterF2fSoundPlugin::StartSystemSoundThread() {
 void FlutterF2fSoundPlugin::StopSystemSoundCapture() {
   if (is_capturing_system_sound_) {
     is_capturing_system_sound_ = false;
+    CloseEventQueue(system_sound_queue_);
     if (system_sound_thread_.joinable()) {
       system_sound_thread_.join();
     }
@@ -1024,7 +1291,7 @@ HRESULT FlutterF2fSoundPlugin::CleanupSystemSoundWASAPI() {
   return S_OK;
 }
 
-HRESULT FlutterF2fSoundPlugin::InitializePlaybackWASAPI() {
+HRESULT FlutterF2fSoundPlugin::InitializePlaybackWASAPI(int latency_ms) {
   HRESULT hr = S_OK;
 
   // Cleanup any existing playback resources
@@ -1054,7 +1321,8 @@ HRESULT FlutterF2fSoundPlugin::InitializePlaybackWASAPI() {
   }
 
   // Initialize audio client for playback
-  REFERENCE_TIME requested_duration = 10000000;  // 1 second
+  REFERENCE_TIME requested_duration =
+      latency_ms > 0 ? static_cast<REFERENCE_TIME>(latency_ms) * 10000 : 10000000;
   hr = playback_audio_client_->Initialize(
       AUDCLNT_SHAREMODE_SHARED,
       0,  // No special flags for playback
@@ -1071,6 +1339,10 @@ HRESULT FlutterF2fSoundPlugin::InitializePlaybackWASAPI() {
     return hr;
   }
 
+  // The engine may round the requested duration up to its device period
+  playback_latency_ms_ = 1000.0 * playback_buffer_frame_count_ /
+                         playback_wave_format_->nSamplesPerSec;
+
   // Get render client
   hr = playback_audio_client_->GetService(
       __uuidof(IAudioRenderClient),
@@ -1121,103 +1393,121 @@ void FlutterF2fSoundPlugin::StartPlaybackThread() {
       playback_path = local_path;
     }
 
-    // Read audio file first
-    std::vector<uint8_t> audio_data;
-    WAVEFORMATEX* file_format = nullptr;
-
-    sprintf_s(debug_msg, sizeof(debug_msg), "Attempting to read audio file: %s\n", playback_path.c_str());
-    OutputDebugStringA(debug_msg);
+    // A WAV file already in the mix format plays straight from a mapped view
+    // of the file, with nothing read or copied up front
+    HRESULT hr = S_OK;
+    MappedWavFile mapped_wav;
+    std::vector<uint8_t> converted_data;
+    const uint8_t* play_data = nullptr;
+    size_t play_size = 0;
+    if (!IsMP3(playback_path) && MapWavFile(playback_path, mapped_wav) &&
+        WavFormatMatches(mapped_wav.Format(), playback_wave_format_)) {
+      sprintf_s(debug_msg, sizeof(debug_msg), "Format matches, playing %zu bytes from the mapped file\n",
+                mapped_wav.data_size);
+      OutputDebugStringA(debug_msg);
+      play_data = mapped_wav.data;
+      play_size = mapped_wav.data_size;
+    } else {
+      // Read audio file first
+      mapped_wav.Reset();
+      std::vector<uint8_t> audio_data;
+      WAVEFORMATEX* file_format = nullptr;
 
-    HRESULT hr = ReadAudioFile(playback_path, audio_data, &file_format);
-    if (FAILED(hr)) {
-      // Log error for debugging
-      sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read audio file, HRESULT: 0x%08X\n", hr);
+      sprintf_s(debug_msg, sizeof(debug_msg), "Attempting to read audio file: %s\n", playback_path.c_str());
       OutputDebugStringA(debug_msg);
-      is_playing_ = false;
-      if (file_format) {
-        CoTaskMemFree(file_format);
-      }
-      return;
-    }
 
-    sprintf_s(debug_msg, sizeof(debug_msg), "Successfully read audio file, size: %zu bytes\n", audio_data.size());
-    OutputDebugStringA(debug_msg);
+      hr = ReadAudioFile(playback_path, audio_data, &file_format);
+      if (FAILED(hr)) {
+        // Log error for debugging
+        sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read audio file, HRESULT: 0x%08X\n", hr);
+        OutputDebugStringA(debug_msg);
+        is_playing_ = false;
+        if (file_format) {
+          CoTaskMemFree(file_format);
+        }
+        return;
+      }
 
-    // Log file format details
-    if (file_format) {
-      sprintf_s(debug_msg, sizeof(debug_msg),
-        "File format: %d Hz, %d channels, %d bits, format tag: 0x%04X\n",
-        file_format->nSamplesPerSec,
-        file_format->nChannels,
-        file_format->wBitsPerSample,
-        file_format->wFormatTag);
+      sprintf_s(debug_msg, sizeof(debug_msg), "Successfully read audio file, size: %zu bytes\n", audio_data.size());
       OutputDebugStringA(debug_msg);
-    }
 
-    // Log playback device format details
-    sprintf_s(debug_msg, sizeof(debug_msg),
-      "Playback device format: %d Hz, %d channels, %d bits, format tag: 0x%04X\n",
-      playback_wave_format_->nSamplesPerSec,
-      playback_wave_format_->nChannels,
-      playback_wave_format_->wBitsPerSample,
-      playback_wave_format_->wFormatTag);
-    OutputDebugStringA(debug_msg);
-
-    if (audio_data.empty()) {
-      // Log error for debugging
-      OutputDebugStringA("Audio file is empty\n");
-      is_playing_ = false;
+      // Log file format details
       if (file_format) {
-        CoTaskMemFree(file_format);
+        sprintf_s(debug_msg, sizeof(debug_msg),
+          "File format: %d Hz, %d channels, %d bits, format tag: 0x%04X\n",
+          file_format->nSamplesPerSec,
+          file_format->nChannels,
+          file_format->wBitsPerSample,
+          file_format->wFormatTag);
+        OutputDebugStringA(debug_msg);
       }
-      return;
-    }
 
-    // Convert audio format if needed
-    std::vector<uint8_t> converted_data;
-    if (file_format) {
-      // Check if format conversion is needed
-      bool format_match =
-          (file_format->nChannels == playback_wave_format_->nChannels) &&
-          (file_format->nSamplesPerSec == playback_wave_format_->nSamplesPerSec) &&
-          (file_format->wBitsPerSample == playback_wave_format_->wBitsPerSample) &&
-          (file_format->wFormatTag == playback_wave_format_->wFormatTag);
-
-      sprintf_s(debug_msg, sizeof(debug_msg), "Format match: %d\n", format_match);
+      // Log playback device format details
+      sprintf_s(debug_msg, sizeof(debug_msg),
+        "Playback device format: %d Hz, %d channels, %d bits, format tag: 0x%04X\n",
+        playback_wave_format_->nSamplesPerSec,
+        playback_wave_format_->nChannels,
+        playback_wave_format_->wBitsPerSample,
+        playback_wave_format_->wFormatTag);
       OutputDebugStringA(debug_msg);
 
-      if (!format_match) {
-        OutputDebugStringA("Format mismatch detected, starting conversion...\n");
-        // Convert to playback format
-        hr = ConvertAudioFormat(file_format, audio_data, playback_wave_format_, converted_data);
-        if (FAILED(hr)) {
-          sprintf_s(debug_msg, sizeof(debug_msg), "Failed to convert audio format, HRESULT: 0x%08X\n", hr);
-          OutputDebugStringA(debug_msg);
-          is_playing_ = false;
+      if (audio_data.empty()) {
+        // Log error for debugging
+        OutputDebugStringA("Audio file is empty\n");
+        is_playing_ = false;
+        if (file_format) {
           CoTaskMemFree(file_format);
-          return;
         }
-        sprintf_s(debug_msg, sizeof(debug_msg), "Audio format converted successfully, size: %zu bytes\n", converted_data.size());
+        return;
+      }
+
+      // Convert audio format if needed
+      if (file_format) {
+        // Check if format conversion is needed
+        bool format_match =
+            (file_format->nChannels == playback_wave_format_->nChannels) &&
+            (file_format->nSamplesPerSec == playback_wave_format_->nSamplesPerSec) &&
+            (file_format->wBitsPerSample == playback_wave_format_->wBitsPerSample) &&
+            (file_format->wFormatTag == playback_wave_format_->wFormatTag);
+
+        sprintf_s(debug_msg, sizeof(debug_msg), "Format match: %d\n", format_match);
         OutputDebugStringA(debug_msg);
+
+        if (!format_match) {
+          OutputDebugStringA("Format mismatch detected, starting conversion...\n");
+          // Convert to playback format
+          hr = ConvertAudioFormat(file_format, audio_data, playback_wave_format_, converted_data);
+          if (FAILED(hr)) {
+            sprintf_s(debug_msg, sizeof(debug_msg), "Failed to convert audio format, HRESULT: 0x%08X\n", hr);
+            OutputDebugStringA(debug_msg);
+            is_playing_ = false;
+            CoTaskMemFree(file_format);
+            return;
+          }
+          sprintf_s(debug_msg, sizeof(debug_msg), "Audio format converted successfully, size: %zu bytes\n", converted_data.size());
+          OutputDebugStringA(debug_msg);
+        } else {
+          // Format matches, use original data
+          OutputDebugStringA("Format matches, using original data\n");
+          converted_data = std::move(audio_data);
+        }
+
+        CoTaskMemFree(file_format);
       } else {
-        // Format matches, use original data
-        OutputDebugStringA("Format matches, using original data\n");
+        // No format info, use raw data
         converted_data = std::move(audio_data);
       }
-
-      CoTaskMemFree(file_format);
-    } else {
-      // No format info, use raw data
-      converted_data = std::move(audio_data);
+      play_data = converted_data.data();
+      play_size = converted_data.size();
     }
 
-    if (converted_data.empty()) {
+    if (play_size == 0) {
       OutputDebugStringA("Converted audio data is empty\n");
       is_playing_ = false;
       return;
     }
 
-    sprintf_s(debug_msg, sizeof(debug_msg), "Audio data ready for playback, size: %zu bytes\n", converted_data.size());
+    sprintf_s(debug_msg, sizeof(debug_msg), "Audio data ready for playback, size: %zu bytes\n", play_size);
     OutputDebugStringA(debug_msg);
 
     // Set thread priority
@@ -1250,11 +1540,11 @@ void FlutterF2fSoundPlugin::StartPlaybackThread() {
 
     sprintf_s(debug_msg, sizeof(debug_msg),
       "Starting playback loop: bytes_per_frame=%u, samples_per_sec=%.0f, total_data_size=%zu\n",
-      bytes_per_frame, samples_per_second, converted_data.size());
+      bytes_per_frame, samples_per_second, play_size);
     OutputDebugStringA(debug_msg);
 
     // Calculate duration in seconds
-    double total_frames = static_cast<double>(converted_data.size()) / static_cast<double>(bytes_per_frame);
+    double total_frames = static_cast<double>(play_size) / static_cast<double>(bytes_per_frame);
     double duration = total_frames / samples_per_second;
     current_duration_ = duration;
 
@@ -1291,11 +1581,11 @@ void FlutterF2fSoundPlugin::StartPlaybackThread() {
 
       // Fill buffer with audio data
       UINT32 bytes_to_write = frames_to_write * bytes_per_frame;
-      UINT32 bytes_available = static_cast<UINT32>(converted_data.size() - data_index);
+      UINT32 bytes_available = static_cast<UINT32>(play_size - data_index);
 
       if (bytes_available > 0) {
         UINT32 bytes_to_copy = (bytes_to_write < bytes_available) ? bytes_to_write : bytes_available;
-        memcpy(buffer, &converted_data[data_index], bytes_to_copy);
+        memcpy(buffer, play_data + data_index, bytes_to_copy);
 
         // Log first few buffer writes
         if (buffer_write_count < 5) {
@@ -1439,7 +1729,6 @@ HRESULT FlutterF2fSoundPlugin::ReadAudioFile(const std::string& path, std::vecto
   sprintf_s(debug_msg, sizeof(debug_msg), "Using WAV parser for file: %s\n", path.c_str());
   OutputDebugStringA(debug_msg);
 
-  // Simple WAV file parser
   // Convert std::string to std::wstring for Windows file APIs
   int size_needed = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), (int)path.length(), NULL, 0);
   std::wstring wpath(size_needed, 0);
@@ -1453,185 +1742,160 @@ HRESULT FlutterF2fSoundPlugin::ReadAudioFile(const std::string& path, std::vecto
     OutputDebugStringA(debug_msg);
     return E_FAIL;
   }
+  _fseeki64(file, 0, SEEK_END);
+  const int64_t file_size = _ftelli64(file);
 
-  sprintf_s(debug_msg, sizeof(debug_msg), "File opened successfully\n");
-  OutputDebugStringA(debug_msg);
-
-  // Read RIFF header
-  char riff[4];
-  if (fread(riff, 1, 4, file) != 4) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read RIFF header\n");
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-  sprintf_s(debug_msg, sizeof(debug_msg), "RIFF header: %.4s\n", riff);
-  OutputDebugStringA(debug_msg);
-
-  if (strncmp(riff, "RIFF", 4) != 0) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Invalid RIFF header: %.4s\n", riff);
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-
-  // Skip file size (4 bytes)
-  fseek(file, 4, SEEK_CUR);
-
-  // Read WAVE header
-  char wave[4];
-  if (fread(wave, 1, 4, file) != 4) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read WAVE header\n");
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-
-  if (strncmp(wave, "WAVE", 4) != 0) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Invalid WAVE header: %.4s\n", wave);
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-
-  sprintf_s(debug_msg, sizeof(debug_msg), "WAVE header verified\n");
-  OutputDebugStringA(debug_msg);
-
-  // Read fmt chunk
-  char fmt[4];
-  if (fread(fmt, 1, 4, file) != 4) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read fmt chunk ID\n");
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-
-  sprintf_s(debug_msg, sizeof(debug_msg), "Chunk ID: %.4s\n", fmt);
-  OutputDebugStringA(debug_msg);
-
-  if (strncmp(fmt, "fmt ", 4) != 0) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Expected fmt chunk, got: %.4s\n", fmt);
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-
-  // Read fmt chunk size
-  uint32_t fmt_size;
-  if (fread(&fmt_size, 4, 1, file) != 1) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read fmt chunk size\n");
-    OutputDebugStringA(debug_msg);
-    fclose(file);
-    return E_FAIL;
-  }
-
-  sprintf_s(debug_msg, sizeof(debug_msg), "fmt chunk size: %u\n", fmt_size);
-  OutputDebugStringA(debug_msg);
-
-  // Read format (basic 16 bytes)
-  WAVEFORMATEX wave_format;
-  if (fread(&wave_format, 16, 1, file) != 1) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read WAVEFORMATEX\n");
+  // The shared parser reads only the chunk headers, fmt and (for RF64) ds64
+  auto read_file = [file](uint64_t offset, void* out, size_t count) -> size_t {
+    if (_fseeki64(file, static_cast<int64_t>(offset), SEEK_SET) != 0) {
+      return 0;
+    }
+    return fread(out, 1, count, file);
+  };
+  RiffParser parser;
+  RiffParser::Status status = parser.parse(read_file, file_size > 0 ? static_cast<uint64_t>(file_size) : 0);
+  if (status != RiffParser::Status::kOk) {
+    sprintf_s(debug_msg, sizeof(debug_msg), "Cannot parse WAV file (status %d)\n", static_cast<int>(status));
     OutputDebugStringA(debug_msg);
     fclose(file);
     return E_FAIL;
   }
 
-  sprintf_s(debug_msg, sizeof(debug_msg), "Audio format: %d Hz, %d channels, %d bits, tag: 0x%04X\n",
-            wave_format.nSamplesPerSec, wave_format.nChannels,
-            wave_format.wBitsPerSample, wave_format.wFormatTag);
+  const WavFormat& wav_format = parser.format();
+  sprintf_s(debug_msg, sizeof(debug_msg), "Audio format: %u Hz, %u channels, %u bits%s, tag: 0x%04X%s\n",
+            wav_format.sample_rate, wav_format.channels, wav_format.bits_per_sample,
+            wav_format.sample_format == WavSampleFormat::kFloat ? " float" : "",
+            wav_format.format_tag, parser.is_rf64() ? " (RF64)" : "");
   OutputDebugStringA(debug_msg);
 
-  // Skip extra format bytes (if any)
-  int extra_bytes_to_skip = fmt_size - 16;
-  if (extra_bytes_to_skip > 0) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Skipping %d extra format bytes\n", extra_bytes_to_skip);
-    OutputDebugStringA(debug_msg);
-    fseek(file, extra_bytes_to_skip, SEEK_CUR);
-  }
-
-  // Allocate format structure
+  // Samples are handed on as 16-bit PCM, which ConvertAudioFormat() takes
   *format = (WAVEFORMATEX*)CoTaskMemAlloc(sizeof(WAVEFORMATEX));
   if (*format == nullptr) {
     fclose(file);
     return E_OUTOFMEMORY;
   }
+  (*format)->wFormatTag = WAVE_FORMAT_PCM;
+  (*format)->nChannels = wav_format.channels;
+  (*format)->nSamplesPerSec = wav_format.sample_rate;
+  (*format)->wBitsPerSample = 16;
+  (*format)->nBlockAlign = static_cast<WORD>(wav_format.channels * sizeof(int16_t));
+  (*format)->nAvgBytesPerSec = (*format)->nSamplesPerSec * (*format)->nBlockAlign;
+  (*format)->cbSize = 0;
 
-  // Copy the format we read
-  **format = wave_format;
-  (*format)->cbSize = 0;  // No extra bytes
-
-  // Find data chunk (skip any other chunks)
-  char data_header[4];
-  bool found_data = false;
-
-  while (fread(data_header, 1, 4, file) == 4) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Found chunk: %.4s\n", data_header);
-    OutputDebugStringA(debug_msg);
-
-    if (strncmp(data_header, "data", 4) == 0) {
-      found_data = true;
-      break;
-    }
+  const uint64_t frames = parser.frames();
+  sprintf_s(debug_msg, sizeof(debug_msg), "Data chunk: %llu frames\n", static_cast<unsigned long long>(frames));
+  OutputDebugStringA(debug_msg);
 
-    // Skip this chunk
-    uint32_t chunk_size;
-    if (fread(&chunk_size, 4, 1, file) != 1) {
-      sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read chunk size\n");
+  // Read a block of frames at a time, converting as it goes
+  const size_t frames_per_block = 64 * 1024;
+  std::vector<uint8_t> block(frames_per_block * wav_format.block_align);
+  audio_data.resize(static_cast<size_t>(frames) * (*format)->nBlockAlign);
+  _fseeki64(file, static_cast<int64_t>(parser.data_offset()), SEEK_SET);
+  for (uint64_t done = 0; done < frames;) {
+    const size_t count = static_cast<size_t>((std::min)(static_cast<uint64_t>(frames_per_block), frames - done));
+    if (fread(block.data(), wav_format.block_align, count, file) != count) {
+      sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read audio data at frame %llu\n",
+                static_cast<unsigned long long>(done));
       OutputDebugStringA(debug_msg);
       CoTaskMemFree(*format);
       *format = nullptr;
       fclose(file);
       return E_FAIL;
     }
+    wav_samples_to_s16(wav_format, block.data(), count,
+                       reinterpret_cast<int16_t*>(audio_data.data() + done * (*format)->nBlockAlign));
+    done += count;
+  }
 
-    sprintf_s(debug_msg, sizeof(debug_msg), "Skipping chunk, size: %u\n", chunk_size);
-    OutputDebugStringA(debug_msg);
+  fclose(file);
 
-    fseek(file, chunk_size, SEEK_CUR);
-  }
+  sprintf_s(debug_msg, sizeof(debug_msg), "Successfully read audio file, size: %zu bytes\n", audio_data.size());
+  OutputDebugStringA(debug_msg);
 
-  if (!found_data || feof(file) || ferror(file)) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "data chunk not found or read error\n");
-    OutputDebugStringA(debug_msg);
-    CoTaskMemFree(*format);
-    *format = nullptr;
-    fclose(file);
-    return E_FAIL;
-  }
+  return S_OK;
+}
 
-  // Read data size
-  uint32_t data_size;
-  if (fread(&data_size, 4, 1, file) != 1) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read data size\n");
-    OutputDebugStringA(debug_msg);
-    CoTaskMemFree(*format);
-    *format = nullptr;
-    fclose(file);
-    return E_FAIL;
+void MappedWavFile::Reset() {
+  if (view) {
+    UnmapViewOfFile(view);
+    view = nullptr;
+  }
+  if (mapping) {
+    CloseHandle(mapping);
+    mapping = nullptr;
+  }
+  if (file != INVALID_HANDLE_VALUE) {
+    CloseHandle(file);
+    file = INVALID_HANDLE_VALUE;
   }
+  data = nullptr;
+  data_size = 0;
+}
 
-  sprintf_s(debug_msg, sizeof(debug_msg), "Data chunk size: %u bytes\n", data_size);
-  OutputDebugStringA(debug_msg);
+bool FlutterF2fSoundPlugin::MapWavFile(const std::string& path, MappedWavFile& mapped) {
+  mapped.Reset();
 
-  // Read audio data
-  audio_data.resize(data_size);
-  size_t bytes_read = fread(audio_data.data(), 1, data_size, file);
-  if (bytes_read != data_size) {
-    sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read audio data: expected %u, got %zu\n", data_size, bytes_read);
-    OutputDebugStringA(debug_msg);
-    CoTaskMemFree(*format);
-    *format = nullptr;
-    fclose(file);
-    return E_FAIL;
+  int size_needed = MultiByteToWideChar(CP_UTF8, 0, path.c_str(), (int)path.length(), NULL, 0);
+  std::wstring wpath(size_needed, 0);
+  MultiByteToWideChar(CP_UTF8, 0, path.c_str(), (int)path.length(), &wpath[0], size_needed);
+
+  // Sequential scan makes the cache manager read well ahead of the page
+  // faults the playback thread takes
+  mapped.file = CreateFileW(wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+  if (mapped.file == INVALID_HANDLE_VALUE) {
+    return false;
+  }
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(mapped.file, &file_size) || file_size.QuadPart < 12) {
+    mapped.Reset();
+    return false;
+  }
+  mapped.mapping = CreateFileMappingW(mapped.file, NULL, PAGE_READONLY, 0, 0, NULL);
+  if (!mapped.mapping) {
+    mapped.Reset();
+    return false;
+  }
+  mapped.view = static_cast<const BYTE*>(MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0));
+  if (!mapped.view) {
+    mapped.Reset();
+    return false;
   }
 
-  fclose(file);
+  const BYTE* view = mapped.view;
+  const uint64_t size = static_cast<uint64_t>(file_size.QuadPart);
+  RiffParser parser;
+  RiffParser::Status status = parser.parse(
+      [view, size](uint64_t offset, void* out, size_t count) -> size_t {
+        const size_t length = offset < size ? static_cast<size_t>((std::min)(static_cast<uint64_t>(count), size - offset)) : 0;
+        memcpy(out, view + offset, length);
+        return length;
+      },
+      size);
+  if (status != RiffParser::Status::kOk || parser.frames() == 0) {
+    mapped.Reset();
+    return false;
+  }
 
-  sprintf_s(debug_msg, sizeof(debug_msg), "Successfully read audio file, size: %zu bytes\n", audio_data.size());
-  OutputDebugStringA(debug_msg);
+  // The fmt chunk as stored doubles as the WAVEFORMATEX(TENSIBLE)
+  const WavFormat& wav_format = parser.format();
+  ZeroMemory(&mapped.format, sizeof(mapped.format));
+  memcpy(&mapped.format, wav_format.chunk.data(), (std::min)(wav_format.chunk.size(), sizeof(mapped.format)));
+  if (wav_format.chunk.size() < sizeof(WAVEFORMATEX)) {
+    mapped.format.Format.cbSize = 0;
+  }
+  mapped.data = view + parser.data_offset();
+  mapped.data_size = static_cast<size_t>(parser.frames() * wav_format.block_align);
+  return true;
+}
 
-  return S_OK;
+bool FlutterF2fSoundPlugin::WavFormatMatches(const WAVEFORMATEX* file_format,
+                                             const WAVEFORMATEX* device_format) {
+  return file_format->nChannels == device_format->nChannels &&
+         file_format->nSamplesPerSec == device_format->nSamplesPerSec &&
+         file_format->wBitsPerSample == device_format->wBitsPerSample &&
+         file_format->nBlockAlign == device_format->nBlockAlign &&
+         IsFloatFormat(file_format) == IsFloatFormat(device_format);
 }
 
 HRESULT FlutterF2fSoundPlugin::ConvertAudioFormat(const WAVEFORMATEX* input_format, const std::vector<uint8_t>& input_data,
@@ -1850,15 +2114,96 @@ bool FlutterF2fSoundPlugin::IsURL(const std::string& path) {
   return (path.find("http://") == 0 || path.find("https://") == 0);
 }
 
-HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::string& local_path) {
-  char debug_msg[512];
+std::string FlutterF2fSoundPlugin::GetAudioCachePath(const std::string& url) {
+  // %LOCALAPPDATA%\flutter_f2f_sound\audio, or the temp directory without it
+  char base[MAX_PATH];
+  DWORD length = GetEnvironmentVariableA("LOCALAPPDATA", base, MAX_PATH);
+  if (length == 0 || length >= MAX_PATH) {
+    GetTempPathA(MAX_PATH, base);
+  }
+  std::string directory = base;
+  if (!directory.empty() && directory.back() != '\\') {
+    directory += '\\';
+  }
+  directory += "flutter_f2f_sound";
+  CreateDirectoryA(directory.c_str(), NULL);
+  directory += "\\audio";
+  CreateDirectoryA(directory.c_str(), NULL);
+
+  // 64-bit FNV-1a of the URL names the entry
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : url) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  char name[17];
+  sprintf_s(name, sizeof(name), "%016llx", static_cast<unsigned long long>(hash));
+  return directory + "\\" + name;
+}
 
-  // Get temporary file path
-  char temp_path[MAX_PATH];
-  GetTempPathA(MAX_PATH, temp_path);
+void FlutterF2fSoundPlugin::EvictAudioCache(const std::string& keep) {
+  const std::string directory = keep.substr(0, keep.find_last_of('\\'));
+
+  struct Body {
+    std::string path;
+    uint64_t size;
+    FILETIME used;
+  };
+  std::vector<Body> bodies;
+  uint64_t total = 0;
+
+  FILETIME now;
+  GetSystemTimeAsFileTime(&now);
+  const uint64_t now_ticks = (static_cast<uint64_t>(now.dwHighDateTime) << 32) | now.dwLowDateTime;
+  const uint64_t stale_ticks = 60ull * 60 * 10000000;  // One hour in 100 ns units
+
+  WIN32_FIND_DATAA find_data;
+  HANDLE find = FindFirstFileA((directory + "\\*").c_str(), &find_data);
+  if (find == INVALID_HANDLE_VALUE) {
+    return;
+  }
+  do {
+    if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+      continue;
+    }
+    const std::string name = find_data.cFileName;
+    const std::string path = directory + "\\" + name;
+    const uint64_t size = (static_cast<uint64_t>(find_data.nFileSizeHigh) << 32) | find_data.nFileSizeLow;
+    const uint64_t written = (static_cast<uint64_t>(find_data.ftLastWriteTime.dwHighDateTime) << 32) |
+                             find_data.ftLastWriteTime.dwLowDateTime;
+    if (name.find(".tmp") != std::string::npos) {
+      // Left behind by a download that never finished
+      if (now_ticks > written && now_ticks - written > stale_ticks) {
+        DeleteFileA(path.c_str());
+      }
+    } else if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".meta") != 0) {
+      bodies.push_back(Body{path, size, find_data.ftLastWriteTime});
+      total += size;
+    }
+  } while (FindNextFileA(find, &find_data));
+  FindClose(find);
 
-  char temp_file[MAX_PATH];
-  GetTempFileNameA(temp_path, "audio", 0, temp_file);
+  // Least recently used first
+  std::sort(bodies.begin(), bodies.end(), [](const Body& a, const Body& b) {
+    return CompareFileTime(&a.used, &b.used) < 0;
+  });
+  for (const Body& body : bodies) {
+    if (total <= kAudioCacheBytes) {
+      break;
+    }
+    if (body.path == keep) {
+      continue;
+    }
+    const size_t name_start = body.path.find_last_of('\\') + 1;
+    const std::string base = body.path.substr(0, body.path.find('.', name_start));
+    DeleteFileA((base + ".meta").c_str());
+    DeleteFileA(body.path.c_str());
+    total -= body.size;
+  }
+}
+
+HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::string& local_path) {
+  char debug_msg[512];
 
   // Extract file extension from URL
   std::string extension = ".wav";  // Default extension
@@ -1866,7 +2211,8 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
   size_t url_end = (query_pos != std::string::npos) ? query_pos : url.length();
   size_t last_dot = url.find_last_of('.', url_end);
 
-  if (last_dot != std::string::npos && last_dot < url_end) {
+  if (last_dot != std::string::npos && last_dot < url_end &&
+      url.find('/', last_dot) >= url_end) {
     extension = url.substr(last_dot, url_end - last_dot);
     // Convert extension to lowercase
     for (char& c : extension) {
@@ -1876,10 +2222,46 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
     }
   }
 
-  // Remove the .tmp extension and add the correct extension from URL
-  local_path = temp_file;
-  local_path = local_path.substr(0, local_path.find_last_of('.'));
-  local_path += extension;
+  // The cache entry is named after the URL and keeps its extension, so Media
+  // Foundation still recognizes the format
+  const std::string cache_base = GetAudioCachePath(url);
+  const std::string meta_path = cache_base + ".meta";
+  local_path = cache_base + extension;
+
+  // Validators of the cached copy, if there is one for this URL
+  std::string cached_etag;
+  std::string cached_last_modified;
+  bool have_cached = false;
+  {
+    std::ifstream meta(meta_path);
+    std::string stored_url;
+    if (std::getline(meta, stored_url) && stored_url == url &&
+        GetFileAttributesA(local_path.c_str()) != INVALID_FILE_ATTRIBUTES) {
+      std::getline(meta, cached_etag);
+      std::getline(meta, cached_last_modified);
+      have_cached = !cached_etag.empty() || !cached_last_modified.empty();
+    }
+  }
+
+  // Plays the cached copy when it is current or the server cannot be reached,
+  // and marks it as recently used
+  auto use_cached = [&]() -> HRESULT {
+    if (!have_cached) {
+      return E_FAIL;
+    }
+    HANDLE file = CreateFileA(local_path.c_str(), FILE_WRITE_ATTRIBUTES,
+                              FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+      FILETIME now;
+      GetSystemTimeAsFileTime(&now);
+      SetFileTime(file, NULL, NULL, &now);
+      CloseHandle(file);
+    }
+    sprintf_s(debug_msg, sizeof(debug_msg), "Using cached copy: %s\n", local_path.c_str());
+    OutputDebugStringA(debug_msg);
+    return S_OK;
+  };
 
   sprintf_s(debug_msg, sizeof(debug_msg), "Downloading URL: %s to: %s (extension: %s)\n",
             url.c_str(), local_path.c_str(), extension.c_str());
@@ -1896,19 +2278,13 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
     std::wstring w_url(url_len, 0);
     MultiByteToWideChar(CP_UTF8, 0, url.c_str(), -1, &w_url[0], url_len);
 
-    // Open WinHTTP session
-    hSession = WinHttpOpen(
-      L"FlutterF2FSound/1.0",
-      WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-      WINHTTP_NO_PROXY_NAME,
-      WINHTTP_NO_PROXY_BYPASS,
-      0
-    );
+    // Reuse the session, and with it any open connection to the host
+    hSession = GetHttpSession();
 
     if (!hSession) {
       sprintf_s(debug_msg, sizeof(debug_msg), "Failed to open WinHTTP session: %d\n", GetLastError());
       OutputDebugStringA(debug_msg);
-      return E_FAIL;
+      return use_cached();
     }
 
     // Parse URL and connect to server
@@ -1925,7 +2301,6 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
     if (!WinHttpCrackUrl(w_url.c_str(), 0, 0, &url_components)) {
       sprintf_s(debug_msg, sizeof(debug_msg), "Failed to parse URL: %d\n", GetLastError());
       OutputDebugStringA(debug_msg);
-      WinHttpCloseHandle(hSession);
       return E_FAIL;
     }
 
@@ -1943,8 +2318,7 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
     if (!hConnect) {
       sprintf_s(debug_msg, sizeof(debug_msg), "Failed to connect to server: %d\n", GetLastError());
       OutputDebugStringA(debug_msg);
-      WinHttpCloseHandle(hSession);
-      return E_FAIL;
+      return use_cached();
     }
 
     // Open request
@@ -1962,18 +2336,31 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
       sprintf_s(debug_msg, sizeof(debug_msg), "Failed to open request: %d\n", GetLastError());
       OutputDebugStringA(debug_msg);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
-      return E_FAIL;
+      return use_cached();
     }
 
-    // Send request
-    if (!WinHttpSendRequest(hRequest, WINHTTP_NO_ADDITIONAL_HEADERS, 0, WINHTTP_NO_REQUEST_DATA, 0, 0, 0)) {
+    // Send request, conditional when there is a cached copy to revalidate
+    // (validators are ASCII)
+    std::wstring conditional_headers;
+    if (have_cached && !cached_etag.empty()) {
+      conditional_headers += L"If-None-Match: " +
+                             std::wstring(cached_etag.begin(), cached_etag.end()) + L"\r\n";
+    }
+    if (have_cached && !cached_last_modified.empty()) {
+      conditional_headers += L"If-Modified-Since: " +
+                             std::wstring(cached_last_modified.begin(), cached_last_modified.end()) +
+                             L"\r\n";
+    }
+    if (!WinHttpSendRequest(hRequest,
+                            conditional_headers.empty() ? WINHTTP_NO_ADDITIONAL_HEADERS
+                                                        : conditional_headers.c_str(),
+                            conditional_headers.empty() ? 0 : static_cast<DWORD>(-1L),
+                            WINHTTP_NO_REQUEST_DATA, 0, 0, 0)) {
       sprintf_s(debug_msg, sizeof(debug_msg), "Failed to send request: %d\n", GetLastError());
       OutputDebugStringA(debug_msg);
       WinHttpCloseHandle(hRequest);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
-      return E_FAIL;
+      return use_cached();
     }
 
     // Receive response
@@ -1982,8 +2369,7 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
       OutputDebugStringA(debug_msg);
       WinHttpCloseHandle(hRequest);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
-      return E_FAIL;
+      return use_cached();
     }
 
     // Check status code
@@ -1998,12 +2384,17 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
       WINHTTP_NO_HEADER_INDEX
     );
 
+    if (status_code == HTTP_STATUS_NOT_MODIFIED && have_cached) {
+      WinHttpCloseHandle(hRequest);
+      WinHttpCloseHandle(hConnect);
+      return use_cached();
+    }
+
     if (status_code != 200) {
       sprintf_s(debug_msg, sizeof(debug_msg), "HTTP status code: %d\n", status_code);
       OutputDebugStringA(debug_msg);
       WinHttpCloseHandle(hRequest);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
       return E_FAIL;
     }
 
@@ -2025,42 +2416,114 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
     sprintf_s(debug_msg, sizeof(debug_msg), "Content length: %d bytes\n", content_length);
     OutputDebugStringA(debug_msg);
 
-    // Download data
-    FILE* file = nullptr;
-    errno_t err = fopen_s(&file, local_path.c_str(), "wb");
-    if (err != 0 || file == nullptr) {
-      sprintf_s(debug_msg, sizeof(debug_msg), "Failed to create temporary file: %d\n", err);
+    // Validators to store with the new copy
+    auto query_header = [hRequest](DWORD query) {
+      std::string value;
+      wchar_t buffer[256];
+      DWORD size = sizeof(buffer);
+      if (WinHttpQueryHeaders(hRequest, query, WINHTTP_HEADER_NAME_BY_INDEX, buffer, &size,
+                              WINHTTP_NO_HEADER_INDEX)) {
+        for (DWORD i = 0; i < size / sizeof(wchar_t); i++) {
+          value += static_cast<char>(buffer[i]);
+        }
+      }
+      return value;
+    };
+    const std::string etag = query_header(WINHTTP_QUERY_ETAG);
+    const std::string last_modified = query_header(WINHTTP_QUERY_LAST_MODIFIED);
+
+    // Download into a temporary file and rename it into place once complete,
+    // so a cached file is never partial. Shared for writing, so segments can
+    // fill their parts of it in parallel.
+    const std::string temp_path =
+        cache_base + "." + std::to_string(GetCurrentThreadId()) + ".tmp" + extension;
+    FILE* file = _fsopen(temp_path.c_str(), "wb", _SH_DENYNO);
+    if (file == nullptr) {
+      sprintf_s(debug_msg, sizeof(debug_msg), "Failed to create temporary file: %d\n", errno);
       OutputDebugStringA(debug_msg);
       WinHttpCloseHandle(hRequest);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
       return E_FAIL;
     }
 
-    DWORD bytes_available = 0;
-    DWORD total_bytes = 0;
-    BYTE buffer[8192];
-
-    while (WinHttpQueryDataAvailable(hRequest, &bytes_available) && bytes_available > 0) {
-      DWORD bytes_read = 0;
-      if (!WinHttpReadData(hRequest, buffer, sizeof(buffer), &bytes_read)) {
-        sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read data: %d\n", GetLastError());
-        OutputDebugStringA(debug_msg);
-        break;
+    // A large file from a server that accepts ranges is fetched over several
+    // connections: this response keeps the first segment and each further
+    // segment gets a range request of its own, written straight to its place
+    // in the preallocated file
+    DWORD main_end = content_length;
+    std::vector<std::thread> segment_threads;
+    std::unique_ptr<bool[]> segment_results;
+    if (content_length >= kSegmentedDownloadBytes &&
+        query_header(WINHTTP_QUERY_ACCEPT_RANGES) == "bytes" &&
+        _chsize_s(_fileno(file), content_length) == 0) {
+      const DWORD per_segment = (content_length + kDownloadSegments - 1) / kDownloadSegments;
+      main_end = per_segment;
+      segment_results.reset(new bool[kDownloadSegments]());
+      const bool secure = url_components.nScheme == INTERNET_SCHEME_HTTPS;
+      for (DWORD segment = 1; segment < kDownloadSegments; segment++) {
+        const uint64_t start = (uint64_t)segment * per_segment;
+        const uint64_t end = (std::min)(start + per_segment, (uint64_t)content_length);
+        bool* result = &segment_results[segment];
+        segment_threads.emplace_back([hConnect, &url_path, secure, start, end, &temp_path, result]() {
+          *result = DownloadAudioRange(hConnect, url_path, secure, start, end, temp_path);
+        });
       }
+      sprintf_s(debug_msg, sizeof(debug_msg), "Downloading in %u segments\n", kDownloadSegments);
+      OutputDebugStringA(debug_msg);
+    }
 
-      if (bytes_read > 0) {
-        fwrite(buffer, 1, bytes_read, file);
-        total_bytes += bytes_read;
-
-        if (total_bytes % (100 * 1024) == 0) {  // Log every 100KB
-          sprintf_s(debug_msg, sizeof(debug_msg), "Downloaded: %d bytes\n", total_bytes);
+    DWORD total_bytes = 0;
+    std::vector<BYTE> buffer(kDownloadBufferBytes);
+    bool complete = true;
+
+    // Reads this response into the file until |end| bytes (0 for all of it)
+    auto read_response = [&](DWORD end) {
+      DWORD bytes_available = 0;
+      while ((end == 0 || total_bytes < end) &&
+             WinHttpQueryDataAvailable(hRequest, &bytes_available) && bytes_available > 0) {
+        DWORD bytes_read = 0;
+        DWORD to_read = static_cast<DWORD>(buffer.size());
+        if (end > 0) {
+          to_read = (std::min)(to_read, end - total_bytes);
+        }
+        if (!WinHttpReadData(hRequest, buffer.data(), to_read, &bytes_read)) {
+          sprintf_s(debug_msg, sizeof(debug_msg), "Failed to read data: %d\n", GetLastError());
           OutputDebugStringA(debug_msg);
+          complete = false;
+          return;
         }
+
+        if (bytes_read > 0) {
+          if (fwrite(buffer.data(), 1, bytes_read, file) != bytes_read) {
+            complete = false;
+            return;
+          }
+          total_bytes += bytes_read;
+        }
+      }
+    };
+
+    read_response(main_end);
+    if (!segment_threads.empty()) {
+      bool segments_complete = true;
+      for (DWORD segment = 0; segment < segment_threads.size(); segment++) {
+        segment_threads[segment].join();
+        segments_complete = segments_complete && segment_results[segment + 1];
+      }
+      if (complete && total_bytes == main_end && segments_complete) {
+        total_bytes = content_length;
+      } else if (complete) {
+        // A segment failed or the server ignored its range: read on from
+        // this response instead
+        OutputDebugStringA("Segmented download failed, continuing as one stream\n");
+        read_response(0);
       }
     }
 
-    fclose(file);
+    complete = fclose(file) == 0 && complete;
+    if (content_length > 0 && total_bytes != content_length) {
+      complete = false;
+    }
 
     sprintf_s(debug_msg, sizeof(debug_msg), "Download complete: %d bytes\n", total_bytes);
     OutputDebugStringA(debug_msg);
@@ -2068,7 +2531,31 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
     // Cleanup
     WinHttpCloseHandle(hRequest);
     WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
+
+    if (!complete) {
+      DeleteFileA(temp_path.c_str());
+      return E_FAIL;
+    }
+
+    // Drop the old validators first, so they never vouch for the new body
+    DeleteFileA(meta_path.c_str());
+    if (!MoveFileExA(temp_path.c_str(), local_path.c_str(),
+                     MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+      // The cached file is still open elsewhere; play this download uncached
+      local_path = temp_path;
+      return S_OK;
+    }
+    if (!etag.empty() || !last_modified.empty()) {
+      const std::string meta_temp_path = meta_path + "." + std::to_string(GetCurrentThreadId()) + ".tmp";
+      std::ofstream meta(meta_temp_path, std::ios::binary | std::ios::trunc);
+      meta << url << "\n" << etag << "\n" << last_modified << "\n";
+      meta.close();
+      if (!meta || !MoveFileExA(meta_temp_path.c_str(), meta_path.c_str(),
+                                MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        DeleteFileA(meta_temp_path.c_str());
+      }
+    }
+    EvictAudioCache(local_path);
 
     return S_OK;
   } catch (...) {
@@ -2077,12 +2564,88 @@ HRESULT FlutterF2fSoundPlugin::DownloadAudioFile(const std::string& url, std::st
 
     if (hRequest) WinHttpCloseHandle(hRequest);
     if (hConnect) WinHttpCloseHandle(hConnect);
-    if (hSession) WinHttpCloseHandle(hSession);
 
     return E_FAIL;
   }
 }
 
+// static
+bool FlutterF2fSoundPlugin::DownloadAudioRange(void* connection, const wchar_t* url_path,
+                                               bool secure, uint64_t start, uint64_t end,
+                                               const std::string& path) {
+  HINTERNET request = WinHttpOpenRequest(connection, L"GET", url_path, NULL, WINHTTP_NO_REFERER,
+                                         WINHTTP_DEFAULT_ACCEPT_TYPES,
+                                         secure ? WINHTTP_FLAG_SECURE : 0);
+  if (!request) {
+    return false;
+  }
+  wchar_t range[64];
+  swprintf_s(range, L"Range: bytes=%llu-%llu", start, end - 1);
+
+  bool complete = false;
+  FILE* file = _fsopen(path.c_str(), "r+b", _SH_DENYNO);
+  if (file && WinHttpSendRequest(request, range, static_cast<DWORD>(-1L), WINHTTP_NO_REQUEST_DATA,
+                                 0, 0, 0) &&
+      WinHttpReceiveResponse(request, NULL)) {
+    DWORD status_code = 0;
+    DWORD status_size = sizeof(status_code);
+    WinHttpQueryHeaders(request, WINHTTP_QUERY_STATUS_CODE | WINHTTP_QUERY_FLAG_NUMBER,
+                        WINHTTP_HEADER_NAME_BY_INDEX, &status_code, &status_size,
+                        WINHTTP_NO_HEADER_INDEX);
+    // Anything but 206 means the range was not honoured
+    if (status_code == 206 && _fseeki64(file, static_cast<__int64>(start), SEEK_SET) == 0) {
+      std::vector<BYTE> buffer(kDownloadBufferBytes);
+      uint64_t position = start;
+      DWORD bytes_read = 0;
+      while (position < end &&
+             WinHttpReadData(request, buffer.data(),
+                             static_cast<DWORD>((std::min)((uint64_t)buffer.size(), end - position)),
+                             &bytes_read) &&
+             bytes_read > 0) {
+        if (fwrite(buffer.data(), 1, bytes_read, file) != bytes_read) {
+          break;
+        }
+        position += bytes_read;
+      }
+      complete = position == end;
+    }
+  }
+  if (file) {
+    complete = fclose(file) == 0 && complete;
+  }
+  WinHttpCloseHandle(request);
+
+  char debug_msg[256];
+  sprintf_s(debug_msg, sizeof(debug_msg), "Segment %llu-%llu %s\n", start, end - 1,
+            complete ? "downloaded" : "failed");
+  OutputDebugStringA(debug_msg);
+  return complete;
+}
+
+void* FlutterF2fSoundPlugin::GetHttpSession() {
+  std::lock_guard<std::mutex> lock(http_session_mutex_);
+  if (http_session_) {
+    return http_session_;
+  }
+  HINTERNET session = WinHttpOpen(
+    L"FlutterF2FSound/1.0",
+    WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
+    WINHTTP_NO_PROXY_NAME,
+    WINHTTP_NO_PROXY_BYPASS,
+    0
+  );
+  if (!session) {
+    return nullptr;
+  }
+#ifdef WINHTTP_PROTOCOL_FLAG_HTTP2
+  // Fails before Windows 10 1607, which then keeps to HTTP/1.1
+  DWORD protocols = WINHTTP_PROTOCOL_FLAG_HTTP2;
+  WinHttpSetOption(session, WINHTTP_OPTION_ENABLE_HTTP_PROTOCOL, &protocols, sizeof(protocols));
+#endif
+  http_session_ = session;
+  return http_session_;
+}
+
 // Window procedure for handling messages on the platform thread
 LRESULT CALLBACK FlutterF2fSoundPlugin::WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
   if (uMsg == WM_CREATE) {
@@ -2098,21 +2661,17 @@ LRESULT CALLBACK FlutterF2fSoundPlugin::WindowProc(HWND hwnd, UINT uMsg, WPARAM
   }
 
   if (uMsg == WM_RECORDING_DATA) {
-    // Process recording data on the platform thread
-    std::vector<uint8_t>* audio_data = reinterpret_cast<std::vector<uint8_t>*>(lParam);
-    if (audio_data) {
-      plugin->ProcessRecordingData(*audio_data);
-      delete audio_data;
+    // Drain queued recording packets on the platform thread
+    for (EventQueue::Packet& packet : TakeQueuedPackets(plugin->recording_queue_)) {
+      plugin->ProcessRecordingData(std::move(packet.value));
     }
     return 0;
   }
 
   if (uMsg == WM_SYSTEM_SOUND_DATA) {
-    // Process system sound data on the platform thread
-    std::vector<uint8_t>* audio_data = reinterpret_cast<std::vector<uint8_t>*>(lParam);
-    if (audio_data) {
-      plugin->ProcessSystemSoundData(*audio_data);
-      delete audio_data;
+    // Drain queued system sound packets on the platform thread
+    for (EventQueue::Packet& packet : TakeQueuedPackets(plugin->system_sound_queue_)) {
+      plugin->ProcessSystemSoundData(std::move(packet.value));
     }
     return 0;
   }
@@ -2121,41 +2680,29 @@ LRESULT CALLBACK FlutterF2fSoundPlugin::WindowProc(HWND hwnd, UINT uMsg, WPARAM
 }
 
 // Process recording data and send to Flutter (called on platform thread)
-void FlutterF2fSoundPlugin::ProcessRecordingData(const std::vector<uint8_t>& audio_data) {
-  if (recording_event_sink_ && !audio_data.empty()) {
-    // Create EncodableList from audio data
-    flutter::EncodableList encodable_audio_data;
-    for (uint8_t byte : audio_data) {
-      encodable_audio_data.push_back(static_cast<int>(byte));
-    }
-
-    // Send data to Flutter (now on platform thread)
-    recording_event_sink_->Success(flutter::EncodableValue(encodable_audio_data));
+void FlutterF2fSoundPlugin::ProcessRecordingData(flutter::EncodableValue&& packet) {
+  if (recording_event_sink_) {
+    // Send the typed packet to Flutter (now on platform thread)
+    recording_event_sink_->Success(std::move(packet));
   }
 }
 
 // Process system sound data and send to Flutter (called on platform thread)
-void FlutterF2fSoundPlugin::ProcessSystemSoundData(const std::vector<uint8_t>& audio_data) {
+void FlutterF2fSoundPlugin::ProcessSystemSoundData(flutter::EncodableValue&& packet) {
   static int data_packet_count = 0;
   data_packet_count++;
 
-  if (system_sound_event_sink_ && !audio_data.empty()) {
+  if (system_sound_event_sink_) {
     // Log every 50 packets to verify data is reaching Flutter
     if (data_packet_count % 50 == 0) {
       char debug_msg[512];
-      sprintf_s(debug_msg, sizeof(debug_msg), "ProcessSystemSoundData: Sending packet %d to Flutter, size: %zu bytes\n",
-                data_packet_count, audio_data.size());
+      sprintf_s(debug_msg, sizeof(debug_msg), "ProcessSystemSoundData: Sending packet %d to Flutter\n",
+                data_packet_count);
       OutputDebugStringA(debug_msg);
     }
 
-    // Create EncodableList from audio data
-    flutter::EncodableList encodable_audio_data;
-    for (uint8_t byte : audio_data) {
-      encodable_audio_data.push_back(static_cast<int>(byte));
-    }
-
-    // Send data to Flutter (now on platform thread)
-    system_sound_event_sink_->Success(flutter::EncodableValue(encodable_audio_data));
+    // Send the typed packet to Flutter (now on platform thread)
+    system_sound_event_sink_->Success(std::move(packet));
   } else {
     if (!system_sound_event_sink_) {
       OutputDebugStringA("ProcessSystemSoundData: No event sink!\n");
@@ -2172,11 +2719,7 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
   // Check if it's a network URL
   if (path.find("http://") == 0 || path.find("https://") == 0) {
     // For network URLs, use WinHttp to download the content
-    HINTERNET hSession = WinHttpOpen(L"FlutterF2fSound/1.0",
-        WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
-        WINHTTP_NO_PROXY_NAME,
-        WINHTTP_NO_PROXY_BYPASS,
-        0);
+    HINTERNET hSession = GetHttpSession();
     
     if (!hSession) {
       OutputDebugStringA("Failed to create WinHttp session");
@@ -2209,7 +2752,6 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
     
     if (!WinHttpCrackUrl(wide_path.c_str(), 0, 0, &url_components)) {
       OutputDebugStringA("Failed to parse URL");
-      WinHttpCloseHandle(hSession);
       return;
     }
     
@@ -2224,7 +2766,6 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
     
     if (!hConnect) {
       OutputDebugStringA("Failed to connect to host");
-      WinHttpCloseHandle(hSession);
       return;
     }
     
@@ -2245,7 +2786,6 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
     if (!hRequest) {
       OutputDebugStringA("Failed to open request");
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
       return;
     }
     
@@ -2260,7 +2800,6 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
       OutputDebugStringA("Failed to send request");
       WinHttpCloseHandle(hRequest);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
       return;
     }
     
@@ -2269,7 +2808,6 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
       OutputDebugStringA("Failed to receive response");
       WinHttpCloseHandle(hRequest);
       WinHttpCloseHandle(hConnect);
-      WinHttpCloseHandle(hSession);
       return;
     }
     
@@ -2283,7 +2821,7 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
       std::vector<uint8_t> audio_data(buffer, buffer + bytes_read);
       
       // Process and send the audio data
-      ProcessPlaybackStreamData(audio_data);
+      ProcessPlaybackStreamData(std::move(audio_data));
       
       // Simulate playback speed (adjust based on actual format)
       Sleep(10); // Simple delay to control streaming rate
@@ -2292,7 +2830,6 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
     // Cleanup
     WinHttpCloseHandle(hRequest);
     WinHttpCloseHandle(hConnect);
-    WinHttpCloseHandle(hSession);
     
     OutputDebugStringA("Network URL stream completed\n");
     is_playback_streaming_ = false;
@@ -2352,7 +2889,7 @@ void FlutterF2fSoundPlugin::PlaybackStreamThread(const std::string& path) {
     std::vector<uint8_t> audio_data(buffer, buffer + bytes_read);
     
     // Process and send the audio data
-    ProcessPlaybackStreamData(audio_data);
+    ProcessPlaybackStreamData(std::move(audio_data));
     
     // Simulate playback speed (adjust based on actual format)
     Sleep(10); // Simple delay to control streaming rate
@@ -11,6 +11,8 @@
 #include <mutex>
 #include <atomic>
 #include <queue>
+#include <deque>
+#include <condition_variable>
 
 // Windows headers for REFERENCE_TIME, ERole, etc.
 #include <windows.h>
@@ -32,12 +34,70 @@ namespace flutter_f2f_sound {
 const UINT WM_RECORDING_DATA = WM_USER + 100;
 const UINT WM_SYSTEM_SOUND_DATA = WM_USER + 101;
 
+// What a capture stream does when Dart falls behind and its queue is full
+enum class OverflowPolicy {
+  kDropOldest,  // Discard the oldest queued packet (lowest latency)
+  kDropNewest,  // Discard the packet being added
+  kBlock,       // Stall the capture thread until the queue drains, for a bounded time
+};
+
 // Audio recording configuration
 struct AudioConfig {
   int sample_rate = 44100;
   int channels = 1;  // 1 = mono, 2 = stereo
   int bits_per_sample = 16;
   bool is_system_sound = false;
+  bool float32_output = false;  // Deliver Float32List instead of raw bytes
+  int packet_duration_ms = 0;   // 0 = deliver each WASAPI packet as captured
+  int fragment_ms = 40;         // Requested WASAPI buffer duration
+  size_t max_queued_packets = 32;
+  OverflowPolicy overflow_policy = OverflowPolicy::kDropOldest;
+};
+
+// Bounded hand-off of encoded packets from a capture thread to the platform
+// thread. One wake-up message is posted per batch rather than per packet.
+struct EventQueue {
+  struct Packet {
+    flutter::EncodableValue value;
+    UINT32 frames;
+  };
+
+  size_t max_packets = 32;
+  OverflowPolicy policy = OverflowPolicy::kDropOldest;
+
+  std::mutex mutex;
+  std::condition_variable space_available;
+  std::deque<Packet> packets;
+  bool wake_posted = false;
+  bool closed = false;
+
+  std::atomic<uint64_t> dropped_frames{0};
+};
+
+// Gathers captured frames into packets of exactly |packet_frames| frames
+// before they are posted to the platform thread.
+struct PacketCoalescer {
+  UINT32 packet_frames = 0;  // 0 = post each WASAPI packet as-is
+  std::vector<BYTE> pending;
+};
+
+// A WAV file mapped read-only into memory, so its data chunk can be played
+// without reading it into a buffer first. Unmapped on destruction.
+struct MappedWavFile {
+  HANDLE file = INVALID_HANDLE_VALUE;
+  HANDLE mapping = nullptr;
+  const BYTE* view = nullptr;
+  WAVEFORMATEXTENSIBLE format = {};  // The fmt chunk, extensible or not
+  const BYTE* data = nullptr;        // Start of the data chunk
+  size_t data_size = 0;
+
+  MappedWavFile() = default;
+  MappedWavFile(const MappedWavFile&) = delete;
+  MappedWavFile& operator=(const MappedWavFile&) = delete;
+  ~MappedWavFile() { Reset(); }
+
+  const WAVEFORMATEX* Format() const { return &format.Format; }
+  void Reset();
 };
 
 class FlutterF2fSoundPlugin : public flutter::Plugin {
@@ -89,9 +149,12 @@ class FlutterF2fSoundPlugin : public flutter::Plugin {
 
   HWND message_window_ = nullptr;  // Hidden window for thread-safe message dispatching
   static LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
-  void ProcessRecordingData(const std::vector<uint8_t>& audio_data);
-  void ProcessSystemSoundData(const std::vector<uint8_t>& audio_data);
-  void ProcessPlaybackStreamData(const std::vector<uint8_t>& audio_data);
+  // Packets are built once on the capture thread (see CreateCapturePacket)
+  // and moved through the event queue into the event sink, so no copy is
+  // made beyond the one taken out of the WASAPI buffer.
+  void ProcessRecordingData(flutter::EncodableValue&& packet);
+  void ProcessSystemSoundData(flutter::EncodableValue&& packet);
+  void ProcessPlaybackStreamData(std::vector<uint8_t>&& audio_data);
 
   // WASAPI interfaces for recording
   IMMDeviceEnumerator* device_enumerator_ = nullptr;
@@ -108,6 +171,9 @@ class FlutterF2fSoundPlugin : public flutter::Plugin {
   WAVEFORMATEX *system_sound_wave_format_ = nullptr;
   WAVEFORMATEXTENSIBLE *system_sound_wave_format_extensible_ = nullptr;
   UINT32 system_sound_buffer_frame_count_ = 0;
+  AudioConfig system_sound_config_;
+  PacketCoalescer system_sound_coalescer_;
+  EventQueue system_sound_queue_;
 
   // WASAPI interfaces for playback
   IMMDevice* playback_device_ = nullptr;
@@ -118,12 +184,11 @@ class FlutterF2fSoundPlugin : public flutter::Plugin {
 
   // Recording parameters
   AudioConfig recording_config_;
+  PacketCoalescer recording_coalescer_;
+  EventQueue recording_queue_;
   WAVEFORMATEX *wave_format_ = nullptr;
   WAVEFORMATEXTENSIBLE *wave_format_extensible_ = nullptr;
   UINT32 buffer_frame_count_ = 0;
-  // REFERENCE_TIME hns_requested_duration_ = 10000000;  // 1 second
-  REFERENCE_TIME hns_requested_duration_ = 400000;  // 40ms instead of 1s
-
 
   // Playback parameters
   WAVEFORMATEX *playback_wave_format_ = nullptr;
@@ -141,11 +206,17 @@ class FlutterF2fSoundPlugin : public flutter::Plugin {
   std::string current_playback_path_;
   std::atomic<double> current_position_{0.0};
   std::atomic<double> current_duration_{0.0};
+  std::atomic<double> playback_latency_ms_{0.0};  // Buffer WASAPI granted
 
   // Playback thread
   std::thread playback_thread_;
   std::mutex playback_mutex_;
 
+  // WinHTTP session (an HINTERNET) shared by every download, so connections
+  // and TLS sessions to a host are reused from one fetch to the next
+  void* http_session_ = nullptr;
+  std::mutex http_session_mutex_;
+
   // COM initialization helper
   std::unique_ptr<class ComInit> com_init_;
 
@@ -162,7 +233,8 @@ class FlutterF2fSoundPlugin : public flutter::Plugin {
   HRESULT CleanupSystemSoundWASAPI();
 
   // Playback methods
-  HRESULT InitializePlaybackWASAPI();
+  // |latency_ms| is the requested buffer duration; 0 keeps the 1 s default.
+  HRESULT InitializePlaybackWASAPI(int latency_ms);
   void StartPlaybackThread();
   void StopPlayback();
   HRESULT CleanupPlaybackWASAPI();
@@ -171,17 +243,72 @@ class FlutterF2fSoundPlugin : public flutter::Plugin {
   void PlaybackStreamThread(const std::string& path);
 
   // Audio file methods
+  // Reads a whole file as PCM: MP3 through Media Foundation, WAV (including
+  // RF64 and extensible 24/32-bit and float) through RiffParser as 16-bit.
   HRESULT ReadAudioFile(const std::string& path, std::vector<uint8_t>& audio_data, WAVEFORMATEX** format);
   HRESULT ReadAudioFileWithMF(const std::string& path, std::vector<uint8_t>& audio_data, WAVEFORMATEX** format);
+  // Maps a PCM or IEEE float WAV or RF64 file and locates its data chunk.
+  // Returns false for anything else, which ReadAudioFile() then handles.
+  bool MapWavFile(const std::string& path, MappedWavFile& mapped);
+  // Whether samples in |file_format| can be written to the device as they
+  // are, comparing extensible formats by their subformat.
+  static bool WavFormatMatches(const WAVEFORMATEX* file_format, const WAVEFORMATEX* device_format);
   HRESULT ConvertAudioFormat(const WAVEFORMATEX* input_format, const std::vector<uint8_t>& input_data,
                              const WAVEFORMATEX* output_format, std::vector<uint8_t>& output_data);
+  // Downloads |url| into the persistent audio cache and returns the cached
+  // file. A cached copy is revalidated with its ETag and Last-Modified and
+  // reused on 304 Not Modified or when the server cannot be reached.
+  // Files of 8 MB and more from servers that accept ranges are fetched as
+  // four parallel range requests into a preallocated file.
   HRESULT DownloadAudioFile(const std::string& url, std::string& local_path);
+  // Fetches bytes [start, end) of |url_path| over |connection| (an
+  // HINTERNET) into the same offsets of the existing file at |path|.
+  // Returns false unless the server answered 206 with all of them.
+  static bool DownloadAudioRange(void* connection, const wchar_t* url_path, bool secure,
+                                 uint64_t start, uint64_t end, const std::string& path);
+  // The shared WinHTTP session, opened on first use with HTTP/2 enabled.
+  // Returns nullptr if it cannot be opened.
+  void* GetHttpSession();
+  // Cache entry for |url| without extension, named after a hash of the URL.
+  std::string GetAudioCachePath(const std::string& url);
+  // Deletes least recently used entries beyond the budget, except |keep|.
+  void EvictAudioCache(const std::string& keep);
   bool IsURL(const std::string& path);
   bool IsMP3(const std::string& path);
 
   // Format conversion helpers
   HRESULT CreateFormatForConfig(const AudioConfig& config, WAVEFORMATEX** format);
   bool IsFormatSupported(const WAVEFORMATEX* format, IMMDevice* device);
+  static bool IsFloatFormat(const WAVEFORMATEX* format);
+
+  // Builds the event value for one captured WASAPI packet: a Uint8List of the
+  // raw bytes, or a Float32List when float32 output was requested.
+  static flutter::EncodableValue CreateCapturePacket(const BYTE* data, UINT32 frames,
+                                                     const WAVEFORMATEX* format,
+                                                     bool float32_output);
+
+  // Prepares |coalescer| for a stream of |format| at the configured duration.
+  static void ResetCoalescer(PacketCoalescer& coalescer, const AudioConfig& config,
+                             const WAVEFORMATEX* format);
+
+  // Queues captured frames for the platform thread, gathering them into
+  // fixed-size packets first when coalescing is enabled.
+  void PostCapturePackets(UINT message, PacketCoalescer& coalescer, EventQueue& queue,
+                          const BYTE* data, UINT32 frames, const WAVEFORMATEX* format,
+                          bool float32_output);
+
+  // Reads the capture options shared by startRecording and
+  // startSystemSoundCapture.
+  static void ParseCaptureOptions(const flutter::EncodableMap& args, AudioConfig& config);
+
+  // Event queue helpers. EnqueueCapturePacket applies the overflow policy and
+  // posts |message| when the queue needs draining; CloseEventQueue must run
+  // before a capture thread is joined so a blocked producer is released.
+  static void ResetEventQueue(EventQueue& queue, const AudioConfig& config);
+  static void CloseEventQueue(EventQueue& queue);
+  void EnqueueCapturePacket(UINT message, EventQueue& queue, flutter::EncodableValue&& packet,
+                            UINT32 frames);
+  static std::deque<EventQueue::Packet> TakeQueuedPackets(EventQueue& queue);
 
   // Volume control
   HRESULT SetPlaybackVolume(double volume);